@@ -37,6 +37,7 @@ enum WallpaperErrorCode : int32_t {
     PERMISSION_ERROR = 201,
     NOT_SYSTEM_API = 202,
     PARAMETERS_ERROR = 401,
+    SUPERSEDED_ERROR = 13100001,
 };
 
 static float Alpha(uint64_t color)
@@ -69,6 +70,10 @@ void setErrorCode(OHOS::WallpaperMgrService::ErrorCode wallpaperErrorCode)
         case ErrorCode::E_NO_PERMISSION:
             taihe::set_business_error(WallpaperErrorCode::PERMISSION_ERROR, "Permission Denied!");
             break;
+        case ErrorCode::E_SUPERSEDED:
+            taihe::set_business_error(WallpaperErrorCode::SUPERSEDED_ERROR,
+                "The wallpaper was not applied, a newer wallpaper of the same type replaced it!");
+            break;
         default:
             taihe::set_business_error(WallpaperErrorCode::PARAMETERS_ERROR, "Invalid parameter");
             break;
@@ -103,6 +108,7 @@ void SetImageAsync(::ohos::wallpaper::SourceType const& sourceType, ::ohos::wall
             wallpaperErrorCode =WallpaperManager::GetInstance().SetWallpaper(str, wallpaperType, apiInfo);
         }
     }
+    // E_SUPERSEDED is reported as SUPERSEDED_ERROR, the picture of this call was never applied.
     if (wallpaperErrorCode != ErrorCode::E_OK) {
         setErrorCode(wallpaperErrorCode);
     }
@@ -216,7 +222,30 @@ void SetVideoAsync(::taihe::string_view source, ::ohos::wallpaper::WallpaperType
     }
 }
 
-uintptr_t GetImageAsync(::ohos::wallpaper::WallpaperType wallpaperType)
+WallpaperDecodeOptions ConvertDecodeOptions(::taihe::optional_view<::ohos::wallpaper::DecodeOptions> options)
+{
+    WallpaperDecodeOptions decodeOptions;
+    if (!options.has_value()) {
+        return decodeOptions;
+    }
+    const auto &value = options.value();
+    if (value.width.has_value()) {
+        decodeOptions.desiredWidth = value.width.value();
+    }
+    if (value.height.has_value()) {
+        decodeOptions.desiredHeight = value.height.value();
+    }
+    if (value.pixelFormat.has_value()) {
+        decodeOptions.pixelFormat = value.pixelFormat.value();
+    }
+    if (value.fitMode.has_value()) {
+        decodeOptions.fitMode = value.fitMode.value().get_value();
+    }
+    return decodeOptions;
+}
+
+uintptr_t GetImageAsync(::ohos::wallpaper::WallpaperType wallpaperType,
+    ::taihe::optional_view<::ohos::wallpaper::DecodeOptions> options)
 {
     if (wallpaperType != WallpaperType::WALLPAPER_SYSTEM &&
         wallpaperType != WallpaperType::WALLPAPER_LOCKSCREEN) {
@@ -227,7 +256,8 @@ uintptr_t GetImageAsync(::ohos::wallpaper::WallpaperType wallpaperType)
     }
     ApiInfo apiInfo{ true, true };
     std::shared_ptr<OHOS::Media::PixelMap> pixelMap;
-    ErrorCode wallpaperErrorCode = WallpaperManager::GetInstance().GetPixelMap(wallpaperType, apiInfo, pixelMap);
+    ErrorCode wallpaperErrorCode = WallpaperManager::GetInstance().GetPixelMap(
+        wallpaperType, apiInfo, pixelMap, ConvertDecodeOptions(options));
     if (wallpaperErrorCode != E_OK) {
         setErrorCode(wallpaperErrorCode);
         return 0;
@@ -236,7 +266,8 @@ uintptr_t GetImageAsync(::ohos::wallpaper::WallpaperType wallpaperType)
 }
 
 uintptr_t GetWallpaperByStateSync(::ohos::wallpaper::WallpaperType wallpaperType,
-    ::ohos::wallpaper::FoldState foldState, ::ohos::wallpaper::RotateState rotateState)
+    ::ohos::wallpaper::FoldState foldState, ::ohos::wallpaper::RotateState rotateState,
+    ::taihe::optional_view<::ohos::wallpaper::DecodeOptions> options)
 {
     if (wallpaperType != WallpaperType::WALLPAPER_SYSTEM &&
         wallpaperType != WallpaperType::WALLPAPER_LOCKSCREEN) {
@@ -262,7 +293,32 @@ uintptr_t GetWallpaperByStateSync(::ohos::wallpaper::WallpaperType wallpaperType
     }
     std::shared_ptr<OHOS::Media::PixelMap> pixelMap;
     ErrorCode wallpaperErrorCode = WallpaperManager::GetInstance().GetCorrespondWallpaper(
-        wallpaperType, foldState, rotateState, pixelMap);
+        wallpaperType, foldState, rotateState, pixelMap, ConvertDecodeOptions(options));
+    if (wallpaperErrorCode != E_OK) {
+        setErrorCode(wallpaperErrorCode);
+        return 0;
+    }
+    return reinterpret_cast<uintptr_t>(OHOS::Media::PixelMapTaiheAni::CreateEtsPixelMap(taihe::get_env(), pixelMap));
+}
+
+uintptr_t GetWallpaperRegionSync(::ohos::wallpaper::WallpaperType wallpaperType,
+    ::ohos::wallpaper::Region const &region, ::taihe::optional_view<int32_t> sampleSize)
+{
+    if (wallpaperType != WallpaperType::WALLPAPER_SYSTEM &&
+        wallpaperType != WallpaperType::WALLPAPER_LOCKSCREEN) {
+        HILOG_ERROR("Invalid wallpaperType parameter, wallpaperType:%{public}d", int32_t(wallpaperType));
+        taihe::set_business_error(WallpaperErrorCode::PARAMETERS_ERROR,
+            "Invalid wallpaperType, must be WALLPAPER_SYSTEM or WALLPAPER_LOCKSCREEN");
+        return 0;
+    }
+    WallpaperRegion wallpaperRegion;
+    wallpaperRegion.x = region.x;
+    wallpaperRegion.y = region.y;
+    wallpaperRegion.width = region.width;
+    wallpaperRegion.height = region.height;
+    std::shared_ptr<OHOS::Media::PixelMap> pixelMap;
+    ErrorCode wallpaperErrorCode = WallpaperManager::GetInstance().GetWallpaperRegion(
+        wallpaperType, wallpaperRegion, sampleSize.has_value() ? sampleSize.value() : 1, pixelMap);
     if (wallpaperErrorCode != E_OK) {
         setErrorCode(wallpaperErrorCode);
         return 0;
@@ -380,6 +436,7 @@ TH_EXPORT_CPP_API_SetCustomWallpaperAsync(SetCustomWallpaperAsync);
 TH_EXPORT_CPP_API_SetVideoAsync(SetVideoAsync);
 TH_EXPORT_CPP_API_GetImageAsync(GetImageAsync);
 TH_EXPORT_CPP_API_GetWallpaperByStateSync(GetWallpaperByStateSync);
+TH_EXPORT_CPP_API_GetWallpaperRegionSync(GetWallpaperRegionSync);
 TH_EXPORT_CPP_API_SetAllWallpapersSync(SetAllWallpapersSync);
 TH_EXPORT_CPP_API_OnWallpaperChange(OnWallpaperChange);
 TH_EXPORT_CPP_API_OffWallpaperChange(OffWallpaperChange);
@@ -46,6 +46,10 @@ JsErrorInfo JsError::ConvertErrorCode(ErrorCode wallpaperErrorCode)
             errorObject.code = static_cast<int32_t>(ErrorThrowType::SYSTEM_APP_PERMISSION_ERROR);
             errorObject.message = PERMISSION_FAILED_MESSAGE;
             break;
+        case E_SUPERSEDED:
+            errorObject.code = static_cast<int32_t>(ErrorThrowType::SUPERSEDED_ERROR);
+            errorObject.message = SUPERSEDED_MESSAGE;
+            break;
         default:
             HILOG_DEBUG("Non-existent error type!");
             break;
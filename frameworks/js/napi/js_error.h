@@ -31,6 +31,9 @@ constexpr const char *PERMISSION_DENIED_MESSAGE = "BusinessError 201: Permission
 constexpr const char *EQUIPMENT_ERROR_MESSAGE = "BusinessError 801: Equipment error.";
 constexpr const char *PERMISSION_FAILED_MESSAGE = "BusinessError 202: Permission verification failed,"
                                                   "application which is not a system application uses system API.";
+// Reported by setImage when a newer set of the same wallpaper type replaced the picture before it was applied.
+constexpr const char *SUPERSEDED_MESSAGE = "BusinessError 13100001: The wallpaper was not applied, "
+                                           "a newer wallpaper of the same type replaced it.";
 constexpr const char *PARAMETER_COUNT = "Mandatory parameters are left unspecified.";
 constexpr const char *WALLPAPERTYPE_PARAMETER_TYPE = "The type must be WallpaperType, parameter range must be "
                                                      "WALLPAPER_LOCKSCREEN or WALLPAPER_SYSTEM.";
@@ -38,6 +41,10 @@ constexpr const char *FOLDSTATE_PARAMETER_TYPE = "The type must be FoldState, pa
                                                      "NORMAL or UNFOLD_ONCE_STATE or UNFOLD_TWICE_STATE.";
 constexpr const char *ROTATESTATE_PARAMETER_TYPE = "The type must be RotateState, parameter range must be "
                                                      "PORTRAIT or LANDSCAPE.";
+constexpr const char *DECODE_OPTIONS_PARAMETER_TYPE = "The type must be DecodeOptions, width, height, pixelFormat "
+                                                      "and fitMode must be numbers.";
+constexpr const char *REGION_PARAMETER_TYPE = "The type must be Region, x, y, width and height must be numbers.";
+constexpr const char *SAMPLE_SIZE_PARAMETER_TYPE = "The type of sampleSize must be number.";
 constexpr const char *DYNAMIC_WALLPAPERTYPE_PARAMETER_TYPE = "The dynamic wallpaper must be .mp4 or conform to the "
                                                              "video format requirements.";
 enum ErrorThrowType : int32_t {
@@ -45,7 +52,8 @@ enum ErrorThrowType : int32_t {
     SYSTEM_APP_PERMISSION_ERROR = 202,
     PARAMETER_ERROR = 401,
     EQUIPMENT_ERROR = 801,
-    IMAGE_FORMAT_INCORRECT
+    IMAGE_FORMAT_INCORRECT,
+    SUPERSEDED_ERROR = 13100001
 };
 struct JsErrorInfo {
     int32_t code = 0;
@@ -610,7 +610,9 @@ void NapiWallpaperAbility::SetImageExec(std::shared_ptr<SetContextInfo> context,
             wallpaperErrorCode = WallpaperMgrService::WallpaperManager::GetInstance().SetWallpaper(
                 context->uri, context->wallpaperType, apiInfo);
         }
-        if (wallpaperErrorCode == E_OK) {
+        // The deprecated setWallpaper keeps succeeding when a newer set replaced its picture, setImage reports
+        // E_SUPERSEDED as SUPERSEDED_ERROR because the picture of this call was never applied.
+        if (wallpaperErrorCode == E_OK || (wallpaperErrorCode == E_SUPERSEDED && !apiInfo.needException)) {
             context->status = napi_ok;
         }
         if (apiInfo.needException) {
@@ -642,13 +644,13 @@ napi_value NAPI_GetImage(napi_env env, napi_callback_info info)
     auto context = std::make_shared<GetContextInfo>();
     ApiInfo apiInfo{ true, true };
     NapiWallpaperAbility::GetImageInner(context, apiInfo);
-    Call call(env, info, context, 1, apiInfo.needException);
+    Call call(env, info, context, NapiWallpaperAbility::GetDecodeCallbackPos(env, info, 1), apiInfo.needException);
     return call.AsyncCall(env, "getImage");
 }
 
 void NapiWallpaperAbility::GetImageInner(std::shared_ptr<GetContextInfo> context, const ApiInfo &apiInfo)
 {
-    auto input = [context](napi_env env, size_t argc, napi_value *argv, napi_value self) -> napi_status {
+    auto input = [context, apiInfo](napi_env env, size_t argc, napi_value *argv, napi_value self) -> napi_status {
         if (!NapiWallpaperAbility::IsValidArgCount(argc, 1)) {
             HILOG_DEBUG("input argc : %{public}zu", argc);
             context->SetErrInfo(
@@ -666,6 +668,10 @@ void NapiWallpaperAbility::GetImageInner(std::shared_ptr<GetContextInfo> context
             HILOG_ERROR("get wallpaperType failed, res:%{public}d", res);
             return res;
         }
+        // Only getImage takes decode options, the deprecated getPixelMap keeps its (type, callback) form.
+        if (apiInfo.needException && !NapiWallpaperAbility::ParseDecodeOptions(env, argc, argv, 1, context)) {
+            return napi_invalid_arg;
+        }
         return napi_ok;
     };
     auto output = [context](napi_env env, napi_value *result) -> napi_status {
@@ -678,7 +684,7 @@ void NapiWallpaperAbility::GetImageInner(std::shared_ptr<GetContextInfo> context
     auto exec = [context, apiInfo](Call::Context *ctx) {
         std::shared_ptr<OHOS::Media::PixelMap> pixelMap;
         ErrorCode wallpaperErrorCode = WallpaperMgrService::WallpaperManager::GetInstance().GetPixelMap(
-            context->wallpaperType, apiInfo, pixelMap);
+            context->wallpaperType, apiInfo, pixelMap, context->decodeOptions);
         HILOG_DEBUG("exec wallpaperErrorCode[%{public}d]", wallpaperErrorCode);
         if (wallpaperErrorCode == E_OK) {
             context->status = napi_ok;
@@ -729,6 +735,9 @@ void NapiWallpaperAbility::GetCorrespondWallpaperInner(std::shared_ptr<GetContex
         napi_get_value_int32(env, argv[0], &context->wallpaperType);
         napi_get_value_int32(env, argv[1], &context->foldState);
         napi_get_value_int32(env, argv[2], &context->rotateState);
+        if (!ParseDecodeOptions(env, argc, argv, THREE, context)) {
+            return napi_invalid_arg;
+        }
         return napi_ok;
     };
     auto output = [context](napi_env env, napi_value *result) -> napi_status {
@@ -740,7 +749,7 @@ void NapiWallpaperAbility::GetCorrespondWallpaperInner(std::shared_ptr<GetContex
     auto exec = [context, apiInfo](Call::Context *ctx) {
         std::shared_ptr<OHOS::Media::PixelMap> pixelMap;
         ErrorCode wallpaperErrorCode = WallpaperManager::GetInstance().GetCorrespondWallpaper(
-            context->wallpaperType, context->foldState, context->rotateState, pixelMap);
+            context->wallpaperType, context->foldState, context->rotateState, pixelMap, context->decodeOptions);
         if (wallpaperErrorCode == E_OK) {
             context->status = napi_ok;
             context->pixelMap = pixelMap != nullptr ? std::move(pixelMap) : nullptr;
@@ -755,6 +764,62 @@ void NapiWallpaperAbility::GetCorrespondWallpaperInner(std::shared_ptr<GetContex
     context->SetExecution(std::move(exec));
 }
 
+napi_value NAPI_GetWallpaperRegion(napi_env env, napi_callback_info info)
+{
+    auto context = std::make_shared<GetContextInfo>();
+    NapiWallpaperAbility::GetWallpaperRegionInner(context);
+    Call call(env, info, context, NapiWallpaperAbility::GetDecodeCallbackPos(env, info, TWO), true);
+    return call.AsyncCall(env, "getWallpaperRegion");
+}
+
+void NapiWallpaperAbility::GetWallpaperRegionInner(std::shared_ptr<GetContextInfo> context)
+{
+    auto input = [context](napi_env env, size_t argc, napi_value *argv, napi_value self) -> napi_status {
+        if (!IsValidArgCount(argc, TWO)) {
+            context->SetErrInfo(PARAMETER_ERROR, std::string(PARAMETER_ERROR_MESSAGE) + PARAMETER_COUNT);
+            return napi_invalid_arg;
+        }
+        if (!IsValidArgType(env, argv[0], napi_number) || !IsValidArgRange(env, argv[0])) {
+            context->SetErrInfo(PARAMETER_ERROR, std::string(PARAMETER_ERROR_MESSAGE) + WALLPAPERTYPE_PARAMETER_TYPE);
+            return napi_invalid_arg;
+        }
+        if (!IsValidArgType(env, argv[1], napi_object)
+            || WallpaperJSUtil::Convert2Region(env, argv[1], context->region) != napi_ok) {
+            context->SetErrInfo(PARAMETER_ERROR, std::string(PARAMETER_ERROR_MESSAGE) + REGION_PARAMETER_TYPE);
+            return napi_invalid_arg;
+        }
+        napi_get_value_int32(env, argv[0], &context->wallpaperType);
+        if (argc > TWO && !IsValidArgType(env, argv[TWO], napi_undefined)) {
+            if (!IsValidArgType(env, argv[TWO], napi_number)) {
+                context->SetErrInfo(PARAMETER_ERROR, std::string(PARAMETER_ERROR_MESSAGE) + SAMPLE_SIZE_PARAMETER_TYPE);
+                return napi_invalid_arg;
+            }
+            napi_get_value_int32(env, argv[TWO], &context->sampleSize);
+        }
+        return napi_ok;
+    };
+    auto output = [context](napi_env env, napi_value *result) -> napi_status {
+        napi_value pixelVal =
+            context->pixelMap != nullptr ? PixelMapNapi::CreatePixelMap(env, std::move(context->pixelMap)) : nullptr;
+        *result = pixelVal;
+        return napi_ok;
+    };
+    auto exec = [context](Call::Context *ctx) {
+        std::shared_ptr<OHOS::Media::PixelMap> pixelMap;
+        ErrorCode wallpaperErrorCode = WallpaperManager::GetInstance().GetWallpaperRegion(
+            context->wallpaperType, context->region, context->sampleSize, pixelMap);
+        if (wallpaperErrorCode == E_OK) {
+            context->status = napi_ok;
+            context->pixelMap = pixelMap != nullptr ? std::move(pixelMap) : nullptr;
+            return;
+        }
+        JsErrorInfo jsErrorInfo = JsError::ConvertErrorCode(wallpaperErrorCode);
+        context->SetErrInfo(jsErrorInfo.code, jsErrorInfo.message);
+    };
+    context->SetAction(std::move(input), std::move(output));
+    context->SetExecution(std::move(exec));
+}
+
 napi_value NAPI_On(napi_env env, napi_callback_info info)
 {
     HILOG_DEBUG("NAPI_On in.");
@@ -1094,6 +1159,31 @@ void NapiWallpaperAbility::OnWallpaperChange(
     }
 }
 
+size_t NapiWallpaperAbility::GetDecodeCallbackPos(napi_env env, napi_callback_info info, size_t optionsPos)
+{
+    size_t argc = WallpaperJSUtil::MAX_ARGC;
+    napi_value argv[WallpaperJSUtil::MAX_ARGC] = { nullptr };
+    if (napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr) != napi_ok || argc <= optionsPos) {
+        return optionsPos;
+    }
+    // The decode argument (options or sample size) is optional and precedes the callback when both are passed.
+    return IsValidArgType(env, argv[optionsPos], napi_function) ? optionsPos : optionsPos + 1;
+}
+
+bool NapiWallpaperAbility::ParseDecodeOptions(
+    napi_env env, size_t argc, napi_value *argv, size_t optionsPos, std::shared_ptr<GetContextInfo> context)
+{
+    if (argc <= optionsPos || IsValidArgType(env, argv[optionsPos], napi_undefined)) {
+        return true;
+    }
+    if (!IsValidArgType(env, argv[optionsPos], napi_object)
+        || WallpaperJSUtil::Convert2DecodeOptions(env, argv[optionsPos], context->decodeOptions) != napi_ok) {
+        context->SetErrInfo(PARAMETER_ERROR, std::string(PARAMETER_ERROR_MESSAGE) + DECODE_OPTIONS_PARAMETER_TYPE);
+        return false;
+    }
+    return true;
+}
+
 bool NapiWallpaperAbility::IsValidArgCount(size_t argc, size_t expectationSize)
 {
     return argc >= expectationSize;
@@ -56,6 +56,9 @@ struct GetContextInfo : public Call::Context {
     std::string parameter = "";
     bool result = false;
     std::shared_ptr<OHOS::Media::PixelMap> pixelMap;
+    WallpaperDecodeOptions decodeOptions;
+    WallpaperRegion region;
+    int32_t sampleSize = 1;
     napi_status status = napi_generic_failure;
     GetContextInfo() : Context(nullptr, nullptr) {};
     GetContextInfo(InputAction input, OutputAction output) : Context(std::move(input), std::move(output)) {};
@@ -184,6 +187,9 @@ public:
     static bool IsValidFoldStateRange(napi_env env, napi_value argValue);
     static bool IsValidRotateStateRange(napi_env env, napi_value argValue);
     static bool IsValidWallpaperInfos(napi_env env, napi_value argValue);
+    static size_t GetDecodeCallbackPos(napi_env env, napi_callback_info info, size_t optionsPos);
+    static bool ParseDecodeOptions(
+        napi_env env, size_t argc, napi_value *argv, size_t optionsPos, std::shared_ptr<GetContextInfo> context);
     static bool CheckValidArgWallpaperType(
         napi_env env, size_t argc, napi_value argValue, std::shared_ptr<Call::Context> ctx);
     static void GetColorsInner(std::shared_ptr<GetContextInfo> context, const ApiInfo &apiInfo);
@@ -198,6 +204,7 @@ public:
     static void SetImageExec(std::shared_ptr<SetContextInfo> context, const ApiInfo &apiInfo);
     static void GetImageInner(std::shared_ptr<GetContextInfo> context, const ApiInfo &apiInfo);
     static void GetCorrespondWallpaperInner(std::shared_ptr<GetContextInfo> context, const ApiInfo &apiInfo);
+    static void GetWallpaperRegionInner(std::shared_ptr<GetContextInfo> context);
     static void SetVideoInner(std::shared_ptr<SetContextInfo> context);
     static void SendEventInner(std::shared_ptr<GetContextInfo> context);
     static void SetCustomWallpaper(std::shared_ptr<SetContextInfo> context);
@@ -252,6 +259,7 @@ napi_value NAPI_SetImage(napi_env env, napi_callback_info info);
 napi_value NAPI_GetPixelMap(napi_env env, napi_callback_info info);
 napi_value NAPI_GetImage(napi_env env, napi_callback_info info);
 napi_value NAPI_GetCorrespondWallpaper(napi_env env, napi_callback_info info);
+napi_value NAPI_GetWallpaperRegion(napi_env env, napi_callback_info info);
 napi_value NAPI_On(napi_env env, napi_callback_info info);
 napi_value NAPI_Off(napi_env env, napi_callback_info info);
 napi_value NAPI_SetVideo(napi_env env, napi_callback_info info);
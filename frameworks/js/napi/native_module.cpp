@@ -92,6 +92,22 @@ static napi_value InitFoldState(napi_env &env)
     return foldState;
 }
 
+static napi_value InitDecodeFitMode(napi_env &env)
+{
+    napi_value decodeFitMode = nullptr;
+    napi_value fill = nullptr;
+    napi_value contain = nullptr;
+    napi_value cover = nullptr;
+    WALLPAPER_NAPI_CALL(napi_create_int32(env, static_cast<int32_t>(DecodeFitMode::FIT_FILL), &fill));
+    WALLPAPER_NAPI_CALL(napi_create_int32(env, static_cast<int32_t>(DecodeFitMode::FIT_CONTAIN), &contain));
+    WALLPAPER_NAPI_CALL(napi_create_int32(env, static_cast<int32_t>(DecodeFitMode::FIT_COVER), &cover));
+    WALLPAPER_NAPI_CALL(napi_create_object(env, &decodeFitMode));
+    WALLPAPER_NAPI_CALL(napi_set_named_property(env, decodeFitMode, "FILL", fill));
+    WALLPAPER_NAPI_CALL(napi_set_named_property(env, decodeFitMode, "CONTAIN", contain));
+    WALLPAPER_NAPI_CALL(napi_set_named_property(env, decodeFitMode, "COVER", cover));
+    return decodeFitMode;
+}
+
 static napi_value Init(napi_env env, napi_value exports)
 {
     HILOG_DEBUG("napi_module Init start...");
@@ -99,6 +115,7 @@ static napi_value Init(napi_env env, napi_value exports)
     napi_value wallpaperResourceType = InitWallpaperResourceType(env);
     napi_value rotateState = InitRotateState(env);
     napi_value foldState = InitFoldState(env);
+    napi_value decodeFitMode = InitDecodeFitMode(env);
 
     napi_property_descriptor desc[] = {
         DECLARE_NAPI_FUNCTION("getColors", NAPI_GetColors),
@@ -119,6 +136,7 @@ static napi_value Init(napi_env env, napi_value exports)
         DECLARE_NAPI_FUNCTION("getImage", NAPI_GetImage),
         DECLARE_NAPI_FUNCTION("getCorrespondWallpaper", NAPI_GetCorrespondWallpaper),
         DECLARE_NAPI_FUNCTION("getWallpaperByState", NAPI_GetCorrespondWallpaper),
+        DECLARE_NAPI_FUNCTION("getWallpaperRegion", NAPI_GetWallpaperRegion),
         DECLARE_NAPI_FUNCTION("on", NAPI_On),
         DECLARE_NAPI_FUNCTION("off", NAPI_Off),
         DECLARE_NAPI_FUNCTION("setVideo", NAPI_SetVideo),
@@ -129,6 +147,7 @@ static napi_value Init(napi_env env, napi_value exports)
         DECLARE_NAPI_STATIC_PROPERTY("WallpaperResourceType", wallpaperResourceType),
         DECLARE_NAPI_STATIC_PROPERTY("RotateState", rotateState),
         DECLARE_NAPI_STATIC_PROPERTY("FoldState", foldState),
+        DECLARE_NAPI_STATIC_PROPERTY("DecodeFitMode", decodeFitMode),
     };
 
     WALLPAPER_NAPI_CALL(napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc));
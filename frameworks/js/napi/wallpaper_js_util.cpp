@@ -115,4 +115,46 @@ napi_status WallpaperJSUtil::Convert2WallpaperInfos(napi_env env, napi_value jsW
     }
     return napi_ok;
 }
+
+static napi_status GetOptionalInt32(napi_env env, napi_value jsObject, const char *name, int32_t &value)
+{
+    bool hasProperty = false;
+    NAPI_CALL_BASE(env, napi_has_named_property(env, jsObject, name, &hasProperty), napi_invalid_arg);
+    if (!hasProperty) {
+        return napi_ok;
+    }
+    napi_value property = nullptr;
+    NAPI_CALL_BASE(env, napi_get_named_property(env, jsObject, name, &property), napi_invalid_arg);
+    napi_valuetype valueType = napi_undefined;
+    NAPI_CALL_BASE(env, napi_typeof(env, property, &valueType), napi_invalid_arg);
+    if (valueType == napi_undefined) {
+        return napi_ok;
+    }
+    return napi_get_value_int32(env, property, &value);
+}
+
+napi_status WallpaperJSUtil::Convert2DecodeOptions(napi_env env, napi_value jsOptions, WallpaperDecodeOptions &options)
+{
+    HILOG_DEBUG("Convert2DecodeOptions in.");
+    NAPI_CALL_BASE(env, GetOptionalInt32(env, jsOptions, "width", options.desiredWidth), napi_invalid_arg);
+    NAPI_CALL_BASE(env, GetOptionalInt32(env, jsOptions, "height", options.desiredHeight), napi_invalid_arg);
+    NAPI_CALL_BASE(env, GetOptionalInt32(env, jsOptions, "pixelFormat", options.pixelFormat), napi_invalid_arg);
+    NAPI_CALL_BASE(env, GetOptionalInt32(env, jsOptions, "fitMode", options.fitMode), napi_invalid_arg);
+    return napi_ok;
+}
+
+napi_status WallpaperJSUtil::Convert2Region(napi_env env, napi_value jsRegion, WallpaperRegion &region)
+{
+    HILOG_DEBUG("Convert2Region in.");
+    napi_value value = nullptr;
+    NAPI_CALL_BASE(env, napi_get_named_property(env, jsRegion, "x", &value), napi_invalid_arg);
+    NAPI_CALL_BASE(env, napi_get_value_int32(env, value, &region.x), napi_invalid_arg);
+    NAPI_CALL_BASE(env, napi_get_named_property(env, jsRegion, "y", &value), napi_invalid_arg);
+    NAPI_CALL_BASE(env, napi_get_value_int32(env, value, &region.y), napi_invalid_arg);
+    NAPI_CALL_BASE(env, napi_get_named_property(env, jsRegion, "width", &value), napi_invalid_arg);
+    NAPI_CALL_BASE(env, napi_get_value_int32(env, value, &region.width), napi_invalid_arg);
+    NAPI_CALL_BASE(env, napi_get_named_property(env, jsRegion, "height", &value), napi_invalid_arg);
+    NAPI_CALL_BASE(env, napi_get_value_int32(env, value, &region.height), napi_invalid_arg);
+    return napi_ok;
+}
 } // namespace OHOS::WallpaperNAPI
\ No newline at end of file
@@ -35,6 +35,8 @@ public:
     static napi_status Convert2WallpaperInfo(napi_env env, napi_value jsWallpaper, WallpaperInfo &wallpaperInfo);
     static napi_status Convert2WallpaperInfos(napi_env env, napi_value jsWallpapers,
         std::vector<WallpaperInfo> &wallpaperInfos);
+    static napi_status Convert2DecodeOptions(napi_env env, napi_value jsOptions, WallpaperDecodeOptions &options);
+    static napi_status Convert2Region(napi_env env, napi_value jsRegion, WallpaperRegion &region);
 };
 } // namespace OHOS::WallpaperNAPI
 #endif // WALLPAPER_JS_UTIL_H
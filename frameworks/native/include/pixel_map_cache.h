@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2025 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INNERKITS_PIXEL_MAP_CACHE_H
+#define INNERKITS_PIXEL_MAP_CACHE_H
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+#include "pixel_map.h"
+
+namespace OHOS {
+namespace WallpaperMgrService {
+// wallpaperType, foldState, rotateState, wallpaperId, desiredWidth, desiredHeight, pixelFormat, fitMode
+using PixelMapCacheKey = std::tuple<int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, int32_t>;
+
+/**
+ * LRU cache of decoded wallpapers bounded by the bytes of their pixels. Callers always get a copy,
+ * so editing a returned PixelMap never changes what later callers see.
+ */
+class PixelMapCache {
+public:
+    static constexpr size_t DEFAULT_MAX_BYTES = 32 * 1024 * 1024; // a few decodes of a full screen wallpaper
+
+    explicit PixelMapCache(size_t maxBytes = 0);
+    ~PixelMapCache() = default;
+    PixelMapCache(const PixelMapCache &) = delete;
+    PixelMapCache &operator=(const PixelMapCache &) = delete;
+    /**
+     * Evicts down to the new limit, 0 disables the cache.
+     */
+    void SetCapacity(size_t maxBytes);
+    bool IsEnabled();
+    std::shared_ptr<OHOS::Media::PixelMap> Get(const PixelMapCacheKey &key);
+    /**
+     * Keeps pixelMap as is, the caller must not hand it out after inserting it.
+     */
+    void Put(const PixelMapCacheKey &key, std::shared_ptr<OHOS::Media::PixelMap> pixelMap);
+    void Invalidate(int32_t wallpaperType);
+    void Clear();
+    size_t GetUsedBytes();
+    static std::shared_ptr<OHOS::Media::PixelMap> Copy(const std::shared_ptr<OHOS::Media::PixelMap> &source);
+
+private:
+    struct Entry {
+        PixelMapCacheKey key;
+        std::shared_ptr<OHOS::Media::PixelMap> pixelMap;
+        size_t bytes;
+    };
+    void EraseLocked(std::list<Entry>::iterator entry);
+    void EvictLocked();
+
+    std::mutex mutex_;
+    size_t maxBytes_;
+    size_t usedBytes_ = 0;
+    std::list<Entry> entries_; // most recently used first
+    std::map<PixelMapCacheKey, std::list<Entry>::iterator> index_;
+};
+} // namespace WallpaperMgrService
+} // namespace OHOS
+#endif // INNERKITS_PIXEL_MAP_CACHE_H
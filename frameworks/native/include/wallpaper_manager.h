@@ -16,6 +16,7 @@
 #ifndef INNERKITS_WALLPAPER_MANAGER_H
 #define INNERKITS_WALLPAPER_MANAGER_H
 
+#include <functional>
 #include <list>
 #include <map>
 #include <mutex>
@@ -24,10 +25,12 @@
 
 #include "avmetadatahelper.h"
 #include "fault_reporter.h"
+#include "image_source.h"
 #include "ipc_skeleton.h"
 #include "iwallpaper_callback.h"
 #include "iwallpaper_event_listener.h"
 #include "iwallpaper_service.h"
+#include "pixel_map_cache.h"
 #include "singleton.h"
 #include "wallpaper_common.h"
 #include "wallpaper_event_listener.h"
@@ -37,6 +40,15 @@ using JScallback = bool (*)(int32_t);
 namespace OHOS {
 using namespace MiscServices;
 namespace WallpaperMgrService {
+struct CorrespondWallpaper {
+    int32_t foldState = 0;
+    int32_t rotateState = 0;
+    int32_t wallpaperId = -1;
+    // index of the entry decoded from the same file, -1 when this entry decoded its own. Aliases share pixelMap.
+    int32_t aliasOf = -1;
+    std::shared_ptr<OHOS::Media::PixelMap> pixelMap;
+};
+
 class WallpaperManager {
     WallpaperManager();
     ~WallpaperManager();
@@ -49,29 +61,32 @@ public:
     * Wallpaper set.
     * @param  uriOrPixelMap Wallpaper picture; wallpaperType Wallpaper type,
     * values for WALLPAPER_SYSTEM or WALLPAPER_LOCKSCREEN
-    * @return  ErrorCode
+    * @return  ErrorCode, E_SUPERSEDED when the picture was not applied because a newer set replaced it
     */
     ErrorCode SetWallpaper(std::string uri, int32_t wallpaperType, const ApiInfo &apiInfo);
 
     /**
     * Wallpaper set.
     * @param  pixelMap:picture pixelMap struct; wallpaperType Wallpaper type,
-    * values for WALLPAPER_SYSTEM or WALLPAPER_LOCKSCREEN
-    * @return  ErrorCode
+    * values for WALLPAPER_SYSTEM or WALLPAPER_LOCKSCREEN; storageFormat WallpaperStorageFormat the
+    * picture is stored in, STORAGE_DEFAULT follows the device profile
+    * @return  ErrorCode, E_SUPERSEDED when the picture was not applied because a newer set replaced it
     */
-    ErrorCode SetWallpaper(
-        std::shared_ptr<OHOS::Media::PixelMap> pixelMap, int32_t wallpaperType, const ApiInfo &apiInfo);
+    ErrorCode SetWallpaper(std::shared_ptr<OHOS::Media::PixelMap> pixelMap, int32_t wallpaperType,
+        const ApiInfo &apiInfo, int32_t storageFormat = STORAGE_DEFAULT);
 
     /**
         *Obtains the default pixel map of a wallpaper of the specified type.
         * @param wallpaperType Wallpaper type, values for WALLPAPER_SYSTEM or WALLPAPER_LOCKSCREEN;
         * Obtains image.PixelMap png type The bitmap file of wallpaper
+        * @param options Size, pixel format and fit mode to decode with, the defaults decode the stored image as is
         * @return ErrorCode
         * @permission ohos.permission.GET_WALLPAPER
         * @systemapi Hide this for inner system use.
     */
-    ErrorCode GetPixelMap(
-        int32_t wallpaperType, const ApiInfo &apiInfo, std::shared_ptr<OHOS::Media::PixelMap> &PixelMap);
+    ErrorCode GetPixelMap(int32_t wallpaperType, const ApiInfo &apiInfo,
+        std::shared_ptr<OHOS::Media::PixelMap> &PixelMap,
+        const WallpaperDecodeOptions &options = WallpaperDecodeOptions());
 
     /**
      * Obtains the WallpaperColorsCollection instance for the wallpaper of the specified type.
@@ -80,8 +95,20 @@ public:
      */
     ErrorCode GetColors(int32_t wallpaperType, const ApiInfo &apiInfo, std::vector<uint64_t> &colors);
 
+    /**
+     * Obtains the dominant colors and the vibrant and muted swatches of the wallpaper of the specified type,
+     * extracted once by the service when the wallpaper is set.
+     * @param wallpaperType Wallpaper type, values for WALLPAPER_SYSTEM or WALLPAPER_LOCKSCREEN
+     * @param palette Left empty while the service has not extracted the palette of the current wallpaper yet
+     * @permission ohos.permission.GET_WALLPAPER
+     * @systemapi Hide this for inner system use.
+     */
+    ErrorCode GetColorPalette(int32_t wallpaperType, WallpaperPalette &palette);
+
     /**
      * Obtains the ID of the wallpaper of the specified type.
+     * The ID is the version of the committed wallpaper files, so it is kept across a service restart. Only the
+     * preset default wallpaper reports -1.
      * @param wallpaperType Wallpaper type, values for WALLPAPER_SYSTEM or WALLPAPER_LOCKSCREEN
      * @return number type of callback function
      */
@@ -164,8 +191,45 @@ public:
     ErrorCode SetAllWallpapers(std::vector<WallpaperInfo> wallpaperInfo, int32_t wallpaperType);
     bool RegisterWallpaperCallback(JScallback callback);
     ErrorCode GetCorrespondWallpaper(int32_t wallpaperType, int32_t foldState, int32_t rotateState,
+        std::shared_ptr<OHOS::Media::PixelMap> &pixelMap,
+        const WallpaperDecodeOptions &options = WallpaperDecodeOptions());
+
+    /**
+     * Decodes only a rectangle of the wallpaper, for pictures larger than the viewport such as panoramas.
+     * @param region Rectangle in pixels of the stored picture, must lie inside it
+     * @param sampleSize Integer downscale applied to the region, 1 keeps it at full resolution
+     * @permission ohos.permission.GET_WALLPAPER
+     */
+    ErrorCode GetWallpaperRegion(int32_t wallpaperType, const WallpaperRegion &region, int32_t sampleSize,
+        std::shared_ptr<OHOS::Media::PixelMap> &pixelMap);
+
+    /**
+     * Gets every fold and rotate variant of a wallpaper in one IPC, with the GetCorrespondWallpaper fallback applied.
+     * Variants resolving to the same file are decoded once and share the pixel map.
+     * @param wallpapers Receives one entry per variant, empty when the wallpaper is a live video
+     * @permission ohos.permission.GET_WALLPAPER
+     */
+    ErrorCode GetAllCorrespondWallpapers(int32_t wallpaperType, std::vector<CorrespondWallpaper> &wallpapers,
+        const WallpaperDecodeOptions &options = WallpaperDecodeOptions());
+
+    /**
+     * Gets the smallest stored rendition of a wallpaper whose long edge still reaches maxEdge.
+     * Falls back to the full size picture when no rendition is large enough or none was generated yet.
+     * @param maxEdge Long edge in pixels the caller displays the wallpaper at, must be positive
+     * @permission ohos.permission.GET_WALLPAPER
+     */
+    ErrorCode GetThumbnail(int32_t wallpaperType, int32_t foldState, int32_t rotateState, int32_t maxEdge,
         std::shared_ptr<OHOS::Media::PixelMap> &pixelMap);
 
+    /**
+     * Gets the block compressed texture stored next to a wallpaper, it uploads to the GPU without decoding.
+     * The fd stays -1 and the block format TEXTURE_FORMAT_NONE when no texture was generated for the wallpaper.
+     * @param textureFd Receives the texture container, closed by the caller
+     * @permission ohos.permission.GET_WALLPAPER
+     */
+    ErrorCode GetWallpaperTexture(int32_t wallpaperType, int32_t foldState, int32_t rotateState,
+        WallpaperTextureInfo &textureInfo, int32_t &textureFd);
+
     JScallback GetCallback();
 
     void SetCallback(JScallback cb);
@@ -177,6 +241,19 @@ public:
     bool RegisterWallpaperListener();
     bool IsDefaultWallpaperResource(int32_t userId, int32_t wallpaperType);
 
+    /**
+     * Sets the budget of the in-process cache of decoded wallpapers used by GetPixelMap and GetCorrespondWallpaper.
+     * The cache is on with PixelMapCache::DEFAULT_MAX_BYTES. Every lookup first passes the same service checks as
+     * a fetch, a refused caller gets the error and the cache is dropped.
+     * @param maxBytes Upper bound of the cached pixel bytes, 0 disables the cache
+     */
+    void SetPixelMapCacheCapacity(size_t maxBytes);
+
+    /**
+     * Drops the cached decodes of a wallpaper type, called when the wallpaper of that type changed.
+     */
+    void InvalidatePixelMapCache(int32_t wallpaperType);
+
 private:
     class DeathRecipient final : public IRemoteObject::DeathRecipient {
     public:
@@ -195,7 +272,25 @@ private:
     FILE *OpenFile(const std::string &fileName, int &fd, int64_t &fileSize);
     ErrorCode CheckWallpaperFormat(const std::string &realPath, bool isLive);
     ErrorCode GetWallpaperSize(const std::string &realPath, bool isLive, int32_t &leng);
-    ErrorCode CreatePixelMapByFd(int32_t fd, int32_t size, std::shared_ptr<OHOS::Media::PixelMap> &pixelMap);
+    ErrorCode CreatePixelMapByFd(int32_t fd, int32_t size, std::shared_ptr<OHOS::Media::PixelMap> &pixelMap,
+        const WallpaperDecodeOptions &options = WallpaperDecodeOptions());
+    bool IsValidDecodeOptions(const WallpaperDecodeOptions &options);
+    std::unique_ptr<OHOS::Media::ImageSource> CreateImageSourceByFd(int32_t fd, int32_t size);
+    ErrorCode CreateRegionPixelMapByFd(int32_t fd, int32_t size, const WallpaperRegion &region, int32_t sampleSize,
+        std::shared_ptr<OHOS::Media::PixelMap> &pixelMap);
+    void BuildDecodeOptions(const OHOS::Media::ImageInfo &imageInfo, const WallpaperDecodeOptions &options,
+        OHOS::Media::DecodeOptions &decodeOpts);
+    ErrorCode GetPixelMapInner(int32_t wallpaperType, const ApiInfo &apiInfo,
+        const WallpaperDecodeOptions &options, std::shared_ptr<OHOS::Media::PixelMap> &pixelMap);
+    ErrorCode DecodeCorrespondWallpapers(const std::vector<int32_t> &variantInfos, std::vector<int> &fds,
+        const WallpaperDecodeOptions &options, std::vector<CorrespondWallpaper> &wallpapers);
+    ErrorCode GetCorrespondWallpaperInner(int32_t wallpaperType, int32_t foldState, int32_t rotateState,
+        const WallpaperDecodeOptions &options, std::shared_ptr<OHOS::Media::PixelMap> &pixelMap);
+    ErrorCode CheckWallpaperAccess(int32_t wallpaperType, int32_t &wallpaperId);
+    ErrorCode GetCachedPixelMap(PixelMapCacheKey key,
+        const std::function<ErrorCode(std::shared_ptr<OHOS::Media::PixelMap> &)> &decode,
+        std::shared_ptr<OHOS::Media::PixelMap> &pixelMap);
+    int32_t CreateSharedPixels(std::shared_ptr<OHOS::Media::PixelMap> pixelMap);
     ErrorCode GetFdByPath(
         const WallpaperInfo &wallpaperInfo, WallpaperPictureInfo &wallpaperPictureInfo, std::string fileRealPath);
     void CloseWallpaperInfoFd(std::vector<WallpaperPictureInfo> wallpaperPictureInfos);
@@ -208,6 +303,7 @@ private:
     std::mutex wallpaperProxyLock_;
     std::mutex listenerMapLock_;
     std::map<std::string, sptr<WallpaperEventListenerClient>> listenerMap_;
+    PixelMapCache pixelMapCache_{ PixelMapCache::DEFAULT_MAX_BYTES };
     bool (*callback)(int32_t);
 };
 } // namespace WallpaperMgrService
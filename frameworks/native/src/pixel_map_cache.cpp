@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2025 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "PixelMapCache"
+
+#include "pixel_map_cache.h"
+
+#include "hilog_wrapper.h"
+
+namespace OHOS {
+namespace WallpaperMgrService {
+using namespace OHOS::Media;
+
+PixelMapCache::PixelMapCache(size_t maxBytes) : maxBytes_(maxBytes)
+{
+}
+
+void PixelMapCache::SetCapacity(size_t maxBytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    maxBytes_ = maxBytes;
+    EvictLocked();
+}
+
+bool PixelMapCache::IsEnabled()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return maxBytes_ > 0;
+}
+
+std::shared_ptr<PixelMap> PixelMapCache::Get(const PixelMapCacheKey &key)
+{
+    std::shared_ptr<PixelMap> cached = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto entry = index_.find(key);
+        if (entry == index_.end()) {
+            return nullptr;
+        }
+        entries_.splice(entries_.begin(), entries_, entry->second);
+        cached = entry->second->pixelMap;
+    }
+    // Cached pixels are never written, so they can be copied without holding the lock.
+    return Copy(cached);
+}
+
+void PixelMapCache::Put(const PixelMapCacheKey &key, std::shared_ptr<PixelMap> pixelMap)
+{
+    if (pixelMap == nullptr || pixelMap->GetByteCount() <= 0) {
+        return;
+    }
+    size_t bytes = static_cast<size_t>(pixelMap->GetByteCount());
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (bytes > maxBytes_) {
+        return;
+    }
+    auto entry = index_.find(key);
+    if (entry != index_.end()) {
+        EraseLocked(entry->second);
+    }
+    entries_.push_front(Entry{ key, std::move(pixelMap), bytes });
+    index_[key] = entries_.begin();
+    usedBytes_ += bytes;
+    EvictLocked();
+}
+
+void PixelMapCache::Invalidate(int32_t wallpaperType)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto entry = entries_.begin(); entry != entries_.end();) {
+        auto next = std::next(entry);
+        if (std::get<0>(entry->key) == wallpaperType) {
+            EraseLocked(entry);
+        }
+        entry = next;
+    }
+}
+
+void PixelMapCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    index_.clear();
+    usedBytes_ = 0;
+}
+
+size_t PixelMapCache::GetUsedBytes()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return usedBytes_;
+}
+
+std::shared_ptr<PixelMap> PixelMapCache::Copy(const std::shared_ptr<PixelMap> &source)
+{
+    if (source == nullptr) {
+        return nullptr;
+    }
+    InitializationOptions opts;
+    opts.size = { source->GetWidth(), source->GetHeight() };
+    opts.pixelFormat = source->GetPixelFormat();
+    opts.alphaType = source->GetAlphaType();
+    opts.editable = source->IsEditable();
+    std::unique_ptr<PixelMap> copy = PixelMap::Create(*source, opts);
+    if (copy == nullptr) {
+        HILOG_ERROR("Copy cached pixelMap failed.");
+        return nullptr;
+    }
+    return std::shared_ptr<PixelMap>(std::move(copy));
+}
+
+void PixelMapCache::EraseLocked(std::list<Entry>::iterator entry)
+{
+    usedBytes_ -= entry->bytes;
+    index_.erase(entry->key);
+    entries_.erase(entry);
+}
+
+void PixelMapCache::EvictLocked()
+{
+    while (!entries_.empty() && usedBytes_ > maxBytes_) {
+        EraseLocked(std::prev(entries_.end()));
+    }
+}
+} // namespace WallpaperMgrService
+} // namespace OHOS
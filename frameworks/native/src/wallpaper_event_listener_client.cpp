@@ -17,6 +17,7 @@
 
 #include "hilog_wrapper.h"
 #include "wallpaper_event_listener_client.h"
+#include "wallpaper_manager.h"
 
 namespace OHOS {
 namespace WallpaperMgrService {
@@ -33,6 +34,7 @@ WallpaperEventListenerClient::~WallpaperEventListenerClient()
 void WallpaperEventListenerClient::OnColorsChange(const std::vector<uint64_t> &color, int32_t wallpaperType)
 {
     HILOG_INFO("OnColorsChange start.");
+    WallpaperManager::GetInstance().InvalidatePixelMapCache(wallpaperType);
     if (wallpaperEventListener_ != nullptr) {
         wallpaperEventListener_->OnColorsChange(color, wallpaperType);
     }
@@ -41,6 +43,7 @@ void WallpaperEventListenerClient::OnColorsChange(const std::vector<uint64_t> &c
 void WallpaperEventListenerClient::OnWallpaperChange(
     WallpaperType wallpaperType, WallpaperResourceType resourceType, const std::string &uri)
 {
+    WallpaperManager::GetInstance().InvalidatePixelMapCache(static_cast<int32_t>(wallpaperType));
     if (wallpaperEventListener_ != nullptr) {
         wallpaperEventListener_->OnWallpaperChange(wallpaperType, resourceType, uri);
     }
@@ -17,6 +17,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdint>
 #include <cstdio>
@@ -39,6 +40,7 @@
 #include "image_type.h"
 #include "iservice_registry.h"
 #include "iwallpaper_service.h"
+#include "shared_pixels.h"
 #include "system_ability_definition.h"
 #include "wallpaper_manager.h"
 #include "wallpaper_picture_info_by_parcel.h"
@@ -56,6 +58,10 @@ constexpr int32_t TIME_INTERVAL = 500000;
 constexpr int32_t BASE_NUMBER = 10;
 constexpr int32_t LOAD_TIME = 4;
 constexpr mode_t MODE = 0660;
+constexpr int32_t DEFAULT_WALLPAPER_ID = -1;
+constexpr int32_t MAX_DECODE_EDGE = 16384;
+constexpr int64_t HALF = 2;
+constexpr int32_t MAX_SAMPLE_SIZE = 64;
 
 using namespace OHOS::Media;
 
@@ -93,6 +99,8 @@ void WallpaperManager::ResetService(const wptr<IRemoteObject> &remote)
             wallpaperProxy_ = nullptr;
         }
     }
+    // A restarted service may have lost sets the cached ids were taken from.
+    pixelMapCache_.Clear();
 }
 
 sptr<IWallpaperService> WallpaperManager::GetService()
@@ -182,6 +190,26 @@ ErrorCode WallpaperManager::GetColors(int32_t wallpaperType, const ApiInfo &apiI
     return ConvertIntToErrorCode(wallpaperServerProxy->GetColors(wallpaperType, colors));
 }
 
+ErrorCode WallpaperManager::GetColorPalette(int32_t wallpaperType, WallpaperPalette &palette)
+{
+    auto wallpaperServerProxy = GetService();
+    if (wallpaperServerProxy == nullptr) {
+        HILOG_ERROR("Get proxy failed!");
+        return E_SA_DIED;
+    }
+    std::vector<uint64_t> colors;
+    ErrorCode wallpaperErrorCode = ConvertIntToErrorCode(wallpaperServerProxy->GetColorPalette(wallpaperType, colors));
+    palette = WallpaperPalette();
+    if (wallpaperErrorCode != E_OK || colors.size() < SWATCH_COUNT) {
+        return wallpaperErrorCode;
+    }
+    // The service sends the swatches first, then the dominant colors.
+    palette.swatches.assign(colors.begin(), colors.begin() + SWATCH_COUNT);
+    palette.dominantColors.assign(colors.begin() + SWATCH_COUNT, colors.end());
+    palette.extracted = true;
+    return E_OK;
+}
+
 ErrorCode WallpaperManager::GetFile(int32_t wallpaperType, int32_t &wallpaperFd)
 {
     auto wallpaperServerProxy = GetService();
@@ -248,8 +276,8 @@ ErrorCode WallpaperManager::SetWallpaper(std::string uri, int32_t wallpaperType,
     return wallpaperErrorCode;
 }
 
-ErrorCode WallpaperManager::SetWallpaper(
-    std::shared_ptr<OHOS::Media::PixelMap> pixelMap, int32_t wallpaperType, const ApiInfo &apiInfo)
+ErrorCode WallpaperManager::SetWallpaper(std::shared_ptr<OHOS::Media::PixelMap> pixelMap, int32_t wallpaperType,
+    const ApiInfo &apiInfo, int32_t storageFormat)
 {
     auto wallpaperServerProxy = GetService();
     if (wallpaperServerProxy == nullptr) {
@@ -262,6 +290,21 @@ ErrorCode WallpaperManager::SetWallpaper(
         HILOG_ERROR("pixelMap is nullptr!");
         return E_DEAL_FAILED;
     }
+    int32_t sharedFd = CreateSharedPixels(pixelMap);
+    if (sharedFd >= 0) {
+        if (apiInfo.isSystemApi) {
+            wallpaperErrorCode = ConvertIntToErrorCode(
+                wallpaperServerProxy->SetWallpaperV9BySharedPixels(sharedFd, wallpaperType, storageFormat));
+        } else {
+            wallpaperErrorCode = ConvertIntToErrorCode(
+                wallpaperServerProxy->SetWallpaperBySharedPixels(sharedFd, wallpaperType, storageFormat));
+        }
+        close(sharedFd);
+        if (wallpaperErrorCode == static_cast<int32_t>(E_OK)) {
+            CloseWallpaperFd(wallpaperType);
+        }
+        return wallpaperErrorCode;
+    }
     std::vector<std::uint8_t> value;
     if (!pixelMap->EncodeTlv(value)) {
         HILOG_ERROR("pixelMap encode failed!");
@@ -271,11 +314,11 @@ ErrorCode WallpaperManager::SetWallpaper(
     wallpaperRawData.size = value.size();
     wallpaperRawData.data = value.data();
     if (apiInfo.isSystemApi) {
-        wallpaperErrorCode =
-            ConvertIntToErrorCode(wallpaperServerProxy->SetWallpaperV9ByPixelMap(wallpaperRawData, wallpaperType));
+        wallpaperErrorCode = ConvertIntToErrorCode(
+            wallpaperServerProxy->SetWallpaperV9ByPixelMap(wallpaperRawData, wallpaperType, storageFormat));
     } else {
-        wallpaperErrorCode =
-            ConvertIntToErrorCode(wallpaperServerProxy->SetWallpaperByPixelMap(wallpaperRawData, wallpaperType));
+        wallpaperErrorCode = ConvertIntToErrorCode(
+            wallpaperServerProxy->SetWallpaperByPixelMap(wallpaperRawData, wallpaperType, storageFormat));
     }
     if (wallpaperErrorCode == static_cast<int32_t>(E_OK)) {
         CloseWallpaperFd(wallpaperType);
@@ -283,6 +326,24 @@ ErrorCode WallpaperManager::SetWallpaper(
     return wallpaperErrorCode;
 }
 
+int32_t WallpaperManager::CreateSharedPixels(std::shared_ptr<OHOS::Media::PixelMap> pixelMap)
+{
+    PixelFormat pixelFormat = pixelMap->GetPixelFormat();
+    if ((pixelFormat != PixelFormat::RGBA_8888 && pixelFormat != PixelFormat::BGRA_8888)
+        || pixelMap->GetPixels() == nullptr) {
+        return -1;
+    }
+    SharedPixelsHeader header = {};
+    header.magic = SharedPixels::MAGIC;
+    header.width = pixelMap->GetWidth();
+    header.height = pixelMap->GetHeight();
+    header.pixelFormat = static_cast<int32_t>(pixelFormat);
+    header.alphaType = static_cast<int32_t>(pixelMap->GetAlphaType());
+    header.rowStride = pixelMap->GetRowStride();
+    header.pixelsSize = static_cast<uint64_t>(header.rowStride) * static_cast<uint64_t>(header.height);
+    return SharedPixels::Create(header, pixelMap->GetPixels());
+}
+
 ErrorCode WallpaperManager::SetVideo(const std::string &uri, const int32_t wallpaperType)
 {
     auto wallpaperServerProxy = GetService();
@@ -363,8 +424,89 @@ ErrorCode WallpaperManager::SetCustomWallpaper(const std::string &uri, const int
     return wallpaperErrorCode;
 }
 
-ErrorCode WallpaperManager::GetPixelMap(
-    int32_t wallpaperType, const ApiInfo &apiInfo, std::shared_ptr<OHOS::Media::PixelMap> &pixelMap)
+ErrorCode WallpaperManager::GetPixelMap(int32_t wallpaperType, const ApiInfo &apiInfo,
+    std::shared_ptr<OHOS::Media::PixelMap> &pixelMap, const WallpaperDecodeOptions &options)
+{
+    if (!IsValidDecodeOptions(options)) {
+        return E_PARAMETERS_INVALID;
+    }
+    // Served from the same file as the unfolded portrait variant, so both share one cache entry.
+    PixelMapCacheKey key(wallpaperType, static_cast<int32_t>(FoldState::NORMAL),
+        static_cast<int32_t>(RotateState::PORT), DEFAULT_WALLPAPER_ID, options.desiredWidth,
+        options.desiredHeight, options.pixelFormat, options.fitMode);
+    return GetCachedPixelMap(key,
+        [this, wallpaperType, &apiInfo, &options](std::shared_ptr<OHOS::Media::PixelMap> &decoded) {
+            return GetPixelMapInner(wallpaperType, apiInfo, options, decoded);
+        },
+        pixelMap);
+}
+
+ErrorCode WallpaperManager::GetCachedPixelMap(PixelMapCacheKey key,
+    const std::function<ErrorCode(std::shared_ptr<OHOS::Media::PixelMap> &)> &decode,
+    std::shared_ptr<OHOS::Media::PixelMap> &pixelMap)
+{
+    if (!pixelMapCache_.IsEnabled()) {
+        return decode(pixelMap);
+    }
+    // A hit skips the fetch, so the service checks the caller on every lookup and hands out the id only then.
+    // The id is read before the file is fetched, a set in between can only leave newer pixels under an older id.
+    int32_t wallpaperId = DEFAULT_WALLPAPER_ID;
+    ErrorCode wallpaperErrorCode = CheckWallpaperAccess(std::get<0>(key), wallpaperId);
+    if (wallpaperErrorCode == E_NO_PERMISSION || wallpaperErrorCode == E_NOT_SYSTEM_APP) {
+        HILOG_WARN("Wallpaper access denied, drop the cached decodes.");
+        pixelMapCache_.Clear();
+        return wallpaperErrorCode;
+    }
+    if (wallpaperErrorCode != E_OK || wallpaperId == DEFAULT_WALLPAPER_ID) {
+        return decode(pixelMap);
+    }
+    std::get<3>(key) = wallpaperId;
+    pixelMap = pixelMapCache_.Get(key);
+    if (pixelMap != nullptr) {
+        return E_OK;
+    }
+    std::shared_ptr<OHOS::Media::PixelMap> decoded = nullptr;
+    wallpaperErrorCode = decode(decoded);
+    // Entries only come from a decode the service allowed, once it refuses the caller no cached pixels are served.
+    if (wallpaperErrorCode == E_NO_PERMISSION || wallpaperErrorCode == E_NOT_SYSTEM_APP) {
+        HILOG_WARN("Wallpaper access denied, drop the cached decodes.");
+        pixelMapCache_.Clear();
+    }
+    if (wallpaperErrorCode != E_OK || decoded == nullptr) {
+        pixelMap = decoded;
+        return wallpaperErrorCode;
+    }
+    pixelMap = PixelMapCache::Copy(decoded);
+    if (pixelMap == nullptr) {
+        pixelMap = decoded;
+        return E_OK;
+    }
+    pixelMapCache_.Put(key, decoded);
+    return E_OK;
+}
+
+ErrorCode WallpaperManager::CheckWallpaperAccess(int32_t wallpaperType, int32_t &wallpaperId)
+{
+    auto wallpaperServerProxy = GetService();
+    if (wallpaperServerProxy == nullptr) {
+        HILOG_ERROR("Get proxy failed!");
+        return E_SA_DIED;
+    }
+    return ConvertIntToErrorCode(wallpaperServerProxy->CheckWallpaperAccess(wallpaperType, wallpaperId));
+}
+
+void WallpaperManager::SetPixelMapCacheCapacity(size_t maxBytes)
+{
+    pixelMapCache_.SetCapacity(maxBytes);
+}
+
+void WallpaperManager::InvalidatePixelMapCache(int32_t wallpaperType)
+{
+    pixelMapCache_.Invalidate(wallpaperType);
+}
+
+ErrorCode WallpaperManager::GetPixelMapInner(int32_t wallpaperType, const ApiInfo &apiInfo,
+    const WallpaperDecodeOptions &options, std::shared_ptr<OHOS::Media::PixelMap> &pixelMap)
 {
     HILOG_INFO("FrameWork GetPixelMap Start by FD.");
     auto wallpaperServerProxy = GetService();
@@ -374,21 +516,23 @@ ErrorCode WallpaperManager::GetPixelMap(
     }
     ErrorCode wallpaperErrorCode = E_UNKNOWN;
     int32_t size = 0;
+    bool hasFd = false;
     int32_t fd = -1;
     if (apiInfo.isSystemApi) {
-        wallpaperErrorCode = ConvertIntToErrorCode(wallpaperServerProxy->GetPixelMapV9(wallpaperType, size, fd));
+        wallpaperErrorCode =
+            ConvertIntToErrorCode(wallpaperServerProxy->GetPixelMapV9(wallpaperType, size, hasFd, fd));
     } else {
-        wallpaperErrorCode = ConvertIntToErrorCode(wallpaperServerProxy->GetPixelMap(wallpaperType, size, fd));
+        wallpaperErrorCode = ConvertIntToErrorCode(wallpaperServerProxy->GetPixelMap(wallpaperType, size, hasFd, fd));
     }
     if (wallpaperErrorCode != E_OK) {
         return wallpaperErrorCode;
     }
     // current wallpaper is live video, not image
-    if (size == 0 && fd == -1) { // 0: empty file size; -1: invalid file description
+    if (!hasFd) {
         pixelMap = nullptr;
         return E_OK;
     }
-    wallpaperErrorCode = CreatePixelMapByFd(fd, size, pixelMap);
+    wallpaperErrorCode = CreatePixelMapByFd(fd, size, pixelMap, options);
     if (wallpaperErrorCode != E_OK) {
         pixelMap = nullptr;
         return wallpaperErrorCode;
@@ -396,42 +540,195 @@ ErrorCode WallpaperManager::GetPixelMap(
     return wallpaperErrorCode;
 }
 
-ErrorCode WallpaperManager::CreatePixelMapByFd(
-    int32_t fd, int32_t size, std::shared_ptr<OHOS::Media::PixelMap> &pixelMap)
+bool WallpaperManager::IsValidDecodeOptions(const WallpaperDecodeOptions &options)
+{
+    if (options.desiredWidth < 0 || options.desiredWidth > MAX_DECODE_EDGE || options.desiredHeight < 0
+        || options.desiredHeight > MAX_DECODE_EDGE) {
+        HILOG_ERROR("Invalid desired size %{public}d x %{public}d!", options.desiredWidth, options.desiredHeight);
+        return false;
+    }
+    auto pixelFormat = static_cast<OHOS::Media::PixelFormat>(options.pixelFormat);
+    if (pixelFormat != OHOS::Media::PixelFormat::UNKNOWN && pixelFormat != OHOS::Media::PixelFormat::RGBA_8888
+        && pixelFormat != OHOS::Media::PixelFormat::RGB_565 && pixelFormat != OHOS::Media::PixelFormat::ALPHA_8) {
+        HILOG_ERROR("Unsupported pixel format %{public}d!", options.pixelFormat);
+        return false;
+    }
+    if (options.fitMode < FIT_FILL || options.fitMode > FIT_COVER) {
+        HILOG_ERROR("Invalid fit mode %{public}d!", options.fitMode);
+        return false;
+    }
+    return true;
+}
+
+void WallpaperManager::BuildDecodeOptions(const OHOS::Media::ImageInfo &imageInfo,
+    const WallpaperDecodeOptions &options, OHOS::Media::DecodeOptions &decodeOpts)
+{
+    decodeOpts.desiredPixelFormat = static_cast<OHOS::Media::PixelFormat>(options.pixelFormat);
+    int64_t srcWidth = imageInfo.size.width;
+    int64_t srcHeight = imageInfo.size.height;
+    if ((options.desiredWidth == 0 && options.desiredHeight == 0) || srcWidth <= 0 || srcHeight <= 0) {
+        return;
+    }
+    int64_t width = options.desiredWidth;
+    int64_t height = options.desiredHeight;
+    if (width == 0) {
+        width = std::max<int64_t>(1, height * srcWidth / srcHeight);
+    } else if (height == 0) {
+        height = std::max<int64_t>(1, width * srcHeight / srcWidth);
+    }
+    if (options.fitMode == FIT_CONTAIN) {
+        if (width * srcHeight < height * srcWidth) {
+            height = std::max<int64_t>(1, width * srcHeight / srcWidth);
+        } else {
+            width = std::max<int64_t>(1, height * srcWidth / srcHeight);
+        }
+        if (width > srcWidth) {
+            width = srcWidth;
+            height = srcHeight;
+        }
+    } else if (options.fitMode == FIT_COVER) {
+        int64_t cropWidth = srcWidth;
+        int64_t cropHeight = srcHeight;
+        if (width * srcHeight > height * srcWidth) {
+            cropHeight = std::max<int64_t>(1, srcWidth * height / width);
+        } else {
+            cropWidth = std::max<int64_t>(1, srcHeight * width / height);
+        }
+        decodeOpts.CropRect = { static_cast<int32_t>((srcWidth - cropWidth) / HALF),
+            static_cast<int32_t>((srcHeight - cropHeight) / HALF), static_cast<int32_t>(cropWidth),
+            static_cast<int32_t>(cropHeight) };
+        if (width > cropWidth) {
+            width = cropWidth;
+            height = cropHeight;
+        }
+    }
+    // A desired size lets the JPEG decoder scale in the DCT domain instead of decoding every source pixel.
+    decodeOpts.desiredSize = { static_cast<int32_t>(width), static_cast<int32_t>(height) };
+}
+
+ErrorCode WallpaperManager::CreatePixelMapByFd(int32_t fd, int32_t size,
+    std::shared_ptr<OHOS::Media::PixelMap> &pixelMap, const WallpaperDecodeOptions &options)
 {
     if (size <= 0 || size > MAX_VIDEO_SIZE || fd < 0) {
         HILOG_ERROR("Size or fd error!");
         return E_IMAGE_ERRCODE;
     }
-    uint8_t *buffer = new uint8_t[size];
-    ssize_t bytesRead = read(fd, buffer, size);
-    if (bytesRead < 0) {
-        HILOG_ERROR("Read fd to buffer fail!");
-        delete[] buffer;
+    std::unique_ptr<OHOS::Media::ImageSource> imageSource = CreateImageSourceByFd(fd, size);
+    if (imageSource == nullptr) {
         close(fd);
         return E_IMAGE_ERRCODE;
     }
     uint32_t errorCode = 0;
+    OHOS::Media::DecodeOptions decodeOpts;
+    OHOS::Media::ImageInfo imageInfo;
+    // Only the header is parsed here, the pixels are decoded once at the target size below.
+    if (imageSource->GetImageInfo(0, imageInfo) == 0) {
+        BuildDecodeOptions(imageInfo, options, decodeOpts);
+    }
+    pixelMap = imageSource->CreatePixelMap(decodeOpts, errorCode);
+    // Only the decoded pixels outlive this call, the source and its view of the file go right away.
+    imageSource.reset();
+    close(fd);
+    if (errorCode != 0) {
+        HILOG_ERROR("ImageSource::CreatePixelMap failed, errcode= %{public}d!", errorCode);
+        return E_IMAGE_ERRCODE;
+    }
+    return E_OK;
+}
+
+std::unique_ptr<OHOS::Media::ImageSource> WallpaperManager::CreateImageSourceByFd(int32_t fd, int32_t size)
+{
+    // The image is decoded straight from the fd, the compressed bytes are never copied into the client heap.
+    if (lseek(fd, 0, SEEK_SET) != 0) {
+        HILOG_ERROR("Seek fd fail, errno %{public}d!", errno);
+        return nullptr;
+    }
+    (void)posix_fadvise(fd, 0, size, POSIX_FADV_SEQUENTIAL);
+    uint32_t errorCode = 0;
     OHOS::Media::SourceOptions opts;
     opts.formatHint = "image/jpeg";
     std::unique_ptr<OHOS::Media::ImageSource> imageSource =
-        OHOS::Media::ImageSource::CreateImageSource(buffer, size, opts, errorCode);
+        OHOS::Media::ImageSource::CreateImageSource(fd, opts, errorCode);
     if (errorCode != 0 || imageSource == nullptr) {
         HILOG_ERROR("ImageSource::CreateImageSource failed, errcode= %{public}d!", errorCode);
-        delete[] buffer;
+        return nullptr;
+    }
+    return imageSource;
+}
+
+ErrorCode WallpaperManager::GetWallpaperRegion(int32_t wallpaperType, const WallpaperRegion &region,
+    int32_t sampleSize, std::shared_ptr<OHOS::Media::PixelMap> &pixelMap)
+{
+    if (region.x < 0 || region.y < 0 || region.width <= 0 || region.height <= 0 || sampleSize <= 0
+        || sampleSize > MAX_SAMPLE_SIZE) {
+        HILOG_ERROR("Region or sampleSize invalid!");
+        return E_PARAMETERS_INVALID;
+    }
+    auto wallpaperServerProxy = GetService();
+    if (wallpaperServerProxy == nullptr) {
+        HILOG_ERROR("Get proxy failed!");
+        return E_SA_DIED;
+    }
+    int32_t size = 0;
+    bool hasFd = false;
+    int32_t fd = -1;
+    // The region is taken from the stored portrait picture, the same file GetPixelMap serves.
+    ErrorCode wallpaperErrorCode = ConvertIntToErrorCode(wallpaperServerProxy->GetCorrespondWallpaper(wallpaperType,
+        static_cast<int32_t>(FoldState::NORMAL), static_cast<int32_t>(RotateState::PORT), size, hasFd, fd));
+    if (wallpaperErrorCode != E_OK) {
+        return wallpaperErrorCode;
+    }
+    // current wallpaper is live video, not image
+    if (!hasFd) {
+        pixelMap = nullptr;
+        return E_OK;
+    }
+    wallpaperErrorCode = CreateRegionPixelMapByFd(fd, size, region, sampleSize, pixelMap);
+    if (wallpaperErrorCode != E_OK) {
+        pixelMap = nullptr;
+    }
+    return wallpaperErrorCode;
+}
+
+ErrorCode WallpaperManager::CreateRegionPixelMapByFd(int32_t fd, int32_t size, const WallpaperRegion &region,
+    int32_t sampleSize, std::shared_ptr<OHOS::Media::PixelMap> &pixelMap)
+{
+    if (size <= 0 || size > MAX_VIDEO_SIZE || fd < 0) {
+        HILOG_ERROR("Size or fd error!");
+        return E_IMAGE_ERRCODE;
+    }
+    std::unique_ptr<OHOS::Media::ImageSource> imageSource = CreateImageSourceByFd(fd, size);
+    if (imageSource == nullptr) {
+        close(fd);
+        return E_IMAGE_ERRCODE;
+    }
+    OHOS::Media::ImageInfo imageInfo;
+    if (imageSource->GetImageInfo(0, imageInfo) != 0) {
+        HILOG_ERROR("GetImageInfo failed!");
+        imageSource.reset();
         close(fd);
         return E_IMAGE_ERRCODE;
     }
+    if (static_cast<int64_t>(region.x) + region.width > imageInfo.size.width
+        || static_cast<int64_t>(region.y) + region.height > imageInfo.size.height) {
+        HILOG_ERROR("Region out of the %{public}dx%{public}d picture!", imageInfo.size.width, imageInfo.size.height);
+        imageSource.reset();
+        close(fd);
+        return E_PARAMETERS_INVALID;
+    }
+    // The decoder crops while decoding where the format allows it, so the cost follows the region, not the picture.
     OHOS::Media::DecodeOptions decodeOpts;
+    decodeOpts.CropRect = { region.x, region.y, region.width, region.height };
+    decodeOpts.desiredSize = { (region.width + sampleSize - 1) / sampleSize,
+        (region.height + sampleSize - 1) / sampleSize };
+    uint32_t errorCode = 0;
     pixelMap = imageSource->CreatePixelMap(decodeOpts, errorCode);
+    imageSource.reset();
+    close(fd);
     if (errorCode != 0) {
         HILOG_ERROR("ImageSource::CreatePixelMap failed, errcode= %{public}d!", errorCode);
-        delete[] buffer;
-        close(fd);
         return E_IMAGE_ERRCODE;
     }
-    delete[] buffer;
-    close(fd);
     return E_OK;
 }
 
@@ -837,8 +1134,23 @@ ErrorCode WallpaperManager::GetFdByPath(
     return wallpaperErrorCode;
 }
 
-ErrorCode WallpaperManager::GetCorrespondWallpaper(
-    int32_t wallpaperType, int32_t foldState, int32_t rotateState, std::shared_ptr<OHOS::Media::PixelMap> &pixelMap)
+ErrorCode WallpaperManager::GetCorrespondWallpaper(int32_t wallpaperType, int32_t foldState, int32_t rotateState,
+    std::shared_ptr<OHOS::Media::PixelMap> &pixelMap, const WallpaperDecodeOptions &options)
+{
+    if (!IsValidDecodeOptions(options)) {
+        return E_PARAMETERS_INVALID;
+    }
+    PixelMapCacheKey key(wallpaperType, foldState, rotateState, DEFAULT_WALLPAPER_ID, options.desiredWidth,
+        options.desiredHeight, options.pixelFormat, options.fitMode);
+    return GetCachedPixelMap(key,
+        [this, wallpaperType, foldState, rotateState, &options](std::shared_ptr<OHOS::Media::PixelMap> &decoded) {
+            return GetCorrespondWallpaperInner(wallpaperType, foldState, rotateState, options, decoded);
+        },
+        pixelMap);
+}
+
+ErrorCode WallpaperManager::GetCorrespondWallpaperInner(int32_t wallpaperType, int32_t foldState,
+    int32_t rotateState, const WallpaperDecodeOptions &options, std::shared_ptr<OHOS::Media::PixelMap> &pixelMap)
 {
     HILOG_INFO("GetCorrespondWallpaper start.");
     auto wallpaperServerProxy = GetService();
@@ -848,18 +1160,19 @@ ErrorCode WallpaperManager::GetCorrespondWallpaper(
     }
     ErrorCode wallpaperErrorCode = E_UNKNOWN;
     int32_t size = 0;
+    bool hasFd = false;
     int32_t fd = -1;
     wallpaperErrorCode = ConvertIntToErrorCode(
-        wallpaperServerProxy->GetCorrespondWallpaper(wallpaperType, foldState, rotateState, size, fd));
+        wallpaperServerProxy->GetCorrespondWallpaper(wallpaperType, foldState, rotateState, size, hasFd, fd));
     if (wallpaperErrorCode != E_OK) {
         return wallpaperErrorCode;
     }
     // current wallpaper is live video, not image
-    if (size == 0 && fd == -1) { // 0: empty file size; -1: invalid file description
+    if (!hasFd) {
         pixelMap = nullptr;
         return E_OK;
     }
-    wallpaperErrorCode = CreatePixelMapByFd(fd, size, pixelMap);
+    wallpaperErrorCode = CreatePixelMapByFd(fd, size, pixelMap, options);
     if (wallpaperErrorCode != E_OK) {
         pixelMap = nullptr;
         return wallpaperErrorCode;
@@ -867,6 +1180,129 @@ ErrorCode WallpaperManager::GetCorrespondWallpaper(
     return wallpaperErrorCode;
 }
 
+ErrorCode WallpaperManager::GetAllCorrespondWallpapers(int32_t wallpaperType,
+    std::vector<CorrespondWallpaper> &wallpapers, const WallpaperDecodeOptions &options)
+{
+    if (!IsValidDecodeOptions(options)) {
+        return E_PARAMETERS_INVALID;
+    }
+    auto wallpaperServerProxy = GetService();
+    if (wallpaperServerProxy == nullptr) {
+        HILOG_ERROR("Get proxy failed!");
+        return E_SA_DIED;
+    }
+    std::vector<int32_t> variantInfos;
+    std::vector<int> fds;
+    ErrorCode wallpaperErrorCode =
+        ConvertIntToErrorCode(wallpaperServerProxy->GetAllCorrespondWallpapers(wallpaperType, variantInfos, fds));
+    wallpapers.clear();
+    if (wallpaperErrorCode == E_OK) {
+        wallpaperErrorCode = DecodeCorrespondWallpapers(variantInfos, fds, options, wallpapers);
+    }
+    // CreatePixelMapByFd closes the fds it decodes, whatever is left was never reached.
+    for (int fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    if (wallpaperErrorCode != E_OK) {
+        wallpapers.clear();
+    }
+    return wallpaperErrorCode;
+}
+
+ErrorCode WallpaperManager::DecodeCorrespondWallpapers(const std::vector<int32_t> &variantInfos, std::vector<int> &fds,
+    const WallpaperDecodeOptions &options, std::vector<CorrespondWallpaper> &wallpapers)
+{
+    if (variantInfos.size() % VARIANT_INFO_FIELDS != 0) {
+        HILOG_ERROR("Variant info size %{public}zu invalid!", variantInfos.size());
+        return E_DEAL_FAILED;
+    }
+    std::map<int32_t, int32_t> decodedIndexes;
+    for (size_t i = 0; i < variantInfos.size(); i += VARIANT_INFO_FIELDS) {
+        int32_t fdIndex = variantInfos[i + VARIANT_FD_INDEX];
+        if (fdIndex < 0 || static_cast<size_t>(fdIndex) >= fds.size()) {
+            HILOG_ERROR("Variant fd index %{public}d invalid!", fdIndex);
+            return E_DEAL_FAILED;
+        }
+        CorrespondWallpaper wallpaper;
+        wallpaper.foldState = variantInfos[i + VARIANT_FOLD_STATE];
+        wallpaper.rotateState = variantInfos[i + VARIANT_ROTATE_STATE];
+        wallpaper.wallpaperId = variantInfos[i + VARIANT_WALLPAPER_ID];
+        auto decoded = decodedIndexes.find(fdIndex);
+        if (decoded != decodedIndexes.end()) {
+            wallpaper.aliasOf = decoded->second;
+            wallpaper.pixelMap = wallpapers[decoded->second].pixelMap;
+        } else {
+            // An empty file is rejected before CreatePixelMapByFd, which only closes the fds it accepted.
+            if (variantInfos[i + VARIANT_SIZE] <= 0) {
+                HILOG_ERROR("Variant size invalid!");
+                return E_IMAGE_ERRCODE;
+            }
+            int32_t fd = fds[fdIndex];
+            fds[fdIndex] = -1;
+            ErrorCode wallpaperErrorCode =
+                CreatePixelMapByFd(fd, variantInfos[i + VARIANT_SIZE], wallpaper.pixelMap, options);
+            if (wallpaperErrorCode != E_OK) {
+                return wallpaperErrorCode;
+            }
+            decodedIndexes.emplace(fdIndex, static_cast<int32_t>(wallpapers.size()));
+        }
+        wallpapers.push_back(wallpaper);
+    }
+    return E_OK;
+}
+
+ErrorCode WallpaperManager::GetThumbnail(int32_t wallpaperType, int32_t foldState, int32_t rotateState,
+    int32_t maxEdge, std::shared_ptr<OHOS::Media::PixelMap> &pixelMap)
+{
+    auto wallpaperServerProxy = GetService();
+    if (wallpaperServerProxy == nullptr) {
+        HILOG_ERROR("Get proxy failed!");
+        return E_SA_DIED;
+    }
+    int32_t size = 0;
+    bool hasFd = false;
+    int32_t fd = -1;
+    ErrorCode wallpaperErrorCode = ConvertIntToErrorCode(
+        wallpaperServerProxy->GetThumbnail(wallpaperType, foldState, rotateState, maxEdge, size, hasFd, fd));
+    if (wallpaperErrorCode != E_OK) {
+        return wallpaperErrorCode;
+    }
+    // current wallpaper is live video, not image
+    if (!hasFd) {
+        pixelMap = nullptr;
+        return E_OK;
+    }
+    wallpaperErrorCode = CreatePixelMapByFd(fd, size, pixelMap);
+    if (wallpaperErrorCode != E_OK) {
+        pixelMap = nullptr;
+    }
+    return wallpaperErrorCode;
+}
+
+ErrorCode WallpaperManager::GetWallpaperTexture(int32_t wallpaperType, int32_t foldState, int32_t rotateState,
+    WallpaperTextureInfo &textureInfo, int32_t &textureFd)
+{
+    auto wallpaperServerProxy = GetService();
+    if (wallpaperServerProxy == nullptr) {
+        HILOG_ERROR("Get proxy failed!");
+        return E_SA_DIED;
+    }
+    int32_t size = 0;
+    bool hasFd = false;
+    textureFd = -1;
+    ErrorCode wallpaperErrorCode = ConvertIntToErrorCode(wallpaperServerProxy->GetWallpaperTexture(wallpaperType,
+        foldState, rotateState, size, textureInfo.width, textureInfo.height, textureInfo.blockFormat,
+        textureInfo.mipCount, hasFd, textureFd));
+    // The fd is only sent with a texture, without one the caller decodes the picture.
+    if ((wallpaperErrorCode != E_OK || !hasFd) && textureFd >= 0) {
+        close(textureFd);
+        textureFd = -1;
+    }
+    return wallpaperErrorCode;
+}
+
 void WallpaperManager::CloseWallpaperInfoFd(std::vector<WallpaperPictureInfo> wallpaperPictureInfos)
 {
     for (auto &wallpaperInfo : wallpaperPictureInfos) {
@@ -920,6 +1356,7 @@ std::unordered_map<int32_t, ErrorCode> errorCodeMap = {
     { static_cast<int32_t>(E_NOT_SYSTEM_APP), E_NOT_SYSTEM_APP },
     { static_cast<int32_t>(E_USER_IDENTITY_ERROR), E_USER_IDENTITY_ERROR },
     { static_cast<int32_t>(E_CHECK_DESCRIPTOR_ERROR), E_CHECK_DESCRIPTOR_ERROR },
+    { static_cast<int32_t>(E_SUPERSEDED), E_SUPERSEDED },
 };
 
 ErrorCode WallpaperManager::ConvertIntToErrorCode(int32_t errorCode)
@@ -15,6 +15,7 @@
 
 #ifndef SERVICES_INCLUDE_WALLPAPER_DATA_H
 #define SERVICES_INCLUDE_WALLPAPER_DATA_H
+#include <map>
 #include <string>
 #include <vector>
 
@@ -32,6 +33,12 @@ struct WallpaperData {
     std::string unfoldedOneLandFile; // source image
     std::string unfoldedTwoPortFile; // source image
     std::string unfoldedTwoLandFile; // source image
+    std::map<std::string, uint64_t> fileDigests; // content digest of the committed source images
+    std::string formatHint; // mime type the source image was stored in, empty when unknown
+    std::map<std::string, std::map<int32_t, std::string>> thumbnailFiles; // source image -> long edge -> rendition
+    std::map<std::string, std::string> textureFiles; // source image -> ASTC 4x4 texture sidecar
+    uint64_t mainColor = 0;   // packed main color of wallpaperFile, 0 until loaded or extracted
+    WallpaperPalette palette; // colors of wallpaperFile, palette.extracted is false until extracted
     std::string liveWallpaperFile;   // source video
     std::string customPackageUri;
     std::string cropFile; // eventual destination
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2025 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SERVICES_INCLUDE_WALLPAPER_FD_CACHE_H
+#define SERVICES_INCLUDE_WALLPAPER_FD_CACHE_H
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+#include "wallpaper_handle.h"
+
+namespace OHOS {
+namespace WallpaperMgrService {
+// userId, wallpaperType, foldState, rotateState
+using WallpaperFdKey = std::tuple<int32_t, int32_t, int32_t, int32_t>;
+
+/**
+ * LRU cache of read-only fds of served wallpaper files. A hit is served from a new open of the cached file,
+ * so every caller reads from its own offset instead of sharing one with all other dups of the cached fd.
+ */
+class WallpaperFdCache {
+public:
+    explicit WallpaperFdCache(size_t capacity = 0);
+    ~WallpaperFdCache();
+    WallpaperFdCache(const WallpaperFdCache &) = delete;
+    WallpaperFdCache &operator=(const WallpaperFdCache &) = delete;
+    /**
+     * Evicts down to the new capacity, 0 disables the cache.
+     */
+    void SetCapacity(size_t capacity);
+    /**
+     * Taken before resolving the file to open on a miss, Insert drops the fd if the wallpaper changed since.
+     */
+    uint64_t GetGeneration(int32_t userId, int32_t wallpaperType);
+    bool Acquire(const WallpaperFdKey &key, WallpaperHandle &handle);
+    void Insert(const WallpaperFdKey &key, const WallpaperHandle &handle, uint64_t generation);
+    void Invalidate(int32_t userId, int32_t wallpaperType);
+    void Clear();
+    std::string Dump();
+
+private:
+    struct Entry {
+        WallpaperFdKey key;
+        int32_t fd;
+    };
+    void EraseLocked(std::list<Entry>::iterator entry);
+    void EvictLocked();
+    uint64_t GetGenerationLocked(int32_t userId, int32_t wallpaperType);
+
+    std::mutex mutex_;
+    size_t capacity_;
+    std::list<Entry> entries_; // most recently used first
+    std::map<WallpaperFdKey, std::list<Entry>::iterator> index_;
+    std::map<std::pair<int32_t, int32_t>, uint64_t> generations_;
+    uint64_t clearCount_ = 0;
+    std::atomic<uint64_t> hits_{ 0 };
+    std::atomic<uint64_t> misses_{ 0 };
+};
+} // namespace WallpaperMgrService
+} // namespace OHOS
+#endif // SERVICES_INCLUDE_WALLPAPER_FD_CACHE_H
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2025 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SERVICES_INCLUDE_WALLPAPER_HANDLE_H
+#define SERVICES_INCLUDE_WALLPAPER_HANDLE_H
+#include <cstdint>
+
+namespace OHOS {
+namespace WallpaperMgrService {
+/**
+ * An opened wallpaper file and its size, both taken from the same fd so they always describe one version.
+ * The fd is closed with the handle unless it is released.
+ */
+class WallpaperHandle {
+public:
+    WallpaperHandle() = default;
+    ~WallpaperHandle();
+    WallpaperHandle(const WallpaperHandle &) = delete;
+    WallpaperHandle &operator=(const WallpaperHandle &) = delete;
+    /**
+     * Takes over an fd tagged with WP_DOMAIN and reads its size, the fd is closed if the size is invalid.
+     */
+    bool Attach(int32_t fd);
+    int32_t Release();
+    void Reset();
+    int32_t GetFd() const;
+    int32_t GetSize() const;
+
+private:
+    int32_t fd_ = -1;
+    int32_t size_ = 0;
+};
+} // namespace WallpaperMgrService
+} // namespace OHOS
+#endif // SERVICES_INCLUDE_WALLPAPER_HANDLE_H
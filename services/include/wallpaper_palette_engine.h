@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2025 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SERVICES_INCLUDE_WALLPAPER_PALETTE_ENGINE_H
+#define SERVICES_INCLUDE_WALLPAPER_PALETTE_ENGINE_H
+#include <cstdint>
+#include <vector>
+
+#include "wallpaper_manager_common_info.h"
+
+namespace OHOS {
+namespace WallpaperMgrService {
+struct PaletteColor {
+    uint8_t red = 0;
+    uint8_t green = 0;
+    uint8_t blue = 0;
+    uint32_t population = 0; // 0 for an absent swatch
+};
+
+struct PaletteResult {
+    std::vector<PaletteColor> dominantColors; // most populated first
+    PaletteColor swatches[SWATCH_COUNT];       // indexed by PaletteSwatch
+};
+
+/**
+ * Extracts the dominant colors and the vibrant and muted swatches of a picture. Pixels are quantized into a
+ * 5 bit per channel histogram and k-means runs over the non-empty bins, so the cost past the histogram pass
+ * does not depend on the size of the picture.
+ */
+class WallpaperPaletteEngine {
+public:
+    /**
+     * pixels are RGBA_8888 rows of rowStride bytes, pixels with alpha below one half are ignored.
+     */
+    static bool Extract(const uint8_t *pixels, int32_t width, int32_t height, int32_t rowStride,
+        size_t maxColors, PaletteResult &result);
+
+private:
+    // A histogram bin or a cluster centre, channels in 0..255.
+    struct Cluster {
+        float red = 0.0f;
+        float green = 0.0f;
+        float blue = 0.0f;
+        uint32_t population = 0;
+    };
+    static void BuildHistogram(
+        const uint8_t *pixels, int32_t width, int32_t height, int32_t rowStride, std::vector<uint32_t> &histogram);
+    static std::vector<Cluster> CollectBins(const std::vector<uint32_t> &histogram);
+    static std::vector<Cluster> SeedClusters(const std::vector<Cluster> &bins, size_t maxColors);
+    static void RefineClusters(const std::vector<Cluster> &bins, std::vector<Cluster> &clusters);
+    static void PickSwatches(const std::vector<PaletteColor> &colors, PaletteResult &result);
+};
+} // namespace WallpaperMgrService
+} // namespace OHOS
+#endif // SERVICES_INCLUDE_WALLPAPER_PALETTE_ENGINE_H
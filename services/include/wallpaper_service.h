@@ -17,9 +17,12 @@
 #define SERVICES_INCLUDE_WALLPAPER_SERVICES_H
 
 #include <atomic>
+#include <functional>
 #include <list>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
 
 #include "accesstoken_kit.h"
 #include "component_name.h"
@@ -28,16 +31,21 @@
 #include "fault_reporter.h"
 #include "file_deal.h"
 #include "i_wallpaper_manager_callback.h"
+#include "image_packer.h"
 #include "image_source.h"
 #include "ipc_skeleton.h"
 #include "iwallpaper_service.h"
 #include "os_account_manager.h"
 #include "pixel_map.h"
+#include "shared_pixels.h"
 #include "system_ability.h"
+#include "thread_pool.h"
 #include "wallpaper_common.h"
 #include "wallpaper_common_event_subscriber.h"
 #include "wallpaper_data.h"
 #include "wallpaper_event_listener.h"
+#include "wallpaper_fd_cache.h"
+#include "wallpaper_handle.h"
 #include "wallpaper_manager_common_info.h"
 #include "wallpaper_service_stub.h"
 
@@ -47,15 +55,17 @@
 #include "wallpaper_extension_ability_connection.h"
 #endif
 namespace OHOS {
-namespace ColorManager {
-class Color;
-}
 namespace WallpaperMgrService {
 class WallpaperService : public SystemAbility, public WallpaperServiceStub {
     DECLARE_SYSTEM_ABILITY(WallpaperService);
     enum class ServiceRunningState { STATE_NOT_START, STATE_RUNNING };
     enum class FileType : uint8_t { WALLPAPER_FILE, CROP_FILE };
     using WallpaperListenerMap = std::map<int32_t, sptr<IWallpaperEventListener>>;
+    struct StagedThumbnail {
+        std::string sourceFile;
+        int32_t longEdge;
+        std::string stagingPath;
+    };
 
 public:
     DISALLOW_COPY_AND_MOVE(WallpaperService);
@@ -67,13 +77,22 @@ public:
     ErrCode SetWallpaper(int fd, int32_t wallpaperType, int32_t length) override;
     ErrCode SetAllWallpapers(const WallpaperPictureInfoByParcel &wallpaperPictureInfoByParcel, int32_t wallpaperType,
         const std::vector<int> &fdVector) override;
-    ErrCode SetWallpaperByPixelMap(const WallpaperRawData &wallpaperRawdata, int32_t wallpaperType) override;
-    ErrCode GetPixelMap(int32_t wallpaperType, int32_t &size, int &fd) override;
-    ErrCode GetCorrespondWallpaper(
-        int32_t wallpaperType, int32_t foldState, int32_t rotateState, int32_t &size, int &fd) override;
+    ErrCode SetWallpaperByPixelMap(
+        const WallpaperRawData &wallpaperRawdata, int32_t wallpaperType, int32_t storageFormat) override;
+    ErrCode GetPixelMap(int32_t wallpaperType, int32_t &size, bool &hasFd, int &fd) override;
+    ErrCode GetCorrespondWallpaper(int32_t wallpaperType, int32_t foldState, int32_t rotateState, int32_t &size,
+        bool &hasFd, int &fd) override;
+    ErrCode GetAllCorrespondWallpapers(
+        int32_t wallpaperType, std::vector<int32_t> &variantInfos, std::vector<int> &fds) override;
+    ErrCode GetThumbnail(int32_t wallpaperType, int32_t foldState, int32_t rotateState, int32_t maxEdge,
+        int32_t &size, bool &hasFd, int &fd) override;
+    ErrCode GetWallpaperTexture(int32_t wallpaperType, int32_t foldState, int32_t rotateState, int32_t &size,
+        int32_t &width, int32_t &height, int32_t &blockFormat, int32_t &mipCount, bool &hasFd,
+        int &fd) override;
     ErrCode GetColors(int32_t wallpaperType, std::vector<uint64_t> &colors) override;
     ErrCode GetFile(int32_t wallpaperType, int &wallpaperFd) override;
     ErrCode GetWallpaperId(int32_t wallpaperType) override;
+    ErrCode CheckWallpaperAccess(int32_t wallpaperType, int32_t &wallpaperId) override;
     ErrCode IsChangePermitted(bool &isChangePermitted) override;
     ErrCode IsOperationAllowed(bool &isOperationAllowed) override;
     ErrCode ResetWallpaper(int32_t wallpaperType) override;
@@ -82,9 +101,13 @@ public:
     ErrCode RegisterWallpaperCallback(
         const sptr<IWallpaperCallback> &wallpaperCallback, bool &registerWallpaperCallback) override;
     ErrCode SetWallpaperV9(int fd, int32_t wallpaperType, int32_t length) override;
-    ErrCode SetWallpaperV9ByPixelMap(const WallpaperRawData &wallpaperRawdata, int32_t wallpaperType) override;
-    ErrCode GetPixelMapV9(int32_t wallpaperType, int32_t &size, int &fd) override;
+    ErrCode SetWallpaperV9ByPixelMap(
+        const WallpaperRawData &wallpaperRawdata, int32_t wallpaperType, int32_t storageFormat) override;
+    ErrCode SetWallpaperBySharedPixels(int fd, int32_t wallpaperType, int32_t storageFormat) override;
+    ErrCode SetWallpaperV9BySharedPixels(int fd, int32_t wallpaperType, int32_t storageFormat) override;
+    ErrCode GetPixelMapV9(int32_t wallpaperType, int32_t &size, bool &hasFd, int &fd) override;
     ErrCode GetColorsV9(int32_t wallpaperType, std::vector<uint64_t> &colors) override;
+    ErrCode GetColorPalette(int32_t wallpaperType, std::vector<uint64_t> &palette) override;
     ErrCode ResetWallpaperV9(int32_t wallpaperType) override;
     ErrCode SetVideo(int fd, int32_t wallpaperType, int32_t length) override;
     ErrCode SetCustomWallpaper(int fd, int32_t wallpaperType, int32_t length) override;
@@ -113,29 +136,99 @@ private:
     void InitData();
     void InitQueryUserId(int32_t times);
     bool InitUsersOnBoot();
-    bool CompareColor(const uint64_t &localColor, const ColorManager::Color &color);
     bool SaveColor(int32_t userId, WallpaperType wallpaperType);
+    bool ExtractPalette(OHOS::Media::PixelMap &pixelMap, WallpaperPalette &palette);
+    static uint64_t PackColor(uint32_t argb);
+    static uint32_t UnpackColor(uint64_t color);
+    bool GetFileDigest(const WallpaperData &wallpaperData, const std::string &filePath, uint64_t &digest);
+    bool CommitColors(int32_t userId, WallpaperType wallpaperType, int32_t wallpaperId, uint64_t sourceDigest,
+        uint64_t mainColor, const WallpaperPalette &palette);
+    bool SaveWallpaperColors(int32_t userId);
+    void LoadWallpaperColors(int32_t userId, WallpaperType wallpaperType, WallpaperData &wallpaperData);
+    std::string GetFormatHint(int32_t userId, WallpaperType wallpaperType);
+    void PostSaveColorTask(int32_t userId, WallpaperType wallpaperType);
+    void PostRenditionTask(int32_t userId, WallpaperType wallpaperType);
+    bool GenerateRenditions(int32_t userId, WallpaperType wallpaperType);
+    void CommitRenditions(bool current, const std::vector<StagedThumbnail> &stagedThumbnails,
+        const std::map<std::string, std::string> &stagedTextures, WallpaperData &wallpaperData);
+    bool StageThumbnails(const std::string &sourceFile, const std::string &formatHint,
+        std::vector<StagedThumbnail> &stagedThumbnails);
+    bool WriteRenditionFile(std::shared_ptr<OHOS::Media::PixelMap> pixelMap, const std::string &filePath,
+        const OHOS::Media::PackOption &option);
+    std::string GetThumbnailFile(const std::string &sourceFile, int32_t longEdge);
+    void LoadThumbnailFiles(const std::string &wallpaperDir, WallpaperData &wallpaperData);
+    std::string PickThumbnailFile(const WallpaperData &wallpaperData, const std::string &sourceFile, int32_t maxEdge);
+    bool GetThumbnailPath(const WallpaperData &wallpaperData, std::string &filePathName, int32_t foldState,
+        int32_t rotateState, int32_t maxEdge);
+    bool IsTextureSidecarEnabled();
+    bool StageTexture(const std::string &sourceFile, const std::string &formatHint, std::string &stagingPath);
+    std::string GetTextureFile(const std::string &sourceFile);
+    void LoadTextureFiles(WallpaperData &wallpaperData);
+    bool ReadTextureHeader(int32_t fd, WallpaperTextureInfo &textureInfo);
+    bool GetTexturePath(
+        const WallpaperData &wallpaperData, std::string &filePathName, int32_t foldState, int32_t rotateState);
     void UpdataWallpaperMap(int32_t userId, WallpaperType wallpaperType);
     std::string GetWallpaperDir(int32_t userId, WallpaperType wallpaperType);
     bool GetFileNameFromMap(int32_t userId, WallpaperType wallpaperType, std::string &fileName);
+    bool GetFileNameFromData(const WallpaperData &wallpaperData, std::string &fileName);
     bool GetPictureFileName(int32_t userId, WallpaperType wallpaperType, std::string &fileName);
     bool GetWallpaperSafeLocked(int32_t userId, WallpaperType wallpaperType, WallpaperData &wallpaperData);
     void ClearWallpaperLocked(int32_t userId, WallpaperType wallpaperType);
     ErrorCode SetDefaultDataForWallpaper(int32_t userId, WallpaperType wallpaperType);
     int32_t MakeWallpaperIdLocked();
+    std::shared_ptr<std::mutex> GetWallpaperLock(int32_t userId, WallpaperType wallpaperType);
+    std::shared_ptr<std::shared_mutex> GetPublishLock(int32_t userId, WallpaperType wallpaperType);
+    void RemoveWallpaperLocks(int32_t userId);
+    uint64_t IssueSetTicket(int32_t userId, WallpaperType wallpaperType);
+    bool IsSetSuperseded(int32_t userId, WallpaperType wallpaperType, uint64_t ticket);
+    std::string MakeStagingPath();
+    void RecoverWallpaperDir(int32_t userId, WallpaperType wallpaperType);
+    bool WriteWallpaperManifest(const std::string &dirPath, const WallpaperData &wallpaperData);
+    bool ReadWallpaperManifest(const std::string &dirPath, int32_t &wallpaperId, std::string &formatHint);
+    std::string GetVersionedFile(const std::string &filePath, int32_t wallpaperId);
+    bool FindCommittedVersion(const std::string &dirPath, const std::string &baseName, int32_t &version);
+    std::vector<std::string> GetWallpaperDataFiles(const WallpaperData &wallpaperData);
+    std::string GetVariantName(FoldState foldState, RotateState rotateState);
+    std::map<std::string, std::string> GetWallpaperVariantFiles(const WallpaperData &wallpaperData);
+    bool IsWallpaperUnchanged(int32_t userId, WallpaperType wallpaperType, WallpaperResourceType resourceType,
+        const std::map<std::string, uint64_t> &digests);
+    void SetWallpaperDigests(WallpaperData &wallpaperData, const std::map<std::string, uint64_t> &digests);
+    ErrorCode OpenWallpaperFile(int32_t userId, WallpaperType wallpaperType,
+        const std::function<bool(const WallpaperData &, std::string &)> &getFilePath, int32_t &fd);
+    ErrorCode OpenWallpaperHandle(int32_t userId, WallpaperType wallpaperType,
+        const std::function<bool(const WallpaperData &, std::string &)> &getFilePath, WallpaperHandle &handle);
+    ErrorCode OpenCachedWallpaperHandle(const WallpaperFdKey &key,
+        const std::function<bool(const WallpaperData &, std::string &)> &getFilePath, WallpaperHandle &handle);
+    ErrorCode GetWallpaperHandle(int32_t wallpaperType, WallpaperHandle &handle);
+    ErrorCode GetCorrespondWallpaperHandle(
+        int32_t wallpaperType, int32_t foldState, int32_t rotateState, WallpaperHandle &handle);
+    ErrorCode GetAllCorrespondWallpaperHandles(int32_t wallpaperType, std::vector<int32_t> &variantInfos,
+        std::vector<std::unique_ptr<WallpaperHandle>> &handles);
+    ErrorCode OpenWallpaperVariants(const WallpaperData &wallpaperData, std::vector<int32_t> &variantInfos,
+        std::vector<std::unique_ptr<WallpaperHandle>> &handles);
+    ErrorCode GetThumbnailHandle(
+        int32_t wallpaperType, int32_t foldState, int32_t rotateState, int32_t maxEdge, WallpaperHandle &handle);
+    ErrorCode GetWallpaperTextureHandle(int32_t wallpaperType, int32_t foldState, int32_t rotateState,
+        WallpaperHandle &handle, WallpaperTextureInfo &textureInfo);
     bool CheckCallingPermission(const std::string &permissionName);
     ErrorCode SetWallpaperBackupData(int32_t userId, WallpaperResourceType resourceType,
-        const std::string &uriOrPixelMap, WallpaperType wallpaperType);
+        const std::string &uriOrPixelMap, WallpaperType wallpaperType, const std::string &formatHint,
+        const std::map<std::string, uint64_t> &digests);
     ErrorCode WritePixelMapToFile(std::shared_ptr<OHOS::Media::PixelMap> pixelMap, std::string wallpaperTmpFullPath,
-        int32_t wallpaperType, WallpaperResourceType resourceType);
-    int64_t WritePixelMapToStream(std::shared_ptr<OHOS::Media::PixelMap> pixelMap, std::ostream &outputStream);
+        int32_t wallpaperType, WallpaperResourceType resourceType, const OHOS::Media::PackOption &option,
+        uint64_t &digest);
+    int64_t WritePixelMapToStream(std::shared_ptr<OHOS::Media::PixelMap> pixelMap, std::ostream &outputStream,
+        const OHOS::Media::PackOption &option);
+    static bool IsPackFormatSupported(const std::string &format);
+    bool GetStoragePackOption(int32_t storageFormat, OHOS::Media::PackOption &option);
+    std::shared_ptr<OHOS::Media::PixelMap> CreatePixelMapBySharedPixels(int32_t fd);
+    std::shared_ptr<OHOS::Media::PixelMap> WrapSharedPixels(std::shared_ptr<SharedPixels> sharedPixels);
 #ifndef THEME_SERVICE
     bool ConnectExtensionAbility();
 #endif
     bool IsSystemApp();
     bool IsNativeSa();
     ErrorCode GetImageFd(int32_t userId, WallpaperType wallpaperType, int32_t &fd);
-    ErrorCode GetImageSize(int32_t userId, WallpaperType wallpaperType, int32_t &size);
     bool RestoreUserResources(int32_t userId, WallpaperData &wallpaperData, WallpaperType wallpaperType);
     bool InitUserDir(int32_t userId);
     int32_t QueryActiveUserId();
@@ -143,9 +236,9 @@ private:
 
     bool SendWallpaperChangeEvent(int32_t userId, WallpaperType wallpaperType);
     ErrorCode SetWallpaper(int32_t fd, int32_t wallpaperType, int32_t length, WallpaperResourceType resourceType);
-    ErrorCode SetWallpaperByPixelMap(
-        std::shared_ptr<OHOS::Media::PixelMap> pixelMap, int32_t wallpaperType, WallpaperResourceType resourceType);
-    void OnColorsChange(WallpaperType wallpaperType, const ColorManager::Color &color);
+    ErrorCode SetWallpaperByPixelMap(std::shared_ptr<OHOS::Media::PixelMap> pixelMap, int32_t wallpaperType,
+        WallpaperResourceType resourceType, int32_t storageFormat);
+    void OnColorsChange(WallpaperType wallpaperType, uint64_t color);
     ErrorCode CheckValid(int32_t wallpaperType, int32_t length, WallpaperResourceType resourceType);
     bool WallpaperChanged(WallpaperType wallpaperType, WallpaperResourceType resType, const std::string &uri);
     void NotifyColorChange(const std::vector<uint64_t> &colors, const WallpaperType &wallpaperType);
@@ -162,29 +255,35 @@ private:
     std::string GetExistFilePath(const std::string &filePath);
     ErrorCode SetAllWallpapers(
         std::vector<WallpaperPictureInfo> allWallpaperInfo, int32_t wallpaperType, WallpaperResourceType resourceType);
-    ErrorCode WriteFdToFile(WallpaperPictureInfo &wallpaperPictureInfo, std::string &path);
-    ErrorCode SetAllWallpaperBackupData(std::vector<WallpaperPictureInfo> allWallpaperInfos, int32_t userId,
-        WallpaperType wallpaperType, WallpaperData &wallpaperData);
-    std::string GetWallpaperDataFile(
-        WallpaperPictureInfo &wallpaperPictureInfo, int32_t userId, WallpaperType wallpaperType);
-    ErrorCode GetImageSize(
-        int32_t userId, WallpaperType wallpaperType, int32_t &size, int32_t foldState, int32_t rotateState);
-    bool GetWallpaperDataPath(int32_t userId, WallpaperType wallpaperType, std::string &filePathName,
-        int32_t foldState, int32_t rotateState);
-    ErrorCode GetImageFd(
-        int32_t userId, WallpaperType wallpaperType, int32_t &fd, int32_t foldState, int32_t rotateState);
+    ErrorCode WriteFdToFile(
+        WallpaperPictureInfo &wallpaperPictureInfo, std::string &path, DurabilityMode mode, uint64_t &digest);
+    int32_t GetIntParameter(const char *key, int32_t defaultValue);
+    int32_t GetIngestParallelism();
+    void StartIngestPool();
+    ErrorCode IngestWallpaperInfos(
+        std::vector<WallpaperPictureInfo> &allWallpaperInfos, std::map<std::string, uint64_t> &digests);
+    ErrorCode SetAllWallpaperBackupData(std::vector<WallpaperPictureInfo> allWallpaperInfos,
+        const std::string &stagingDir, int32_t userId, WallpaperType wallpaperType, WallpaperData &wallpaperData);
+    std::string GetWallpaperDataFile(WallpaperPictureInfo &wallpaperPictureInfo, int32_t userId,
+        WallpaperType wallpaperType, int32_t wallpaperId);
+    bool FindWallpaperData(int32_t userId, WallpaperType wallpaperType, WallpaperData &wallpaperData);
     void DeleteTempResource(std::vector<WallpaperPictureInfo> &tempResourceFiles);
     void UpdateWallpaperDataFile(WallpaperPictureInfo &wallpaperPictureInfo, int32_t userId,
         WallpaperType wallpaperType, WallpaperData &wallpaperData);
-    ErrorCode UpdateWallpaperData(
-        std::vector<WallpaperPictureInfo> allWallpaperInfos, int32_t userId, WallpaperType wallpaperType);
+    ErrorCode UpdateWallpaperData(std::vector<WallpaperPictureInfo> allWallpaperInfos, int32_t userId,
+        WallpaperType wallpaperType, const std::map<std::string, uint64_t> &digests);
     std::string GetWallpaperPath(WallpaperData wallpaperData);
     void ClearnWallpaperDataFile(WallpaperData &wallpaperData);
     std::string GetFoldStateName(FoldState foldState);
     std::string GetRotateStateName(RotateState rotateState);
-    std::string GetWallpaperPath(int32_t foldState, int32_t rotateState, WallpaperData &wallpaperData);
-    int32_t GetPixleMapParcel(MessageParcel &data, MessageParcel &reply, bool isSystemApi);
+    std::string GetWallpaperPath(int32_t foldState, int32_t rotateState, const WallpaperData &wallpaperData);
+    int32_t GetPixleMapParcel(MessageParcel &data, MessageParcel &reply);
     int32_t GetCorrespondWallpaperParcel(MessageParcel &data, MessageParcel &reply);
+    int32_t GetAllCorrespondWallpapersParcel(MessageParcel &data, MessageParcel &reply);
+    int32_t GetThumbnailParcel(MessageParcel &data, MessageParcel &reply);
+    int32_t GetWallpaperTextureParcel(MessageParcel &data, MessageParcel &reply);
+    int32_t WriteWallpaperHandle(MessageParcel &reply, ErrCode errCode, const WallpaperHandle &handle);
+    bool WriteHandleFd(MessageParcel &reply, const WallpaperHandle &handle);
     int32_t GetFileParcel(MessageParcel &data, MessageParcel &reply);
     int32_t SetwallpaperByPixelMapParcel(MessageParcel &data, MessageParcel &reply, bool isSystemApi);
     void CloseVectorFd(const std::vector<int> &fdVector);
@@ -213,6 +312,16 @@ private:
     std::mutex callbackProxyMutex_;
 
     std::mutex mtx_;
+    std::mutex wallpaperLockMapMutex_;
+    WallpaperFdCache wallpaperFdCache_;
+    std::map<std::pair<int32_t, WallpaperType>, std::shared_ptr<std::mutex>> wallpaperLockMap_;
+    // Taken shared to resolve a path and open it, exclusively to move or delete the files the map points at.
+    std::map<std::pair<int32_t, WallpaperType>, std::shared_ptr<std::shared_mutex>> publishLockMap_;
+    std::map<std::pair<int32_t, WallpaperType>, uint64_t> setTicketMap_;
+    atomic<uint64_t> stagingId_{ 0 };
+    std::once_flag ingestPoolOnce_;
+    ThreadPool ingestPool_{ "WpIngest" };
+    // Last main colors sent to colorChange listeners, GetColors serves the colors of the active user's data.
     uint64_t lockWallpaperColor_;
     uint64_t systemWallpaperColor_;
     std::map<std::string, WallpaperListenerMap> wallpaperEventMap_;
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2025 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "wallpaper_fd_cache.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#include "hilog_wrapper.h"
+
+namespace OHOS {
+namespace WallpaperMgrService {
+constexpr const char *PROC_SELF_FD = "/proc/self/fd/";
+
+WallpaperFdCache::WallpaperFdCache(size_t capacity) : capacity_(capacity)
+{
+}
+
+WallpaperFdCache::~WallpaperFdCache()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!entries_.empty()) {
+        EraseLocked(entries_.begin());
+    }
+}
+
+void WallpaperFdCache::SetCapacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    EvictLocked();
+}
+
+uint64_t WallpaperFdCache::GetGeneration(int32_t userId, int32_t wallpaperType)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return GetGenerationLocked(userId, wallpaperType);
+}
+
+uint64_t WallpaperFdCache::GetGenerationLocked(int32_t userId, int32_t wallpaperType)
+{
+    // Both counters only grow, so their sum changes whenever either of them does.
+    auto generation = generations_.find(std::make_pair(userId, wallpaperType));
+    return (generation == generations_.end() ? 0 : generation->second) + clearCount_;
+}
+
+bool WallpaperFdCache::Acquire(const WallpaperFdKey &key, WallpaperHandle &handle)
+{
+    int32_t cachedFd = -1;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (capacity_ == 0) {
+            return false;
+        }
+        auto entry = index_.find(key);
+        if (entry == index_.end()) {
+            misses_++;
+            return false;
+        }
+        entries_.splice(entries_.begin(), entries_, entry->second);
+        // Pins the file while it is reopened outside the lock, an eviction meanwhile can not recycle the number.
+        cachedFd = dup(entry->second->fd);
+    }
+    if (cachedFd < 0) {
+        HILOG_ERROR("dup cached fd failed, errno %{public}d", errno);
+        misses_++;
+        return false;
+    }
+    int32_t fd = open((PROC_SELF_FD + std::to_string(cachedFd)).c_str(), O_RDONLY);
+    close(cachedFd);
+    if (fd < 0) {
+        HILOG_ERROR("reopen cached fd failed, errno %{public}d", errno);
+        misses_++;
+        return false;
+    }
+    fdsan_exchange_owner_tag(fd, 0, WP_DOMAIN);
+    if (!handle.Attach(fd)) {
+        misses_++;
+        return false;
+    }
+    hits_++;
+    return true;
+}
+
+void WallpaperFdCache::Insert(const WallpaperFdKey &key, const WallpaperHandle &handle, uint64_t generation)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (capacity_ == 0 || handle.GetFd() < 0
+        || generation != GetGenerationLocked(std::get<0>(key), std::get<1>(key))) {
+        return;
+    }
+    int32_t fd = dup(handle.GetFd());
+    if (fd < 0) {
+        HILOG_ERROR("dup served fd failed, errno %{public}d", errno);
+        return;
+    }
+    fdsan_exchange_owner_tag(fd, 0, WP_DOMAIN);
+    auto entry = index_.find(key);
+    if (entry != index_.end()) {
+        EraseLocked(entry->second);
+    }
+    entries_.push_front({ key, fd });
+    index_[key] = entries_.begin();
+    EvictLocked();
+}
+
+void WallpaperFdCache::Invalidate(int32_t userId, int32_t wallpaperType)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    generations_[std::make_pair(userId, wallpaperType)]++;
+    for (auto entry = entries_.begin(); entry != entries_.end();) {
+        auto current = entry++;
+        if (std::get<0>(current->key) == userId && std::get<1>(current->key) == wallpaperType) {
+            EraseLocked(current);
+        }
+    }
+}
+
+void WallpaperFdCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    clearCount_++;
+    while (!entries_.empty()) {
+        EraseLocked(entries_.begin());
+    }
+}
+
+std::string WallpaperFdCache::Dump()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return "WallpaperFdCache\t: hits=" + std::to_string(hits_.load()) + ", misses=" + std::to_string(misses_.load())
+           + ", entries=" + std::to_string(entries_.size()) + ", capacity=" + std::to_string(capacity_) + "\n";
+}
+
+void WallpaperFdCache::EraseLocked(std::list<Entry>::iterator entry)
+{
+    fdsan_close_with_tag(entry->fd, WP_DOMAIN);
+    index_.erase(entry->key);
+    entries_.erase(entry);
+}
+
+void WallpaperFdCache::EvictLocked()
+{
+    while (entries_.size() > capacity_) {
+        EraseLocked(std::prev(entries_.end()));
+    }
+}
+} // namespace WallpaperMgrService
+} // namespace OHOS
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2025 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "wallpaper_handle.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+
+#include "hilog_wrapper.h"
+
+namespace OHOS {
+namespace WallpaperMgrService {
+WallpaperHandle::~WallpaperHandle()
+{
+    Reset();
+}
+
+bool WallpaperHandle::Attach(int32_t fd)
+{
+    Reset();
+    fd_ = fd;
+    struct stat fileStat = {};
+    if (fstat(fd_, &fileStat) != 0 || fileStat.st_size <= 0 || fileStat.st_size > INT32_MAX) {
+        HILOG_ERROR("fstat file failed or size invalid, errno %{public}d", errno);
+        Reset();
+        return false;
+    }
+    size_ = static_cast<int32_t>(fileStat.st_size);
+    return true;
+}
+
+int32_t WallpaperHandle::Release()
+{
+    int32_t fd = fd_;
+    fd_ = -1;
+    size_ = 0;
+    return fd;
+}
+
+void WallpaperHandle::Reset()
+{
+    if (fd_ >= 0) {
+        fdsan_close_with_tag(fd_, WP_DOMAIN);
+    }
+    fd_ = -1;
+    size_ = 0;
+}
+
+int32_t WallpaperHandle::GetFd() const
+{
+    return fd_;
+}
+
+int32_t WallpaperHandle::GetSize() const
+{
+    return size_;
+}
+} // namespace WallpaperMgrService
+} // namespace OHOS
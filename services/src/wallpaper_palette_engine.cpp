@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2025 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "wallpaper_palette_engine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "hilog_wrapper.h"
+
+namespace OHOS {
+namespace WallpaperMgrService {
+constexpr uint32_t QUANT_BITS = 5;
+constexpr uint32_t QUANT_SHIFT = 8 - QUANT_BITS;
+constexpr uint32_t QUANT_MASK = (1 << QUANT_BITS) - 1;
+constexpr size_t HISTOGRAM_SIZE = 1 << (QUANT_BITS * 3);
+constexpr uint32_t BIN_CENTER = 1 << (QUANT_SHIFT - 1);
+constexpr uint32_t ALPHA_SHIFT = 7;
+constexpr int32_t BYTES_PER_PIXEL = 4;
+constexpr int32_t RED_OFFSET = 0;
+constexpr int32_t GREEN_OFFSET = 1;
+constexpr int32_t BLUE_OFFSET = 2;
+constexpr int32_t ALPHA_OFFSET = 3;
+constexpr float MIN_SEED_DISTANCE = 32.0f;
+constexpr int32_t MAX_REFINE_ITERATIONS = 8;
+constexpr float MAX_CHANNEL = 255.0f;
+constexpr float HALF = 0.5f;
+constexpr float SATURATION_WEIGHT = 0.24f;
+constexpr float LIGHTNESS_WEIGHT = 0.52f;
+constexpr float POPULATION_WEIGHT = 0.24f;
+
+namespace {
+struct SwatchTarget {
+    float minSaturation;
+    float targetSaturation;
+    float maxSaturation;
+    float minLightness;
+    float targetLightness;
+    float maxLightness;
+};
+
+// Indexed by PaletteSwatch, vibrant targets are filled first so muted swatches take what is left.
+constexpr SwatchTarget SWATCH_TARGETS[SWATCH_COUNT] = {
+    { 0.35f, 1.0f, 1.0f, 0.3f, 0.5f, 0.7f },   // SWATCH_VIBRANT
+    { 0.35f, 1.0f, 1.0f, 0.55f, 0.74f, 1.0f }, // SWATCH_LIGHT_VIBRANT
+    { 0.35f, 1.0f, 1.0f, 0.0f, 0.26f, 0.45f }, // SWATCH_DARK_VIBRANT
+    { 0.0f, 0.3f, 0.4f, 0.3f, 0.5f, 0.7f },    // SWATCH_MUTED
+    { 0.0f, 0.3f, 0.4f, 0.55f, 0.74f, 1.0f },  // SWATCH_LIGHT_MUTED
+    { 0.0f, 0.3f, 0.4f, 0.0f, 0.26f, 0.45f },  // SWATCH_DARK_MUTED
+};
+
+float SquaredDistance(float red, float green, float blue, float otherRed, float otherGreen, float otherBlue)
+{
+    float deltaRed = red - otherRed;
+    float deltaGreen = green - otherGreen;
+    float deltaBlue = blue - otherBlue;
+    return deltaRed * deltaRed + deltaGreen * deltaGreen + deltaBlue * deltaBlue;
+}
+
+void ToHsl(const PaletteColor &color, float &saturation, float &lightness)
+{
+    float red = color.red / MAX_CHANNEL;
+    float green = color.green / MAX_CHANNEL;
+    float blue = color.blue / MAX_CHANNEL;
+    float maxChannel = std::max({ red, green, blue });
+    float minChannel = std::min({ red, green, blue });
+    lightness = (maxChannel + minChannel) * HALF;
+    float chroma = maxChannel - minChannel;
+    saturation = chroma <= 0.0f ? 0.0f : chroma / (1.0f - std::fabs(2.0f * lightness - 1.0f));
+}
+
+uint8_t ToChannel(float value)
+{
+    return static_cast<uint8_t>(std::clamp(std::lround(value), 0L, static_cast<long>(MAX_CHANNEL)));
+}
+} // namespace
+
+bool WallpaperPaletteEngine::Extract(const uint8_t *pixels, int32_t width, int32_t height, int32_t rowStride,
+    size_t maxColors, PaletteResult &result)
+{
+    result = PaletteResult();
+    if (pixels == nullptr || width <= 0 || height <= 0 || rowStride / BYTES_PER_PIXEL < width || maxColors == 0) {
+        HILOG_ERROR("Invalid palette input %{public}dx%{public}d, stride %{public}d", width, height, rowStride);
+        return false;
+    }
+    std::vector<uint32_t> histogram;
+    BuildHistogram(pixels, width, height, rowStride, histogram);
+    std::vector<Cluster> bins = CollectBins(histogram);
+    if (bins.empty()) {
+        HILOG_ERROR("No opaque pixel to build a palette from.");
+        return false;
+    }
+    std::vector<Cluster> clusters = SeedClusters(bins, maxColors);
+    RefineClusters(bins, clusters);
+    std::sort(clusters.begin(), clusters.end(),
+        [](const Cluster &left, const Cluster &right) { return left.population > right.population; });
+    for (const auto &cluster : clusters) {
+        if (cluster.population == 0) {
+            break;
+        }
+        PaletteColor color;
+        color.red = ToChannel(cluster.red);
+        color.green = ToChannel(cluster.green);
+        color.blue = ToChannel(cluster.blue);
+        color.population = cluster.population;
+        result.dominantColors.push_back(color);
+    }
+    PickSwatches(result.dominantColors, result);
+    return true;
+}
+
+void WallpaperPaletteEngine::BuildHistogram(
+    const uint8_t *pixels, int32_t width, int32_t height, int32_t rowStride, std::vector<uint32_t> &histogram)
+{
+    histogram.assign(HISTOGRAM_SIZE, 0);
+    uint32_t *bins = histogram.data();
+    for (int32_t y = 0; y < height; y++) {
+        const uint8_t *pixel = pixels + static_cast<size_t>(y) * static_cast<size_t>(rowStride);
+        const uint8_t *rowEnd = pixel + static_cast<size_t>(width) * BYTES_PER_PIXEL;
+        // Branch free, a translucent pixel adds 0 to its bin instead of being skipped.
+        for (; pixel < rowEnd; pixel += BYTES_PER_PIXEL) {
+            uint32_t index = (static_cast<uint32_t>(pixel[RED_OFFSET] >> QUANT_SHIFT) << (QUANT_BITS * 2))
+                             | (static_cast<uint32_t>(pixel[GREEN_OFFSET] >> QUANT_SHIFT) << QUANT_BITS)
+                             | static_cast<uint32_t>(pixel[BLUE_OFFSET] >> QUANT_SHIFT);
+            bins[index] += static_cast<uint32_t>(pixel[ALPHA_OFFSET] >> ALPHA_SHIFT);
+        }
+    }
+}
+
+std::vector<WallpaperPaletteEngine::Cluster> WallpaperPaletteEngine::CollectBins(const std::vector<uint32_t> &histogram)
+{
+    std::vector<Cluster> bins;
+    for (uint32_t index = 0; index < histogram.size(); index++) {
+        if (histogram[index] == 0) {
+            continue;
+        }
+        Cluster bin;
+        bin.red = static_cast<float>((((index >> (QUANT_BITS * 2)) & QUANT_MASK) << QUANT_SHIFT) | BIN_CENTER);
+        bin.green = static_cast<float>((((index >> QUANT_BITS) & QUANT_MASK) << QUANT_SHIFT) | BIN_CENTER);
+        bin.blue = static_cast<float>(((index & QUANT_MASK) << QUANT_SHIFT) | BIN_CENTER);
+        bin.population = histogram[index];
+        bins.push_back(bin);
+    }
+    // Most populated first, so seeding and the nearest centre search start from the colors that matter most.
+    std::stable_sort(bins.begin(), bins.end(),
+        [](const Cluster &left, const Cluster &right) { return left.population > right.population; });
+    return bins;
+}
+
+std::vector<WallpaperPaletteEngine::Cluster> WallpaperPaletteEngine::SeedClusters(
+    const std::vector<Cluster> &bins, size_t maxColors)
+{
+    // Seeds are the most populated bins that are not close to an earlier seed, so a large gradient does not
+    // take every cluster.
+    std::vector<Cluster> clusters;
+    for (const auto &bin : bins) {
+        if (clusters.size() >= maxColors) {
+            break;
+        }
+        bool distinct = std::all_of(clusters.begin(), clusters.end(), [&bin](const Cluster &cluster) {
+            return SquaredDistance(bin.red, bin.green, bin.blue, cluster.red, cluster.green, cluster.blue)
+                   >= MIN_SEED_DISTANCE * MIN_SEED_DISTANCE;
+        });
+        if (distinct) {
+            clusters.push_back(bin);
+        }
+    }
+    return clusters;
+}
+
+void WallpaperPaletteEngine::RefineClusters(const std::vector<Cluster> &bins, std::vector<Cluster> &clusters)
+{
+    std::vector<size_t> assignments(bins.size(), clusters.size());
+    for (int32_t iteration = 0; iteration < MAX_REFINE_ITERATIONS; iteration++) {
+        std::vector<double> sums(clusters.size() * 3, 0.0);
+        std::vector<uint32_t> populations(clusters.size(), 0);
+        bool changed = false;
+        for (size_t index = 0; index < bins.size(); index++) {
+            const Cluster &bin = bins[index];
+            size_t nearest = 0;
+            float nearestDistance = std::numeric_limits<float>::max();
+            for (size_t cluster = 0; cluster < clusters.size(); cluster++) {
+                float distance = SquaredDistance(bin.red, bin.green, bin.blue, clusters[cluster].red,
+                    clusters[cluster].green, clusters[cluster].blue);
+                if (distance < nearestDistance) {
+                    nearestDistance = distance;
+                    nearest = cluster;
+                }
+            }
+            changed = changed || assignments[index] != nearest;
+            assignments[index] = nearest;
+            sums[nearest * 3] += static_cast<double>(bin.red) * bin.population;
+            sums[nearest * 3 + 1] += static_cast<double>(bin.green) * bin.population;
+            sums[nearest * 3 + 2] += static_cast<double>(bin.blue) * bin.population;
+            populations[nearest] += bin.population;
+        }
+        for (size_t cluster = 0; cluster < clusters.size(); cluster++) {
+            clusters[cluster].population = populations[cluster];
+            // An emptied cluster keeps its centre and is dropped from the result.
+            if (populations[cluster] == 0) {
+                continue;
+            }
+            clusters[cluster].red = static_cast<float>(sums[cluster * 3] / populations[cluster]);
+            clusters[cluster].green = static_cast<float>(sums[cluster * 3 + 1] / populations[cluster]);
+            clusters[cluster].blue = static_cast<float>(sums[cluster * 3 + 2] / populations[cluster]);
+        }
+        if (!changed) {
+            break;
+        }
+    }
+}
+
+void WallpaperPaletteEngine::PickSwatches(const std::vector<PaletteColor> &colors, PaletteResult &result)
+{
+    if (colors.empty()) {
+        return;
+    }
+    uint32_t maxPopulation = colors.front().population;
+    std::vector<bool> used(colors.size(), false);
+    for (int32_t swatch = 0; swatch < SWATCH_COUNT; swatch++) {
+        const SwatchTarget &target = SWATCH_TARGETS[swatch];
+        size_t best = colors.size();
+        float bestScore = -1.0f;
+        for (size_t index = 0; index < colors.size(); index++) {
+            float saturation = 0.0f;
+            float lightness = 0.0f;
+            ToHsl(colors[index], saturation, lightness);
+            if (used[index] || saturation < target.minSaturation || saturation > target.maxSaturation
+                || lightness < target.minLightness || lightness > target.maxLightness) {
+                continue;
+            }
+            float score = SATURATION_WEIGHT * (1.0f - std::fabs(saturation - target.targetSaturation))
+                          + LIGHTNESS_WEIGHT * (1.0f - std::fabs(lightness - target.targetLightness))
+                          + POPULATION_WEIGHT * (static_cast<float>(colors[index].population) / maxPopulation);
+            if (score > bestScore) {
+                bestScore = score;
+                best = index;
+            }
+        }
+        if (best < colors.size()) {
+            used[best] = true;
+            result.swatches[swatch] = colors[best];
+        }
+    }
+}
+} // namespace WallpaperMgrService
+} // namespace OHOS
@@ -14,6 +14,7 @@
  */
 #include "wallpaper_service.h"
 
+#include <dirent.h>
 #include <fcntl.h>
 #include <sys/prctl.h>
 #include <sys/sendfile.h>
@@ -21,13 +22,17 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <set>
 #include <sstream>
 #include <thread>
 
@@ -35,6 +40,7 @@
 #include "color.h"
 #include "color_picker.h"
 #include "config_policy_utils.h"
+#include "content_digest.h"
 #include "dump_helper.h"
 #include "effect_errors.h"
 #include "file_ex.h"
@@ -49,11 +55,13 @@
 #include "parameter.h"
 #include "pixel_map.h"
 #include "scene_board_judgement.h"
+#include "stream_writer.h"
 #include "system_ability_definition.h"
 #include "tokenid_kit.h"
 #include "wallpaper_common.h"
 #include "wallpaper_common_event_manager.h"
 #include "wallpaper_manager_common_info.h"
+#include "wallpaper_palette_engine.h"
 #include "wallpaper_service_cb_proxy.h"
 
 #ifndef THEME_SERVICE
@@ -121,15 +129,67 @@ constexpr const char *UNFOLD2_LAND_WALLPAPER_LOCK = "unfold2_land_wallpaper_lock
 constexpr int64_t INIT_INTERVAL = 10000L;
 constexpr int64_t DELAY_TIME = 1000L;
 constexpr int64_t QUERY_USER_ID_INTERVAL = 300L;
+constexpr const char *SAVE_COLOR_TASK_NAME = "SaveColor";
+constexpr const char *RENDITION_TASK_NAME = "GenerateRenditions";
+constexpr const char *THUMBNAIL_SEPARATOR = "_thumb_";
+constexpr int32_t THUMBNAIL_LEVELS = 3;
+constexpr int32_t MIN_THUMBNAIL_EDGE = 64;
+constexpr const char *TEXTURE_SIDECAR_PARAM = "const.theme.wallpaper.texture_sidecar";
+constexpr const char *TEXTURE_SUFFIX = "_astc";
+constexpr const char *MIME_TYPE_ASTC_4X4 = "image/astc/4*4";
+constexpr uint32_t ASTC_MAGIC = 0x5CA1AB13;
+constexpr size_t ASTC_HEADER_SIZE = 16;
+constexpr size_t ASTC_BLOCK_OFFSET = 4;
+constexpr size_t ASTC_WIDTH_OFFSET = 7;
+constexpr size_t ASTC_HEIGHT_OFFSET = 10;
+constexpr size_t ASTC_DIMENSION_BYTES = 3;
+constexpr uint8_t ASTC_BLOCK_EDGE = 4;
+constexpr uint32_t BITS_PER_BYTE = 8;
 constexpr int32_t FOO_MAX_LEN = 52428800;
 constexpr int32_t MAX_RETRY_TIMES = 20;
 constexpr int32_t QUERY_USER_MAX_RETRY_TIMES = 100;
 constexpr int32_t DEFAULT_WALLPAPER_ID = -1;
+constexpr const char *WALLPAPER_VERSION_SEPARATOR = ".";
+constexpr const char *WALLPAPER_STAGING_DIR_SUFFIX = ".staging";
+constexpr const char *WALLPAPER_SET_MANIFEST = "wallpaper_manifest";
+constexpr const char *MANIFEST_WALLPAPER_ID = "wallpaperId";
+constexpr const char *MANIFEST_FILES = "files";
+constexpr const char *MANIFEST_FORMAT_HINT = "formatHint";
+constexpr size_t MAX_VERSION_DIGITS = 9;
+constexpr const char *INGEST_PARALLELISM_PARAM = "const.theme.wallpaper.ingest_parallelism";
+constexpr int32_t DEFAULT_INGEST_PARALLELISM = 2;
+constexpr int32_t MAX_INGEST_PARALLELISM = 6;
+constexpr const char *FD_CACHE_CAPACITY_PARAM = "const.theme.wallpaper.fd_cache_capacity";
+constexpr int32_t DEFAULT_FD_CACHE_CAPACITY = 8;
+constexpr int32_t MAX_FD_CACHE_CAPACITY = 32;
+constexpr uint32_t PARAM_VALUE_LEN = 16;
 constexpr int32_t DEFAULT_USER_ID = 0;
 constexpr int32_t MAX_VIDEO_SIZE = 104857600;
 constexpr int32_t OPTION_QUALITY = 100;
+constexpr int32_t JPEG_HIGH_QUALITY = 90;
+constexpr int32_t JPEG_MEDIUM_QUALITY = 75;
+constexpr int32_t COMPACT_FORMAT_QUALITY = 90;
+constexpr const char *STORAGE_FORMAT_PARAM = "const.theme.wallpaper.storage_format";
+constexpr const char *MIME_TYPE_JPEG = "image/jpeg";
+constexpr const char *MIME_TYPE_WEBP = "image/webp";
+constexpr const char *MIME_TYPE_HEIF = "image/heif";
 constexpr int32_t COMPRESSION_RATIO = 8;
 constexpr int32_t MIN_SIZE = 64;
+constexpr size_t PALETTE_MAX_COLORS = 16;
+constexpr const char *WALLPAPER_COLORS_FILE = "wallpapercolors";
+constexpr const char *SYSTEM_COLORS = "SystemColors";
+constexpr const char *LOCKSCREEN_COLORS = "LockScreenColors";
+constexpr const char *COLORS_SOURCE_DIGEST = "sourceDigest";
+constexpr const char *COLORS_PALETTE_EXTRACTED = "paletteExtracted";
+constexpr const char *COLORS_MAIN_COLOR = "mainColor";
+constexpr const char *COLORS_DOMINANT_COLORS = "dominantColors";
+constexpr const char *COLORS_SWATCHES = "swatches";
+constexpr float MAX_COLOR_CHANNEL = 255.0f;
+constexpr uint32_t ALPHA_SHIFT = 24;
+constexpr uint32_t RED_SHIFT = 16;
+constexpr uint32_t GREEN_SHIFT = 8;
+constexpr uint32_t CHANNEL_MASK = 0xff;
+constexpr uint32_t OPAQUE_ALPHA = 0xff000000;
 
 #ifndef THEME_SERVICE
 constexpr int32_t CONNECT_EXTENSION_INTERVAL = 100;
@@ -189,6 +249,13 @@ void WallpaperService::OnStart()
             return true;
         });
     DumpHelper::GetInstance().RegisterCommand(cmd);
+    auto fdCacheCmd = std::make_shared<Command>(std::vector<std::string>({ "-fdcache" }),
+        "Show wallpaper fd cache statistics",
+        [this](const std::vector<std::string> &input, std::string &output) -> bool {
+            output.append(wallpaperFdCache_.Dump());
+            return true;
+        });
+    DumpHelper::GetInstance().RegisterCommand(fdCacheCmd);
     if (Init() != NO_ERROR) {
         auto callback = [=]() { Init(); };
         serviceHandler_->PostTask(callback, INIT_INTERVAL);
@@ -274,7 +341,13 @@ void WallpaperService::InitData()
     int32_t userId = DEFAULT_USER_ID;
     systemWallpaperMap_.Clear();
     lockWallpaperMap_.Clear();
+    wallpaperFdCache_.Clear();
+    wallpaperFdCache_.SetCapacity(static_cast<size_t>(
+        std::clamp(GetIntParameter(FD_CACHE_CAPACITY_PARAM, DEFAULT_FD_CACHE_CAPACITY), 0, MAX_FD_CACHE_CAPACITY)));
     wallpaperTmpFullPath_ = std::string(WALLPAPER_USERID_PATH) + std::string(WALLPAPER_TMP_DIRNAME);
+    stagingId_ = 0;
+    // Staging files left behind by an interrupted set are never committed, drop them before serving requests.
+    FileDeal::DeleteFilesWithPrefix(WALLPAPER_USERID_PATH, WALLPAPER_TMP_DIRNAME);
     wallpaperCropPath_ = std::string(WALLPAPER_USERID_PATH) + std::string(WALLPAPER_CROP_PICTURE);
     {
         std::lock_guard<std::mutex> lock(wallpaperColorMtx_);
@@ -383,7 +456,9 @@ void WallpaperService::OnInitUser(int32_t userId)
     }
     std::string userDir = WALLPAPER_USERID_PATH + std::to_string(userId);
     if (FileDeal::IsFileExist(userDir)) {
-        std::lock_guard<std::mutex> lock(mtx_);
+        auto systemLock = GetWallpaperLock(userId, WALLPAPER_SYSTEM);
+        auto lockScreenLock = GetWallpaperLock(userId, WALLPAPER_LOCKSCREEN);
+        std::scoped_lock lock(*systemLock, *lockScreenLock);
         if (!FileDeal::DeleteDir(userDir, true)) {
             HILOG_ERROR("Force remove user directory path failed, errno %{public}d", errno);
             return;
@@ -416,9 +491,117 @@ bool WallpaperService::InitUserDir(int32_t userId)
             userId, WALLPAPER_LOCKSCREEN_DIRNAME);
         return false;
     }
+    RecoverWallpaperDir(userId, WALLPAPER_SYSTEM);
+    RecoverWallpaperDir(userId, WALLPAPER_LOCKSCREEN);
+    return true;
+}
+
+void WallpaperService::RecoverWallpaperDir(int32_t userId, WallpaperType wallpaperType)
+{
+    auto wallpaperLock = GetWallpaperLock(userId, wallpaperType);
+    std::lock_guard<std::mutex> lock(*wallpaperLock);
+    auto publishLock = GetPublishLock(userId, wallpaperType);
+    std::lock_guard<std::shared_mutex> publish(*publishLock);
+    std::string wallpaperDir = GetWallpaperDir(userId, wallpaperType);
+    std::string stagingDir = wallpaperDir + WALLPAPER_STAGING_DIR_SUFFIX;
+    if (!FileDeal::IsDirExist(stagingDir)) {
+        return;
+    }
+    // The staging dir is either an unfinished set (no manifest), a finished set that was never swapped in
+    // (manifest newer than the live set), or the previous set left behind after the swap.
+    int32_t stagingId = DEFAULT_WALLPAPER_ID;
+    int32_t liveId = DEFAULT_WALLPAPER_ID;
+    std::string formatHint;
+    std::string baseName = wallpaperType == WALLPAPER_SYSTEM ? WALLPAPER_HOME : WALLPAPER_LOCK;
+    FindCommittedVersion(wallpaperDir, baseName, liveId);
+    if (ReadWallpaperManifest(stagingDir, stagingId, formatHint) && stagingId > liveId) {
+        HILOG_INFO("Roll forward wallpaper set %{public}d, userId:%{public}d", stagingId, userId);
+        // The finished set is kept for the next attempt, it is the only copy of the wallpaper the user set last.
+        if (!FileDeal::ExchangeDir(stagingDir, wallpaperDir)) {
+            HILOG_ERROR("Roll forward wallpaper set failed, keep the staging dir!");
+            return;
+        }
+    }
+    if (!FileDeal::DeleteDir(stagingDir, true)) {
+        HILOG_WARN("Delete wallpaper staging dir failed, userId:%{public}d", userId);
+    }
+}
+
+bool WallpaperService::WriteWallpaperManifest(const std::string &dirPath, const WallpaperData &wallpaperData)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (root == nullptr) {
+        HILOG_ERROR("create object failed.");
+        return false;
+    }
+    cJSON *files = cJSON_AddArrayToObject(root, MANIFEST_FILES);
+    if (cJSON_AddNumberToObject(root, MANIFEST_WALLPAPER_ID, wallpaperData.wallpaperId) == nullptr
+        || cJSON_AddStringToObject(root, MANIFEST_FORMAT_HINT, wallpaperData.formatHint.c_str()) == nullptr
+        || files == nullptr) {
+        HILOG_ERROR("add item to object fail.");
+        cJSON_Delete(root);
+        return false;
+    }
+    for (const auto &file : GetWallpaperDataFiles(wallpaperData)) {
+        cJSON_AddItemToArray(files, cJSON_CreateString(file.substr(file.find_last_of('/') + 1).c_str()));
+    }
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (json == nullptr) {
+        HILOG_ERROR("print manifest failed.");
+        return false;
+    }
+    std::string tempPath = MakeStagingPath();
+    // Recovery rolls a staging dir forward on its manifest alone, so the manifest is on disk before it is committed.
+    bool written = FileDeal::WriteFile(tempPath, json, DurabilityMode::DATA_SYNC);
+    cJSON_free(json);
+    if (!written) {
+        HILOG_ERROR("write manifest failed.");
+        FileDeal::DeleteFile(tempPath);
+        return false;
+    }
+    // Committed after every variant, so a manifest in the staging dir means the set is complete.
+    if (!FileDeal::CommitFile(tempPath, dirPath + "/" + WALLPAPER_SET_MANIFEST)) {
+        FileDeal::DeleteFile(tempPath);
+        return false;
+    }
     return true;
 }
 
+bool WallpaperService::ReadWallpaperManifest(const std::string &dirPath, int32_t &wallpaperId, std::string &formatHint)
+{
+    std::ifstream file(dirPath + "/" + WALLPAPER_SET_MANIFEST);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    cJSON *root = cJSON_Parse(content.c_str());
+    if (root == nullptr) {
+        HILOG_ERROR("Failed to parse manifest.");
+        return false;
+    }
+    bool ret = false;
+    cJSON *idItem = cJSON_GetObjectItemCaseSensitive(root, MANIFEST_WALLPAPER_ID);
+    cJSON *files = cJSON_GetObjectItemCaseSensitive(root, MANIFEST_FILES);
+    if (idItem != nullptr && cJSON_IsNumber(idItem) && files != nullptr && cJSON_IsArray(files)) {
+        ret = true;
+        cJSON *file = nullptr;
+        cJSON_ArrayForEach(file, files) {
+            if (!cJSON_IsString(file) || !FileDeal::IsFileExist(dirPath + "/" + file->valuestring)) {
+                ret = false;
+                break;
+            }
+        }
+        wallpaperId = idItem->valueint;
+        // Manifests written before the hint was persisted have none, the picture is then decoded without it.
+        cJSON *hintItem = cJSON_GetObjectItemCaseSensitive(root, MANIFEST_FORMAT_HINT);
+        formatHint = cJSON_IsString(hintItem) ? hintItem->valuestring : "";
+    }
+    cJSON_Delete(root);
+    return ret;
+}
+
 bool WallpaperService::RestoreUserResources(int32_t userId, WallpaperData &wallpaperData, WallpaperType wallpaperType)
 {
     if (!FileDeal::DeleteDir(GetWallpaperDir(userId, wallpaperType), false)) {
@@ -483,13 +666,21 @@ void WallpaperService::OnRemovedUser(int32_t userId)
         HILOG_ERROR("userId error, userId = %{public}d", userId);
         return;
     }
-    ClearWallpaperLocked(userId, WALLPAPER_SYSTEM);
-    ClearWallpaperLocked(userId, WALLPAPER_LOCKSCREEN);
     std::string userDir = WALLPAPER_USERID_PATH + std::to_string(userId);
-    std::lock_guard<std::mutex> lock(mtx_);
-    if (!FileDeal::DeleteDir(userDir, true)) {
-        HILOG_ERROR("Force remove user directory path failed, errno %{public}d", errno);
+    {
+        auto systemLock = GetWallpaperLock(userId, WALLPAPER_SYSTEM);
+        auto lockScreenLock = GetWallpaperLock(userId, WALLPAPER_LOCKSCREEN);
+        std::scoped_lock lock(*systemLock, *lockScreenLock);
+        auto systemPublishLock = GetPublishLock(userId, WALLPAPER_SYSTEM);
+        auto lockScreenPublishLock = GetPublishLock(userId, WALLPAPER_LOCKSCREEN);
+        std::scoped_lock publish(*systemPublishLock, *lockScreenPublishLock);
+        ClearWallpaperLocked(userId, WALLPAPER_SYSTEM);
+        ClearWallpaperLocked(userId, WALLPAPER_LOCKSCREEN);
+        if (!FileDeal::DeleteDir(userDir, true)) {
+            HILOG_ERROR("Force remove user directory path failed, errno %{public}d", errno);
+        }
     }
+    RemoveWallpaperLocks(userId);
     HILOG_INFO("OnRemovedUser end, userId = %{public}d", userId);
 }
 
@@ -518,8 +709,8 @@ void WallpaperService::OnSwitchedUser(int32_t userId)
     LoadWallpaperState();
     SendWallpaperChangeEvent(userId, WALLPAPER_SYSTEM);
     SendWallpaperChangeEvent(userId, WALLPAPER_LOCKSCREEN);
-    SaveColor(userId, WALLPAPER_SYSTEM);
-    SaveColor(userId, WALLPAPER_LOCKSCREEN);
+    PostSaveColorTask(userId, WALLPAPER_SYSTEM);
+    PostSaveColorTask(userId, WALLPAPER_LOCKSCREEN);
     HILOG_INFO("OnSwitchedUser end, newUserId = %{public}d", userId);
 }
 
@@ -543,19 +734,24 @@ bool WallpaperService::GetFileNameFromMap(int32_t userId, WallpaperType wallpape
         HILOG_ERROR("system wallpaper already cleared.");
         return false;
     }
-    HILOG_DEBUG("GetFileNameFromMap resourceType : %{public}d", static_cast<int32_t>(iterator.second.resourceType));
-    switch (iterator.second.resourceType) {
+    return GetFileNameFromData(iterator.second, filePathName);
+}
+
+bool WallpaperService::GetFileNameFromData(const WallpaperData &wallpaperData, std::string &filePathName)
+{
+    HILOG_DEBUG("GetFileNameFromMap resourceType : %{public}d", static_cast<int32_t>(wallpaperData.resourceType));
+    switch (wallpaperData.resourceType) {
         case PICTURE:
-            filePathName = iterator.second.wallpaperFile;
+            filePathName = wallpaperData.wallpaperFile;
             break;
         case VIDEO:
-            filePathName = iterator.second.liveWallpaperFile;
+            filePathName = wallpaperData.liveWallpaperFile;
             break;
         case DEFAULT:
-            filePathName = iterator.second.wallpaperFile;
+            filePathName = wallpaperData.wallpaperFile;
             break;
         case PACKAGE:
-            filePathName = iterator.second.customPackageUri;
+            filePathName = wallpaperData.customPackageUri;
             break;
         default:
             filePathName = "";
@@ -588,12 +784,252 @@ int32_t WallpaperService::MakeWallpaperIdLocked()
     return ++wallpaperId_;
 }
 
+std::shared_ptr<std::mutex> WallpaperService::GetWallpaperLock(int32_t userId, WallpaperType wallpaperType)
+{
+    std::lock_guard<std::mutex> lock(wallpaperLockMapMutex_);
+    auto &wallpaperLock = wallpaperLockMap_[std::make_pair(userId, wallpaperType)];
+    if (wallpaperLock == nullptr) {
+        wallpaperLock = std::make_shared<std::mutex>();
+    }
+    return wallpaperLock;
+}
+
+std::shared_ptr<std::shared_mutex> WallpaperService::GetPublishLock(int32_t userId, WallpaperType wallpaperType)
+{
+    std::lock_guard<std::mutex> lock(wallpaperLockMapMutex_);
+    auto &publishLock = publishLockMap_[std::make_pair(userId, wallpaperType)];
+    if (publishLock == nullptr) {
+        publishLock = std::make_shared<std::shared_mutex>();
+    }
+    return publishLock;
+}
+
+void WallpaperService::RemoveWallpaperLocks(int32_t userId)
+{
+    std::lock_guard<std::mutex> lock(wallpaperLockMapMutex_);
+    // A lock still referenced elsewhere belongs to a request in flight, it stays so later requests share it.
+    // Tickets are kept as well, a set queued before the removal must still see itself superseded.
+    for (auto wallpaperType : { WALLPAPER_SYSTEM, WALLPAPER_LOCKSCREEN }) {
+        auto it = wallpaperLockMap_.find(std::make_pair(userId, wallpaperType));
+        if (it != wallpaperLockMap_.end() && it->second.use_count() == 1) {
+            wallpaperLockMap_.erase(it);
+        }
+        auto publishIt = publishLockMap_.find(std::make_pair(userId, wallpaperType));
+        if (publishIt != publishLockMap_.end() && publishIt->second.use_count() == 1) {
+            publishLockMap_.erase(publishIt);
+        }
+    }
+}
+
+uint64_t WallpaperService::IssueSetTicket(int32_t userId, WallpaperType wallpaperType)
+{
+    std::lock_guard<std::mutex> lock(wallpaperLockMapMutex_);
+    return ++setTicketMap_[std::make_pair(userId, wallpaperType)];
+}
+
+bool WallpaperService::IsSetSuperseded(int32_t userId, WallpaperType wallpaperType, uint64_t ticket)
+{
+    std::lock_guard<std::mutex> lock(wallpaperLockMapMutex_);
+    auto it = setTicketMap_.find(std::make_pair(userId, wallpaperType));
+    return it != setTicketMap_.end() && it->second > ticket;
+}
+
+std::string WallpaperService::MakeStagingPath()
+{
+    return wallpaperTmpFullPath_ + "_" + std::to_string(++stagingId_);
+}
+
+std::string WallpaperService::GetVersionedFile(const std::string &filePath, int32_t wallpaperId)
+{
+    if (wallpaperId == DEFAULT_WALLPAPER_ID) {
+        return filePath;
+    }
+    return filePath + WALLPAPER_VERSION_SEPARATOR + std::to_string(wallpaperId);
+}
+
+bool WallpaperService::FindCommittedVersion(const std::string &dirPath, const std::string &baseName, int32_t &version)
+{
+    DIR *dir = opendir(dirPath.c_str());
+    if (dir == nullptr) {
+        return false;
+    }
+    bool found = false;
+    std::string prefix = baseName + WALLPAPER_VERSION_SEPARATOR;
+    dirent *dirent;
+    while ((dirent = readdir(dir)) != nullptr) {
+        std::string name = dirent->d_name;
+        int32_t fileVersion = DEFAULT_WALLPAPER_ID;
+        if (name != baseName) {
+            // Files committed before versioning carry the bare name and sort below every versioned one.
+            if (name.compare(0, prefix.size(), prefix) != 0 || name.size() == prefix.size()
+                || name.find_first_not_of("0123456789", prefix.size()) != std::string::npos
+                || name.size() - prefix.size() > MAX_VERSION_DIGITS) {
+                continue;
+            }
+            fileVersion = std::stoi(name.substr(prefix.size()));
+        }
+        if (!found || fileVersion > version) {
+            version = fileVersion;
+            found = true;
+        }
+    }
+    closedir(dir);
+    return found;
+}
+
+std::vector<std::string> WallpaperService::GetWallpaperDataFiles(const WallpaperData &wallpaperData)
+{
+    std::vector<std::string> files;
+    for (const auto &variantFile : GetWallpaperVariantFiles(wallpaperData)) {
+        files.push_back(variantFile.second);
+    }
+    return files;
+}
+
+std::string WallpaperService::GetVariantName(FoldState foldState, RotateState rotateState)
+{
+    return GetFoldStateName(foldState) + "_" + GetRotateStateName(rotateState);
+}
+
+std::map<std::string, std::string> WallpaperService::GetWallpaperVariantFiles(const WallpaperData &wallpaperData)
+{
+    std::map<std::string, std::string> variantFiles = {
+        { GetVariantName(FoldState::NORMAL, RotateState::PORT), wallpaperData.wallpaperFile },
+        { GetVariantName(FoldState::NORMAL, RotateState::LAND), wallpaperData.normalLandFile },
+        { GetVariantName(FoldState::UNFOLD_1, RotateState::PORT), wallpaperData.unfoldedOnePortFile },
+        { GetVariantName(FoldState::UNFOLD_1, RotateState::LAND), wallpaperData.unfoldedOneLandFile },
+        { GetVariantName(FoldState::UNFOLD_2, RotateState::PORT), wallpaperData.unfoldedTwoPortFile },
+        { GetVariantName(FoldState::UNFOLD_2, RotateState::LAND), wallpaperData.unfoldedTwoLandFile },
+    };
+    for (auto iter = variantFiles.begin(); iter != variantFiles.end();) {
+        iter = iter->second.empty() ? variantFiles.erase(iter) : std::next(iter);
+    }
+    return variantFiles;
+}
+
+bool WallpaperService::IsWallpaperUnchanged(int32_t userId, WallpaperType wallpaperType,
+    WallpaperResourceType resourceType, const std::map<std::string, uint64_t> &digests)
+{
+    auto &wallpaperMap = wallpaperType == WALLPAPER_SYSTEM ? systemWallpaperMap_ : lockWallpaperMap_;
+    auto iterator = wallpaperMap.Find(userId);
+    if (digests.empty() || !iterator.first || iterator.second.resourceType != resourceType) {
+        return false;
+    }
+    WallpaperData wallpaperData = iterator.second;
+    std::map<std::string, std::string> variantFiles = GetWallpaperVariantFiles(wallpaperData);
+    if (variantFiles.size() != digests.size()) {
+        return false;
+    }
+    std::string wallpaperDir = GetWallpaperDir(userId, wallpaperType) + "/";
+    bool unchanged = true;
+    bool digestAdded = false;
+    for (const auto &digest : digests) {
+        auto variantFile = variantFiles.find(digest.first);
+        // Only a picture committed by a previous set can match, never the preset default one.
+        if (variantFile == variantFiles.end() ||
+            variantFile->second.compare(0, wallpaperDir.size(), wallpaperDir) != 0) {
+            return false;
+        }
+        auto committed = wallpaperData.fileDigests.find(variantFile->second);
+        if (committed == wallpaperData.fileDigests.end()) {
+            uint64_t committedDigest = 0;
+            if (!ContentDigest::DigestFile(variantFile->second, committedDigest)) {
+                return false;
+            }
+            committed = wallpaperData.fileDigests.emplace(variantFile->second, committedDigest).first;
+            digestAdded = true;
+        }
+        if (committed->second != digest.second) {
+            unchanged = false;
+            break;
+        }
+    }
+    if (digestAdded) {
+        wallpaperMap.InsertOrAssign(userId, wallpaperData);
+    }
+    return unchanged;
+}
+
+void WallpaperService::SetWallpaperDigests(WallpaperData &wallpaperData, const std::map<std::string, uint64_t> &digests)
+{
+    wallpaperData.fileDigests.clear();
+    for (const auto &variantFile : GetWallpaperVariantFiles(wallpaperData)) {
+        auto digest = digests.find(variantFile.first);
+        if (digest != digests.end()) {
+            wallpaperData.fileDigests[variantFile.second] = digest->second;
+        }
+    }
+}
+
+ErrorCode WallpaperService::OpenWallpaperFile(int32_t userId, WallpaperType wallpaperType,
+    const std::function<bool(const WallpaperData &, std::string &)> &getFilePath, int32_t &fd)
+{
+    // Initing a missing user takes the slot locks, so it happens before the publish lock is held.
+    WallpaperData wallpaperData;
+    if (!FindWallpaperData(userId, wallpaperType, wallpaperData)) {
+        return E_DEAL_FAILED;
+    }
+    // Files the map points at are only moved or deleted under the exclusive publish lock, so the path stays valid
+    // until it is opened.
+    auto publishLock = GetPublishLock(userId, wallpaperType);
+    std::shared_lock<std::shared_mutex> lock(*publishLock);
+    auto iterator = wallpaperType == WALLPAPER_SYSTEM ? systemWallpaperMap_.Find(userId)
+                                                      : lockWallpaperMap_.Find(userId);
+    std::string filePath;
+    if (!iterator.first || !getFilePath(iterator.second, filePath)) {
+        return E_DEAL_FAILED;
+    }
+    fd = open(filePath.c_str(), O_RDONLY, S_IREAD);
+    if (fd < 0) {
+        int32_t openErrno = errno;
+        HILOG_ERROR("Open file failed, errno %{public}d", openErrno);
+        return openErrno == ENOENT ? E_NOT_FOUND : E_FILE_ERROR;
+    }
+    fdsan_exchange_owner_tag(fd, 0, WP_DOMAIN);
+    return NO_ERROR;
+}
+
+ErrorCode WallpaperService::OpenWallpaperHandle(int32_t userId, WallpaperType wallpaperType,
+    const std::function<bool(const WallpaperData &, std::string &)> &getFilePath, WallpaperHandle &handle)
+{
+    int32_t fd = -1;
+    ErrorCode ret = OpenWallpaperFile(userId, wallpaperType, getFilePath, fd);
+    if (ret != NO_ERROR) {
+        ReporterFault(FaultType::LOAD_WALLPAPER_FAULT, FaultCode::RF_FD_INPUT_FAILED);
+        return ret;
+    }
+    // The size comes from the opened fd, so it matches the version that is served even if a set lands meanwhile.
+    if (!handle.Attach(fd)) {
+        return E_FILE_ERROR;
+    }
+    return NO_ERROR;
+}
+
+ErrorCode WallpaperService::OpenCachedWallpaperHandle(const WallpaperFdKey &key,
+    const std::function<bool(const WallpaperData &, std::string &)> &getFilePath, WallpaperHandle &handle)
+{
+    if (wallpaperFdCache_.Acquire(key, handle)) {
+        return NO_ERROR;
+    }
+    uint64_t generation = wallpaperFdCache_.GetGeneration(std::get<0>(key), std::get<1>(key));
+    ErrorCode ret = OpenWallpaperHandle(
+        std::get<0>(key), static_cast<WallpaperType>(std::get<1>(key)), getFilePath, handle);
+    if (ret == NO_ERROR) {
+        wallpaperFdCache_.Insert(key, handle, generation);
+    }
+    return ret;
+}
+
 void WallpaperService::UpdataWallpaperMap(int32_t userId, WallpaperType wallpaperType)
 {
     HILOG_INFO("updata wallpaperMap.");
     std::string wallpaperPath = GetWallpaperDir(userId, wallpaperType);
-    std::string wallpaperFilePath =
-        wallpaperPath + "/" + (wallpaperType == WALLPAPER_SYSTEM ? WALLPAPER_HOME : WALLPAPER_LOCK);
+    int32_t version = DEFAULT_WALLPAPER_ID;
+    std::string baseName = wallpaperType == WALLPAPER_SYSTEM ? WALLPAPER_HOME : WALLPAPER_LOCK;
+    bool hasVersion = FindCommittedVersion(wallpaperPath, baseName, version);
+    if (version > wallpaperId_) {
+        wallpaperId_ = version;
+    }
     ConcurrentMap<int32_t, WallpaperData> &wallpaperMap = [&]() -> ConcurrentMap<int32_t, WallpaperData>& {
         if (wallpaperType == WALLPAPER_SYSTEM) {
             return systemWallpaperMap_;
@@ -611,36 +1047,48 @@ void WallpaperService::UpdataWallpaperMap(int32_t userId, WallpaperType wallpape
         + (wallpaperType == WALLPAPER_SYSTEM ? LIVE_WALLPAPER_SYSTEM_ORIG : LIVE_WALLPAPER_LOCK_ORIG);
     wallpaperData.customPackageUri =
         wallpaperPath + "/" + (wallpaperType == WALLPAPER_SYSTEM ? CUSTOM_WALLPAPER_SYSTEM : CUSTOM_WALLPAPER_LOCK);
-    if (FileDeal::IsFileExist(wallpaperFilePath)) {
-        wallpaperData.wallpaperFile = GetExistFilePath(
-            wallpaperPath + "/" + (wallpaperType == WALLPAPER_SYSTEM ? WALLPAPER_HOME : WALLPAPER_LOCK));
-        wallpaperData.normalLandFile = GetExistFilePath(
-            wallpaperPath + "/"
-            + (wallpaperType == WALLPAPER_SYSTEM ? NORMAL_LAND_WALLPAPER_HOME : NORMAL_LAND_WALLPAPER_LOCK));
-        wallpaperData.unfoldedOnePortFile = GetExistFilePath(
-            wallpaperPath + "/"
-            + (wallpaperType == WALLPAPER_SYSTEM ? UNFOLD1_PORT_WALLPAPER_HOME : UNFOLD1_PORT_WALLPAPER_LOCK));
-        wallpaperData.unfoldedOneLandFile = GetExistFilePath(
-            wallpaperPath + "/"
-            + (wallpaperType == WALLPAPER_SYSTEM ? UNFOLD1_LAND_WALLPAPER_HOME : UNFOLD1_LAND_WALLPAPER_LOCK));
-        wallpaperData.unfoldedTwoPortFile = GetExistFilePath(
-            wallpaperPath + "/"
-            + (wallpaperType == WALLPAPER_SYSTEM ? UNFOLD2_PORT_WALLPAPER_HOME : UNFOLD2_PORT_WALLPAPER_LOCK));
-        wallpaperData.unfoldedTwoLandFile = GetExistFilePath(
-            wallpaperPath + "/"
-            + (wallpaperType == WALLPAPER_SYSTEM ? UNFOLD2_LAND_WALLPAPER_HOME : UNFOLD2_LAND_WALLPAPER_LOCK));
+    if (hasVersion) {
+        // All variants of one set share the version of the main file, leftovers of older sets are ignored.
+        // The version is the id the set was committed with, so GetWallpaperId reports it after a restart too
+        // instead of -1.
+        wallpaperData.wallpaperId = version;
+        wallpaperData.wallpaperFile = GetExistFilePath(GetVersionedFile(wallpaperPath + "/" + baseName, version));
+        wallpaperData.normalLandFile = GetExistFilePath(GetVersionedFile(wallpaperPath + "/"
+            + (wallpaperType == WALLPAPER_SYSTEM ? NORMAL_LAND_WALLPAPER_HOME : NORMAL_LAND_WALLPAPER_LOCK), version));
+        wallpaperData.unfoldedOnePortFile = GetExistFilePath(GetVersionedFile(wallpaperPath + "/"
+            + (wallpaperType == WALLPAPER_SYSTEM ? UNFOLD1_PORT_WALLPAPER_HOME : UNFOLD1_PORT_WALLPAPER_LOCK),
+            version));
+        wallpaperData.unfoldedOneLandFile = GetExistFilePath(GetVersionedFile(wallpaperPath + "/"
+            + (wallpaperType == WALLPAPER_SYSTEM ? UNFOLD1_LAND_WALLPAPER_HOME : UNFOLD1_LAND_WALLPAPER_LOCK),
+            version));
+        wallpaperData.unfoldedTwoPortFile = GetExistFilePath(GetVersionedFile(wallpaperPath + "/"
+            + (wallpaperType == WALLPAPER_SYSTEM ? UNFOLD2_PORT_WALLPAPER_HOME : UNFOLD2_PORT_WALLPAPER_LOCK),
+            version));
+        wallpaperData.unfoldedTwoLandFile = GetExistFilePath(GetVersionedFile(wallpaperPath + "/"
+            + (wallpaperType == WALLPAPER_SYSTEM ? UNFOLD2_LAND_WALLPAPER_HOME : UNFOLD2_LAND_WALLPAPER_LOCK),
+            version));
+        // The manifest of the set carries the format the pictures were encoded in.
+        int32_t manifestId = DEFAULT_WALLPAPER_ID;
+        std::string formatHint;
+        if (ReadWallpaperManifest(wallpaperPath, manifestId, formatHint) && manifestId == version) {
+            wallpaperData.formatHint = formatHint;
+        }
+        LoadThumbnailFiles(wallpaperPath, wallpaperData);
+        LoadTextureFiles(wallpaperData);
     }
+    LoadWallpaperColors(userId, wallpaperType, wallpaperData);
     wallpaperMap.InsertOrAssign(userId, wallpaperData);
+    wallpaperFdCache_.Invalidate(userId, wallpaperType);
 }
 
 ErrCode WallpaperService::GetColors(int32_t wallpaperType, std::vector<uint64_t> &colors)
 {
-    if (wallpaperType == WALLPAPER_SYSTEM) {
-        std::lock_guard<std::mutex> lock(wallpaperColorMtx_);
-        colors.emplace_back(systemWallpaperColor_);
-    } else if (wallpaperType == WALLPAPER_LOCKSCREEN) {
-        std::lock_guard<std::mutex> lock(wallpaperColorMtx_);
-        colors.emplace_back(lockWallpaperColor_);
+    if (wallpaperType == WALLPAPER_SYSTEM || wallpaperType == WALLPAPER_LOCKSCREEN) {
+        int32_t userId = QueryActiveUserId();
+        auto iterator = wallpaperType == WALLPAPER_SYSTEM ? systemWallpaperMap_.Find(userId)
+                                                          : lockWallpaperMap_.Find(userId);
+        // 0 until the colors of the current picture are loaded or extracted, like before any extraction.
+        colors.emplace_back(iterator.first ? iterator.second.mainColor : 0);
     }
     HILOG_INFO("GetColors Service End.");
     return NO_ERROR;
@@ -655,6 +1103,36 @@ ErrCode WallpaperService::GetColorsV9(int32_t wallpaperType, std::vector<uint64_
     return GetColors(wallpaperType, colors);
 }
 
+ErrCode WallpaperService::GetColorPalette(int32_t wallpaperType, std::vector<uint64_t> &palette)
+{
+    if (!IsSystemApp()) {
+        HILOG_ERROR("CallingApp is not SystemApp.");
+        return E_NOT_SYSTEM_APP;
+    }
+    // The swatches describe the picture in more detail than the main color, so they need the same permission.
+    if (!CheckCallingPermission(WALLPAPER_PERMISSION_NAME_GET_WALLPAPER)) {
+        HILOG_ERROR("GetColorPalette no get permission!");
+        return E_NO_PERMISSION;
+    }
+    if (wallpaperType != static_cast<int32_t>(WALLPAPER_LOCKSCREEN)
+        && wallpaperType != static_cast<int32_t>(WALLPAPER_SYSTEM)) {
+        return E_PARAMETERS_INVALID;
+    }
+    int32_t userId = QueryActiveUserId();
+    WallpaperData wallpaperData;
+    if (!FindWallpaperData(userId, static_cast<WallpaperType>(wallpaperType), wallpaperData)) {
+        return E_DEAL_FAILED;
+    }
+    // Swatches first, then the dominant colors. Empty until SaveColor extracted the palette of the picture.
+    if (wallpaperData.palette.extracted) {
+        palette = wallpaperData.palette.swatches;
+        palette.insert(palette.end(), wallpaperData.palette.dominantColors.begin(),
+            wallpaperData.palette.dominantColors.end());
+    }
+    HILOG_INFO("GetColorPalette colors:%{public}d", static_cast<int32_t>(palette.size()));
+    return NO_ERROR;
+}
+
 ErrCode WallpaperService::GetFile(int32_t wallpaperType, int &wallpaperFd)
 {
     if (!CheckCallingPermission(WALLPAPER_PERMISSION_NAME_GET_WALLPAPER)) {
@@ -668,26 +1146,62 @@ ErrCode WallpaperService::GetFile(int32_t wallpaperType, int &wallpaperFd)
     auto type = static_cast<WallpaperType>(wallpaperType);
     int32_t userId = QueryActiveUserId();
     HILOG_INFO("QueryCurrentOsAccount userId: %{public}d", userId);
+    WallpaperResourceType resType = GetResType(userId, type);
+    if (resType == PICTURE || resType == DEFAULT) {
+        // Pictures are served from the same cached fd as GetPixelMap, videos and packages are opened each time.
+        WallpaperHandle handle;
+        WallpaperFdKey key(
+            userId, type, static_cast<int32_t>(FoldState::NORMAL), static_cast<int32_t>(RotateState::PORT));
+        ErrorCode ret = OpenCachedWallpaperHandle(
+            key,
+            [this](const WallpaperData &wallpaperData, std::string &filePath) {
+                return GetFileNameFromData(wallpaperData, filePath);
+            },
+            handle);
+        wallpaperFd = handle.Release();
+        HILOG_INFO("GetFile fd:%{public}d, ret:%{public}d", wallpaperFd, ret);
+        return ret == NO_ERROR ? NO_ERROR : E_DEAL_FAILED;
+    }
     ErrorCode ret = GetImageFd(userId, type, wallpaperFd);
     HILOG_INFO("GetImageFd fd:%{public}d, ret:%{public}d", wallpaperFd, ret);
     return ret;
 }
 
-bool WallpaperService::CompareColor(const uint64_t &localColor, const ColorManager::Color &color)
+std::string WallpaperService::GetFormatHint(int32_t userId, WallpaperType wallpaperType)
 {
-    std::lock_guard<std::mutex> lock(wallpaperColorMtx_);
-    return localColor == color.PackValue();
+    auto iterator = wallpaperType == WALLPAPER_SYSTEM ? systemWallpaperMap_.Find(userId)
+                                                      : lockWallpaperMap_.Find(userId);
+    if (iterator.first && !iterator.second.formatHint.empty()) {
+        return iterator.second.formatHint;
+    }
+    return MIME_TYPE_JPEG;
 }
 
 bool WallpaperService::SaveColor(int32_t userId, WallpaperType wallpaperType)
 {
+    // Taken before the file name, so colors of a picture replaced meanwhile are dropped by CommitColors.
+    auto iterator = wallpaperType == WALLPAPER_SYSTEM ? systemWallpaperMap_.Find(userId)
+                                                      : lockWallpaperMap_.Find(userId);
+    if (iterator.first && iterator.second.mainColor != 0 && iterator.second.palette.extracted) {
+        // Loaded from wallpapercolors for the current picture, boot and user switch need no decode.
+        // Without an extracted palette the decode runs again, so GetColorPalette does not stay empty.
+        OnColorsChange(wallpaperType, iterator.second.mainColor);
+        return true;
+    }
+    int32_t wallpaperId = iterator.first ? iterator.second.wallpaperId : DEFAULT_WALLPAPER_ID;
     uint32_t errorCode = 0;
     OHOS::Media::SourceOptions opts;
-    opts.formatHint = "image/jpeg";
+    opts.formatHint = GetFormatHint(userId, wallpaperType);
     std::string pathName;
     if (!GetPictureFileName(userId, wallpaperType, pathName)) {
         return false;
     }
+    // The colors are stored with the content they describe, every default picture shares DEFAULT_WALLPAPER_ID.
+    uint64_t sourceDigest = 0;
+    if (!GetFileDigest(iterator.second, pathName, sourceDigest)) {
+        HILOG_ERROR("Digest picture failed!");
+        return false;
+    }
     std::unique_ptr<OHOS::Media::ImageSource> imageSource =
         OHOS::Media::ImageSource::CreateImageSource(pathName, opts, errorCode);
     if (errorCode != 0 || imageSource == nullptr) {
@@ -702,11 +1216,17 @@ bool WallpaperService::SaveColor(int32_t userId, WallpaperType wallpaperType)
     if (height >= MIN_SIZE || width >= MIN_SIZE) {
         decodeOpts.desiredSize = {width / COMPRESSION_RATIO, height / COMPRESSION_RATIO};
     }
+    decodeOpts.desiredPixelFormat = PixelFormat::RGBA_8888;
     std::unique_ptr<PixelMap> wallpaperPixelMap = imageSource->CreatePixelMap(decodeOpts, errorCode);
     if (errorCode != 0 || wallpaperPixelMap == nullptr) {
         HILOG_ERROR("CreatePixelMap failed!");
         return false;
     }
+    // The palette shares the decode of the main color, clients no longer decode the picture for it.
+    WallpaperPalette palette;
+    if (!ExtractPalette(*wallpaperPixelMap, palette)) {
+        HILOG_WARN("ExtractPalette failed, the main color is saved without a palette.");
+    }
     auto colorPicker = Rosen::ColorPicker::CreateColorPicker(std::move(wallpaperPixelMap), errorCode);
     if (errorCode != 0) {
         HILOG_ERROR("CreateColorPicker failed!");
@@ -718,112 +1238,752 @@ bool WallpaperService::SaveColor(int32_t userId, WallpaperType wallpaperType)
         HILOG_ERROR("GetMainColor failed ret is : %{public}d", ret);
         return false;
     }
-    OnColorsChange(wallpaperType, color);
+    if (!CommitColors(userId, wallpaperType, wallpaperId, sourceDigest, color.PackValue(), palette)) {
+        return false;
+    }
+    SaveWallpaperColors(userId);
+    OnColorsChange(wallpaperType, color.PackValue());
     return true;
 }
 
-ErrCode WallpaperService::SetWallpaper(int fd, int32_t wallpaperType, int32_t length)
+bool WallpaperService::ExtractPalette(OHOS::Media::PixelMap &pixelMap, WallpaperPalette &palette)
 {
-    if (!CheckCallingPermission(WALLPAPER_PERMISSION_NAME_SET_WALLPAPER)) {
-        HILOG_ERROR("SetWallpaper no set permission.");
-        return E_NO_PERMISSION;
+    if (pixelMap.GetPixelFormat() != PixelFormat::RGBA_8888) {
+        HILOG_WARN("Palette needs RGBA_8888, got %{public}d", static_cast<int32_t>(pixelMap.GetPixelFormat()));
+        return false;
     }
-    StartAsyncTrace(HITRACE_TAG_MISC, "SetWallpaper", static_cast<int32_t>(TraceTaskId::SET_WALLPAPER));
-    ErrorCode wallpaperErrorCode = SetWallpaper(fd, wallpaperType, length, PICTURE);
-    FinishAsyncTrace(HITRACE_TAG_MISC, "SetWallpaper", static_cast<int32_t>(TraceTaskId::SET_WALLPAPER));
-    close(fd);
-    return wallpaperErrorCode;
-}
-
-ErrCode WallpaperService::SetWallpaperByPixelMap(const WallpaperRawData &wallpaperRawdata, int32_t wallpaperType)
-{
-    if (!CheckCallingPermission(WALLPAPER_PERMISSION_NAME_SET_WALLPAPER)) {
-        HILOG_ERROR("SetWallpaper no set permission.");
-        return E_NO_PERMISSION;
+    PaletteResult result;
+    if (!WallpaperPaletteEngine::Extract(pixelMap.GetPixels(), pixelMap.GetWidth(), pixelMap.GetHeight(),
+        pixelMap.GetRowStride(), PALETTE_MAX_COLORS, result)) {
+        HILOG_ERROR("Extract palette failed!");
+        return false;
     }
-    auto *rawData = (uint8_t *)wallpaperRawdata.data;
-    if (rawData == nullptr) {
-        HILOG_ERROR("rawData is nullptr!");
-        return E_FILE_ERROR;
+    auto toArgb = [](const PaletteColor &color) {
+        return OPAQUE_ALPHA | (static_cast<uint32_t>(color.red) << RED_SHIFT)
+               | (static_cast<uint32_t>(color.green) << GREEN_SHIFT) | color.blue;
+    };
+    for (const auto &color : result.dominantColors) {
+        palette.dominantColors.push_back(PackColor(toArgb(color)));
     }
-    std::vector<uint8_t> VectorPixelMap(rawData, rawData + wallpaperRawdata.size);
-    if (VectorPixelMap.size() == 0) {
-        HILOG_ERROR("VectorPixelMap  is nullptr!");
-        return E_FILE_ERROR;
+    for (const auto &swatch : result.swatches) {
+        palette.swatches.push_back(swatch.population == 0 ? 0 : PackColor(toArgb(swatch)));
     }
-    std::shared_ptr<OHOS::Media::PixelMap> pixelMap = std::shared_ptr<PixelMap>(PixelMap::DecodeTlv(VectorPixelMap));
-    if (pixelMap == nullptr) {
-        HILOG_ERROR("pixelMap is nullptr");
-        return E_FILE_ERROR;
+    palette.extracted = true;
+    return true;
+}
+
+uint64_t WallpaperService::PackColor(uint32_t argb)
+{
+    if (argb == 0) {
+        return 0;
     }
-    StartAsyncTrace(HITRACE_TAG_MISC, "SetWallpaper", static_cast<int32_t>(TraceTaskId::SET_WALLPAPER));
-    ErrorCode wallpaperErrorCode = SetWallpaperByPixelMap(pixelMap, wallpaperType, PICTURE);
-    FinishAsyncTrace(HITRACE_TAG_MISC, "SetWallpaper", static_cast<int32_t>(TraceTaskId::SET_WALLPAPER));
-    return wallpaperErrorCode;
+    auto toFloat = [argb](uint32_t shift) { return ((argb >> shift) & CHANNEL_MASK) / MAX_COLOR_CHANNEL; };
+    return ColorManager::Color(toFloat(RED_SHIFT), toFloat(GREEN_SHIFT), toFloat(0), toFloat(ALPHA_SHIFT))
+        .PackValue();
 }
 
-ErrCode WallpaperService::SetWallpaperV9(int fd, int32_t wallpaperType, int32_t length)
+uint32_t WallpaperService::UnpackColor(uint64_t color)
 {
-    if (!IsSystemApp()) {
-        HILOG_ERROR("CallingApp is not SystemApp.");
-        close(fd);
-        return E_NOT_SYSTEM_APP;
+    if (color == 0) {
+        return 0;
     }
-    return SetWallpaper(fd, wallpaperType, length);
+    ColorManager::Color unpacked(color);
+    auto toChannel = [](float value, uint32_t shift) {
+        return (static_cast<uint32_t>(std::lround(value * MAX_COLOR_CHANNEL)) & CHANNEL_MASK) << shift;
+    };
+    return toChannel(unpacked.a, ALPHA_SHIFT) | toChannel(unpacked.r, RED_SHIFT) | toChannel(unpacked.g, GREEN_SHIFT)
+           | toChannel(unpacked.b, 0);
 }
 
-ErrCode WallpaperService::SetWallpaperV9ByPixelMap(const WallpaperRawData &wallpaperRawdata, int32_t wallpaperType)
+bool WallpaperService::GetFileDigest(const WallpaperData &wallpaperData, const std::string &filePath,
+    uint64_t &digest)
 {
-    if (!IsSystemApp()) {
-        HILOG_INFO("CallingApp is not SystemApp.");
-        return E_NOT_SYSTEM_APP;
+    auto committed = wallpaperData.fileDigests.find(filePath);
+    if (committed != wallpaperData.fileDigests.end()) {
+        digest = committed->second;
+        return true;
     }
-    return SetWallpaperByPixelMap(wallpaperRawdata, wallpaperType);
+    return ContentDigest::DigestFile(filePath, digest);
 }
 
-ErrorCode WallpaperService::SetWallpaperBackupData(
-    int32_t userId, WallpaperResourceType resourceType, const std::string &uriOrPixelMap, WallpaperType wallpaperType)
+bool WallpaperService::CommitColors(int32_t userId, WallpaperType wallpaperType, int32_t wallpaperId,
+    uint64_t sourceDigest, uint64_t mainColor, const WallpaperPalette &palette)
 {
-    HILOG_INFO("set wallpaper and backup data Start.");
-    if (!OHOS::FileExists(uriOrPixelMap)) {
-        return E_DEAL_FAILED;
+    auto &wallpaperMap = wallpaperType == WALLPAPER_SYSTEM ? systemWallpaperMap_ : lockWallpaperMap_;
+    auto wallpaperLock = GetWallpaperLock(userId, wallpaperType);
+    std::lock_guard<std::mutex> lock(*wallpaperLock);
+    auto iterator = wallpaperMap.Find(userId);
+    if (!iterator.first || iterator.second.wallpaperId != wallpaperId || iterator.second.wallpaperFile.empty()) {
+        HILOG_INFO("Wallpaper changed during color extraction, drop it.");
+        return false;
     }
-    if (!FileDeal::DeleteDir(GetWallpaperDir(userId, wallpaperType), false)) {
-        return E_DEAL_FAILED;
+    WallpaperData &wallpaperData = iterator.second;
+    auto committed = wallpaperData.fileDigests.find(wallpaperData.wallpaperFile);
+    if (committed != wallpaperData.fileDigests.end() && committed->second != sourceDigest) {
+        HILOG_INFO("Wallpaper content changed during color extraction, drop it.");
+        return false;
     }
-    WallpaperData wallpaperData;
-    bool ret = GetWallpaperSafeLocked(userId, wallpaperType, wallpaperData);
-    if (!ret) {
-        HILOG_ERROR("GetWallpaperSafeLocked failed!");
-        return E_DEAL_FAILED;
+    wallpaperData.fileDigests[wallpaperData.wallpaperFile] = sourceDigest;
+    wallpaperData.mainColor = mainColor;
+    wallpaperData.palette = palette;
+    wallpaperMap.InsertOrAssign(userId, wallpaperData);
+    return true;
+}
+
+bool WallpaperService::SaveWallpaperColors(int32_t userId)
+{
+    // Shared by both wallpaper types of the user like wallpapercfg, the snapshot is taken under the same lock
+    // as the write so a later commit is never overwritten by an older snapshot.
+    std::lock_guard<std::mutex> lock(mtx_);
+    cJSON *root = cJSON_CreateObject();
+    if (root == nullptr) {
+        HILOG_ERROR("create object failed.");
+        return false;
     }
-    if (resourceType == PICTURE || resourceType == DEFAULT) {
-        wallpaperData.wallpaperFile = GetWallpaperDir(userId, wallpaperType) + "/"
-                                      + (wallpaperType == WALLPAPER_SYSTEM ? WALLPAPER_HOME : WALLPAPER_LOCK);
+    for (auto wallpaperType : { WALLPAPER_SYSTEM, WALLPAPER_LOCKSCREEN }) {
+        auto iterator = wallpaperType == WALLPAPER_SYSTEM ? systemWallpaperMap_.Find(userId)
+                                                          : lockWallpaperMap_.Find(userId);
+        if (!iterator.first || iterator.second.mainColor == 0) {
+            continue;
+        }
+        const WallpaperData &wallpaperData = iterator.second;
+        auto sourceDigest = wallpaperData.fileDigests.find(wallpaperData.wallpaperFile);
+        if (sourceDigest == wallpaperData.fileDigests.end()) {
+            continue;
+        }
+        cJSON *entry = cJSON_AddObjectToObject(root, wallpaperType == WALLPAPER_SYSTEM ? SYSTEM_COLORS
+                                                                                     : LOCKSCREEN_COLORS);
+        cJSON *dominantColors = cJSON_AddArrayToObject(entry, COLORS_DOMINANT_COLORS);
+        cJSON *swatches = cJSON_AddArrayToObject(entry, COLORS_SWATCHES);
+        // A JSON number cannot hold every 64-bit digest exactly, so it is stored as a decimal string.
+        std::string digest = std::to_string(sourceDigest->second);
+        if (cJSON_AddStringToObject(entry, COLORS_SOURCE_DIGEST, digest.c_str()) == nullptr
+            || cJSON_AddBoolToObject(entry, COLORS_PALETTE_EXTRACTED, wallpaperData.palette.extracted) == nullptr
+            || cJSON_AddNumberToObject(entry, COLORS_MAIN_COLOR, UnpackColor(wallpaperData.mainColor)) == nullptr
+            || dominantColors == nullptr || swatches == nullptr) {
+            HILOG_ERROR("add item to object fail.");
+            cJSON_Delete(root);
+            return false;
+        }
+        // Stored as 0xAARRGGBB, the packed values carry color space bits that are not ours to persist.
+        for (uint64_t color : wallpaperData.palette.dominantColors) {
+            cJSON_AddItemToArray(dominantColors, cJSON_CreateNumber(UnpackColor(color)));
+        }
+        for (uint64_t color : wallpaperData.palette.swatches) {
+            cJSON_AddItemToArray(swatches, cJSON_CreateNumber(UnpackColor(color)));
+        }
     }
-    wallpaperData.resourceType = resourceType;
-    wallpaperData.wallpaperId = MakeWallpaperIdLocked();
-    std::string wallpaperFile;
-    WallpaperService::GetWallpaperFile(resourceType, wallpaperData, wallpaperFile);
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (json == nullptr) {
+        HILOG_ERROR("print colors failed.");
+        return false;
+    }
+    // A lost or torn file only costs a decode, so it is written without a sync.
+    std::string stagingPath = MakeStagingPath();
+    bool written = FileDeal::WriteFile(stagingPath, json, DurabilityMode::NONE);
+    cJSON_free(json);
+    if (!written || !FileDeal::CommitFile(
+        stagingPath, WALLPAPER_USERID_PATH + std::to_string(userId) + "/" + WALLPAPER_COLORS_FILE, false)) {
+        HILOG_ERROR("write colors failed.");
+        FileDeal::DeleteFile(stagingPath);
+        return false;
+    }
+    return true;
+}
+
+void WallpaperService::LoadWallpaperColors(int32_t userId, WallpaperType wallpaperType, WallpaperData &wallpaperData)
+{
+    wallpaperData.mainColor = 0;
+    wallpaperData.palette = WallpaperPalette();
+    std::ifstream file(WALLPAPER_USERID_PATH + std::to_string(userId) + "/" + WALLPAPER_COLORS_FILE);
+    if (!file.is_open()) {
+        return;
+    }
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    cJSON *root = cJSON_Parse(content.c_str());
+    if (root == nullptr) {
+        HILOG_ERROR("Failed to parse colors.");
+        return;
+    }
+    cJSON *entry = cJSON_GetObjectItemCaseSensitive(
+        root, wallpaperType == WALLPAPER_SYSTEM ? SYSTEM_COLORS : LOCKSCREEN_COLORS);
+    cJSON *digestItem = cJSON_GetObjectItemCaseSensitive(entry, COLORS_SOURCE_DIGEST);
+    cJSON *extractedItem = cJSON_GetObjectItemCaseSensitive(entry, COLORS_PALETTE_EXTRACTED);
+    cJSON *mainColor = cJSON_GetObjectItemCaseSensitive(entry, COLORS_MAIN_COLOR);
+    cJSON *dominantColors = cJSON_GetObjectItemCaseSensitive(entry, COLORS_DOMINANT_COLORS);
+    cJSON *swatches = cJSON_GetObjectItemCaseSensitive(entry, COLORS_SWATCHES);
+    if (!cJSON_IsString(digestItem) || !cJSON_IsBool(extractedItem) || !cJSON_IsNumber(mainColor)
+        || wallpaperData.wallpaperFile.empty()) {
+        cJSON_Delete(root);
+        return;
+    }
+    // Colors of another picture are ignored, SaveColor extracts the current ones. The content is compared instead
+    // of wallpaperId, which every default picture shares.
+    uint64_t sourceDigest = 0;
+    if (!GetFileDigest(wallpaperData, wallpaperData.wallpaperFile, sourceDigest)) {
+        cJSON_Delete(root);
+        return;
+    }
+    wallpaperData.fileDigests[wallpaperData.wallpaperFile] = sourceDigest;
+    if (std::to_string(sourceDigest) != digestItem->valuestring) {
+        cJSON_Delete(root);
+        return;
+    }
+    // A hand edited or truncated file must not wrap into a wrong color, such an entry is dropped.
+    auto toColor = [](const cJSON *item, uint64_t &color) {
+        if (!cJSON_IsNumber(item) || item->valuedouble < 0
+            || item->valuedouble > static_cast<double>(std::numeric_limits<uint32_t>::max())) {
+            return false;
+        }
+        color = PackColor(static_cast<uint32_t>(item->valuedouble));
+        return true;
+    };
+    auto toColors = [&toColor](const cJSON *array, std::vector<uint64_t> &colors) {
+        if (!cJSON_IsArray(array)) {
+            return false;
+        }
+        const cJSON *item = nullptr;
+        cJSON_ArrayForEach(item, array) {
+            if (!toColor(item, colors.emplace_back())) {
+                return false;
+            }
+        }
+        return true;
+    };
+    uint64_t packedMainColor = 0;
+    WallpaperPalette palette;
+    palette.extracted = cJSON_IsTrue(extractedItem);
+    bool valid = toColor(mainColor, packedMainColor) && toColors(dominantColors, palette.dominantColors)
+                 && toColors(swatches, palette.swatches)
+                 && (!palette.extracted || palette.swatches.size() == static_cast<size_t>(SWATCH_COUNT));
+    cJSON_Delete(root);
+    if (!valid) {
+        HILOG_WARN("Malformed colors of %{public}d, extract them again.", static_cast<int32_t>(wallpaperType));
+        return;
+    }
+    wallpaperData.mainColor = packedMainColor;
+    wallpaperData.palette = std::move(palette);
+}
+
+void WallpaperService::PostSaveColorTask(int32_t userId, WallpaperType wallpaperType)
+{
+    // Color extraction decodes the whole picture, it never runs on the binder thread. The handler lives as long as
+    // the service runs, so a task posted here never outlives this.
+    auto handler = serviceHandler_;
+    if (handler == nullptr) {
+        HILOG_ERROR("Service handler is null, colors are not extracted!");
+        return;
+    }
+    // Run after the reply and only for the newest set of a slot.
+    std::string taskName = std::string(SAVE_COLOR_TASK_NAME) + "_" + std::to_string(userId) + "_"
+                           + std::to_string(static_cast<int32_t>(wallpaperType));
+    handler->RemoveTask(taskName);
+    auto callback = [this, userId, wallpaperType]() { SaveColor(userId, wallpaperType); };
+    if (!handler->PostTask(callback, taskName)) {
+        HILOG_ERROR("Post save color task failed!");
+    }
+}
+
+void WallpaperService::PostRenditionTask(int32_t userId, WallpaperType wallpaperType)
+{
+    // Same as PostSaveColorTask, renditions are only generated on serviceHandler_.
+    auto handler = serviceHandler_;
+    if (handler == nullptr) {
+        HILOG_ERROR("Service handler is null, renditions are not generated!");
+        return;
+    }
+    std::string taskName = std::string(RENDITION_TASK_NAME) + "_" + std::to_string(userId) + "_"
+                           + std::to_string(static_cast<int32_t>(wallpaperType));
+    handler->RemoveTask(taskName);
+    auto callback = [this, userId, wallpaperType]() { GenerateRenditions(userId, wallpaperType); };
+    if (!handler->PostTask(callback, taskName)) {
+        HILOG_ERROR("Post rendition task failed!");
+    }
+}
+
+bool WallpaperService::GenerateRenditions(int32_t userId, WallpaperType wallpaperType)
+{
+    auto &wallpaperMap = wallpaperType == WALLPAPER_SYSTEM ? systemWallpaperMap_ : lockWallpaperMap_;
+    auto wallpaperLock = GetWallpaperLock(userId, wallpaperType);
+    WallpaperData wallpaperData;
     {
-        std::lock_guard<std::mutex> lock(mtx_);
-        if (!FileDeal::CopyFile(uriOrPixelMap, wallpaperFile)) {
-            HILOG_ERROR("CopyFile failed!");
+        std::lock_guard<std::mutex> lock(*wallpaperLock);
+        auto iterator = wallpaperMap.Find(userId);
+        if (!iterator.first || iterator.second.resourceType != PICTURE
+            || iterator.second.wallpaperId == DEFAULT_WALLPAPER_ID) {
+            return false;
+        }
+        wallpaperData = iterator.second;
+    }
+    // Renditions are derived from the committed pictures, so they are encoded without holding the slot lock.
+    std::string wallpaperDir = GetWallpaperDir(userId, wallpaperType) + "/";
+    bool textureEnabled = IsTextureSidecarEnabled();
+    std::vector<StagedThumbnail> stagedThumbnails;
+    std::map<std::string, std::string> stagedTextures;
+    std::set<std::string> sourceFiles;
+    for (const auto &variantFile : GetWallpaperVariantFiles(wallpaperData)) {
+        const std::string &sourceFile = variantFile.second;
+        if (sourceFile.compare(0, wallpaperDir.size(), wallpaperDir) != 0 || !sourceFiles.insert(sourceFile).second) {
+            continue;
+        }
+        if (!StageThumbnails(sourceFile, wallpaperData.formatHint, stagedThumbnails)) {
+            HILOG_WARN("Stage thumbnails failed, the source picture is served instead.");
+        }
+        std::string stagingPath;
+        if (textureEnabled && StageTexture(sourceFile, wallpaperData.formatHint, stagingPath)) {
+            stagedTextures[sourceFile] = stagingPath;
+        }
+    }
+    if (stagedThumbnails.empty() && stagedTextures.empty()) {
+        return false;
+    }
+    bool synced = FileDeal::SyncFileSystem(WALLPAPER_USERID_PATH);
+    std::lock_guard<std::mutex> lock(*wallpaperLock);
+    auto iterator = wallpaperMap.Find(userId);
+    // A set that landed meanwhile deleted the source pictures, its own task renders the new ones.
+    bool current = synced && iterator.first && iterator.second.wallpaperId == wallpaperData.wallpaperId;
+    CommitRenditions(current, stagedThumbnails, stagedTextures, iterator.second);
+    if (!current) {
+        return false;
+    }
+    wallpaperMap.InsertOrAssign(userId, iterator.second);
+    HILOG_INFO("Generate renditions for %{public}d pictures, textures %{public}d.",
+        static_cast<int32_t>(iterator.second.thumbnailFiles.size()),
+        static_cast<int32_t>(iterator.second.textureFiles.size()));
+    return true;
+}
+
+void WallpaperService::CommitRenditions(bool current, const std::vector<StagedThumbnail> &stagedThumbnails,
+    const std::map<std::string, std::string> &stagedTextures, WallpaperData &wallpaperData)
+{
+    wallpaperData.thumbnailFiles.clear();
+    wallpaperData.textureFiles.clear();
+    for (const auto &stagedThumbnail : stagedThumbnails) {
+        std::string thumbnailFile = GetThumbnailFile(stagedThumbnail.sourceFile, stagedThumbnail.longEdge);
+        if (!current || !FileDeal::CommitFile(stagedThumbnail.stagingPath, thumbnailFile, false)) {
+            FileDeal::DeleteFile(stagedThumbnail.stagingPath);
+            continue;
+        }
+        wallpaperData.thumbnailFiles[stagedThumbnail.sourceFile][stagedThumbnail.longEdge] = thumbnailFile;
+    }
+    for (const auto &stagedTexture : stagedTextures) {
+        std::string textureFile = GetTextureFile(stagedTexture.first);
+        if (!current || !FileDeal::CommitFile(stagedTexture.second, textureFile, false)) {
+            FileDeal::DeleteFile(stagedTexture.second);
+            continue;
+        }
+        wallpaperData.textureFiles[stagedTexture.first] = textureFile;
+    }
+}
+
+bool WallpaperService::StageThumbnails(
+    const std::string &sourceFile, const std::string &formatHint, std::vector<StagedThumbnail> &stagedThumbnails)
+{
+    uint32_t errorCode = 0;
+    OHOS::Media::SourceOptions opts;
+    opts.formatHint = formatHint.empty() ? MIME_TYPE_JPEG : formatHint;
+    std::unique_ptr<OHOS::Media::ImageSource> imageSource =
+        OHOS::Media::ImageSource::CreateImageSource(sourceFile, opts, errorCode);
+    if (errorCode != 0 || imageSource == nullptr) {
+        HILOG_ERROR("CreateImageSource failed!");
+        return false;
+    }
+    OHOS::Media::ImageInfo imageInfo;
+    if (imageSource->GetImageInfo(imageInfo) != 0) {
+        HILOG_ERROR("GetImageInfo failed!");
+        return false;
+    }
+    OHOS::Media::PackOption option;
+    GetStoragePackOption(STORAGE_JPEG_HIGH, option);
+    for (int32_t level = 1; level <= THUMBNAIL_LEVELS; level++) {
+        int32_t width = imageInfo.size.width >> level;
+        int32_t height = imageInfo.size.height >> level;
+        int32_t longEdge = std::max(width, height);
+        if (width <= 0 || height <= 0 || longEdge < MIN_THUMBNAIL_EDGE) {
+            break;
+        }
+        // Power of two sizes let the JPEG decoder scale in the DCT domain, each level costs a fraction of the source.
+        OHOS::Media::DecodeOptions decodeOpts;
+        decodeOpts.desiredSize = { width, height };
+        std::shared_ptr<PixelMap> pixelMap = imageSource->CreatePixelMap(decodeOpts, errorCode);
+        if (errorCode != 0 || pixelMap == nullptr) {
+            HILOG_ERROR("CreatePixelMap failed, level %{public}d.", level);
+            return false;
+        }
+        std::string stagingPath = MakeStagingPath();
+        if (!WriteRenditionFile(pixelMap, stagingPath, option)) {
+            return false;
+        }
+        stagedThumbnails.push_back({ sourceFile, longEdge, stagingPath });
+    }
+    return true;
+}
+
+bool WallpaperService::WriteRenditionFile(std::shared_ptr<OHOS::Media::PixelMap> pixelMap,
+    const std::string &filePath, const OHOS::Media::PackOption &option)
+{
+    int32_t fd = open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        HILOG_ERROR("Open rendition file failed, errno %{public}d", errno);
+        return false;
+    }
+    fdsan_exchange_owner_tag(fd, 0, WP_DOMAIN);
+    StreamWriter writer(fd);
+    writer.SetMaxSize(FOO_MAX_LEN);
+    StreamWriterBuf streamBuf(writer);
+    std::ostream ostream(&streamBuf);
+    int64_t packedSize = WritePixelMapToStream(pixelMap, ostream, option);
+    // All renditions of a set are synced by one syncfs before they are committed.
+    bool written = packedSize > 0 && writer.Flush() && FileDeal::SyncFd(fd, DurabilityMode::BATCHED_SYNC);
+    fdsan_close_with_tag(fd, WP_DOMAIN);
+    if (!written) {
+        HILOG_ERROR("Write rendition file failed!");
+        FileDeal::DeleteFile(filePath);
+        return false;
+    }
+    return true;
+}
+
+std::string WallpaperService::GetThumbnailFile(const std::string &sourceFile, int32_t longEdge)
+{
+    return sourceFile + THUMBNAIL_SEPARATOR + std::to_string(longEdge);
+}
+
+void WallpaperService::LoadThumbnailFiles(const std::string &wallpaperDir, WallpaperData &wallpaperData)
+{
+    wallpaperData.thumbnailFiles.clear();
+    std::set<std::string> sourceFiles;
+    for (const auto &variantFile : GetWallpaperVariantFiles(wallpaperData)) {
+        sourceFiles.insert(variantFile.second);
+    }
+    DIR *dir = opendir(wallpaperDir.c_str());
+    if (dir == nullptr) {
+        return;
+    }
+    dirent *dirent;
+    while ((dirent = readdir(dir)) != nullptr) {
+        std::string name = dirent->d_name;
+        size_t pos = name.rfind(THUMBNAIL_SEPARATOR);
+        if (pos == std::string::npos) {
+            continue;
+        }
+        std::string longEdge = name.substr(pos + strlen(THUMBNAIL_SEPARATOR));
+        std::string sourceFile = wallpaperDir + "/" + name.substr(0, pos);
+        // Renditions of an older set are left for the next set to collect and never served.
+        if (longEdge.empty() || longEdge.size() > MAX_VERSION_DIGITS
+            || longEdge.find_first_not_of("0123456789") != std::string::npos || sourceFiles.count(sourceFile) == 0) {
+            continue;
+        }
+        wallpaperData.thumbnailFiles[sourceFile][std::stoi(longEdge)] = wallpaperDir + "/" + name;
+    }
+    closedir(dir);
+}
+
+std::string WallpaperService::PickThumbnailFile(
+    const WallpaperData &wallpaperData, const std::string &sourceFile, int32_t maxEdge)
+{
+    auto thumbnails = wallpaperData.thumbnailFiles.find(sourceFile);
+    if (thumbnails == wallpaperData.thumbnailFiles.end()) {
+        return sourceFile;
+    }
+    // The renditions are ordered by long edge, the first one reaching maxEdge is the smallest that satisfies it.
+    auto thumbnail = thumbnails->second.lower_bound(maxEdge);
+    return thumbnail == thumbnails->second.end() ? sourceFile : thumbnail->second;
+}
+
+bool WallpaperService::IsTextureSidecarEnabled()
+{
+    return GetIntParameter(TEXTURE_SIDECAR_PARAM, 0) != 0 && IsPackFormatSupported(MIME_TYPE_ASTC_4X4);
+}
+
+bool WallpaperService::StageTexture(
+    const std::string &sourceFile, const std::string &formatHint, std::string &stagingPath)
+{
+    uint32_t errorCode = 0;
+    OHOS::Media::SourceOptions opts;
+    opts.formatHint = formatHint.empty() ? MIME_TYPE_JPEG : formatHint;
+    std::unique_ptr<OHOS::Media::ImageSource> imageSource =
+        OHOS::Media::ImageSource::CreateImageSource(sourceFile, opts, errorCode);
+    if (errorCode != 0 || imageSource == nullptr) {
+        HILOG_ERROR("CreateImageSource failed!");
+        return false;
+    }
+    // The block encoder reads RGBA, the full size decode is dropped once the texture is written.
+    OHOS::Media::DecodeOptions decodeOpts;
+    decodeOpts.desiredPixelFormat = OHOS::Media::PixelFormat::RGBA_8888;
+    std::shared_ptr<PixelMap> pixelMap = imageSource->CreatePixelMap(decodeOpts, errorCode);
+    if (errorCode != 0 || pixelMap == nullptr) {
+        HILOG_ERROR("CreatePixelMap failed!");
+        return false;
+    }
+    OHOS::Media::PackOption option;
+    option.format = MIME_TYPE_ASTC_4X4;
+    option.quality = OPTION_QUALITY;
+    option.numberHint = 1;
+    stagingPath = MakeStagingPath();
+    return WriteRenditionFile(pixelMap, stagingPath, option);
+}
+
+std::string WallpaperService::GetTextureFile(const std::string &sourceFile)
+{
+    return sourceFile + TEXTURE_SUFFIX;
+}
+
+void WallpaperService::LoadTextureFiles(WallpaperData &wallpaperData)
+{
+    wallpaperData.textureFiles.clear();
+    for (const auto &variantFile : GetWallpaperVariantFiles(wallpaperData)) {
+        std::string textureFile = GetTextureFile(variantFile.second);
+        if (FileDeal::IsFileExist(textureFile)) {
+            wallpaperData.textureFiles[variantFile.second] = textureFile;
+        }
+    }
+}
+
+bool WallpaperService::ReadTextureHeader(int32_t fd, WallpaperTextureInfo &textureInfo)
+{
+    uint8_t header[ASTC_HEADER_SIZE] = { 0 };
+    if (pread(fd, header, ASTC_HEADER_SIZE, 0) != static_cast<ssize_t>(ASTC_HEADER_SIZE)) {
+        HILOG_ERROR("Read texture header failed, errno %{public}d", errno);
+        return false;
+    }
+    // The ASTC container stores its magic and 24 bit dimensions little endian.
+    auto readLittleEndian = [&header](size_t offset, size_t length) {
+        uint32_t value = 0;
+        for (size_t i = 0; i < length; i++) {
+            value |= static_cast<uint32_t>(header[offset + i]) << (BITS_PER_BYTE * i);
+        }
+        return value;
+    };
+    if (readLittleEndian(0, sizeof(uint32_t)) != ASTC_MAGIC || header[ASTC_BLOCK_OFFSET] != ASTC_BLOCK_EDGE
+        || header[ASTC_BLOCK_OFFSET + 1] != ASTC_BLOCK_EDGE) {
+        HILOG_ERROR("Texture is not an ASTC 4x4 container.");
+        return false;
+    }
+    textureInfo.width = static_cast<int32_t>(readLittleEndian(ASTC_WIDTH_OFFSET, ASTC_DIMENSION_BYTES));
+    textureInfo.height = static_cast<int32_t>(readLittleEndian(ASTC_HEIGHT_OFFSET, ASTC_DIMENSION_BYTES));
+    textureInfo.blockFormat = TEXTURE_FORMAT_ASTC_4X4;
+    textureInfo.mipCount = 1;
+    return true;
+}
+
+ErrCode WallpaperService::SetWallpaper(int fd, int32_t wallpaperType, int32_t length)
+{
+    if (!CheckCallingPermission(WALLPAPER_PERMISSION_NAME_SET_WALLPAPER)) {
+        HILOG_ERROR("SetWallpaper no set permission.");
+        return E_NO_PERMISSION;
+    }
+    StartAsyncTrace(HITRACE_TAG_MISC, "SetWallpaper", static_cast<int32_t>(TraceTaskId::SET_WALLPAPER));
+    ErrorCode wallpaperErrorCode = SetWallpaper(fd, wallpaperType, length, PICTURE);
+    FinishAsyncTrace(HITRACE_TAG_MISC, "SetWallpaper", static_cast<int32_t>(TraceTaskId::SET_WALLPAPER));
+    close(fd);
+    return wallpaperErrorCode;
+}
+
+ErrCode WallpaperService::SetWallpaperByPixelMap(
+    const WallpaperRawData &wallpaperRawdata, int32_t wallpaperType, int32_t storageFormat)
+{
+    if (!CheckCallingPermission(WALLPAPER_PERMISSION_NAME_SET_WALLPAPER)) {
+        HILOG_ERROR("SetWallpaper no set permission.");
+        return E_NO_PERMISSION;
+    }
+    auto *rawData = (uint8_t *)wallpaperRawdata.data;
+    if (rawData == nullptr) {
+        HILOG_ERROR("rawData is nullptr!");
+        return E_FILE_ERROR;
+    }
+    std::vector<uint8_t> VectorPixelMap(rawData, rawData + wallpaperRawdata.size);
+    if (VectorPixelMap.size() == 0) {
+        HILOG_ERROR("VectorPixelMap  is nullptr!");
+        return E_FILE_ERROR;
+    }
+    std::shared_ptr<OHOS::Media::PixelMap> pixelMap = std::shared_ptr<PixelMap>(PixelMap::DecodeTlv(VectorPixelMap));
+    if (pixelMap == nullptr) {
+        HILOG_ERROR("pixelMap is nullptr");
+        return E_FILE_ERROR;
+    }
+    StartAsyncTrace(HITRACE_TAG_MISC, "SetWallpaper", static_cast<int32_t>(TraceTaskId::SET_WALLPAPER));
+    ErrorCode wallpaperErrorCode = SetWallpaperByPixelMap(pixelMap, wallpaperType, PICTURE, storageFormat);
+    FinishAsyncTrace(HITRACE_TAG_MISC, "SetWallpaper", static_cast<int32_t>(TraceTaskId::SET_WALLPAPER));
+    return wallpaperErrorCode;
+}
+
+ErrCode WallpaperService::SetWallpaperV9(int fd, int32_t wallpaperType, int32_t length)
+{
+    if (!IsSystemApp()) {
+        HILOG_ERROR("CallingApp is not SystemApp.");
+        close(fd);
+        return E_NOT_SYSTEM_APP;
+    }
+    return SetWallpaper(fd, wallpaperType, length);
+}
+
+ErrCode WallpaperService::SetWallpaperV9ByPixelMap(
+    const WallpaperRawData &wallpaperRawdata, int32_t wallpaperType, int32_t storageFormat)
+{
+    if (!IsSystemApp()) {
+        HILOG_INFO("CallingApp is not SystemApp.");
+        return E_NOT_SYSTEM_APP;
+    }
+    return SetWallpaperByPixelMap(wallpaperRawdata, wallpaperType, storageFormat);
+}
+
+ErrCode WallpaperService::SetWallpaperBySharedPixels(int fd, int32_t wallpaperType, int32_t storageFormat)
+{
+    if (!CheckCallingPermission(WALLPAPER_PERMISSION_NAME_SET_WALLPAPER)) {
+        HILOG_ERROR("SetWallpaper no set permission.");
+        close(fd);
+        return E_NO_PERMISSION;
+    }
+    std::shared_ptr<OHOS::Media::PixelMap> pixelMap = CreatePixelMapBySharedPixels(fd);
+    close(fd);
+    if (pixelMap == nullptr) {
+        HILOG_ERROR("pixelMap is nullptr");
+        return E_FILE_ERROR;
+    }
+    StartAsyncTrace(HITRACE_TAG_MISC, "SetWallpaper", static_cast<int32_t>(TraceTaskId::SET_WALLPAPER));
+    ErrorCode wallpaperErrorCode = SetWallpaperByPixelMap(pixelMap, wallpaperType, PICTURE, storageFormat);
+    FinishAsyncTrace(HITRACE_TAG_MISC, "SetWallpaper", static_cast<int32_t>(TraceTaskId::SET_WALLPAPER));
+    return wallpaperErrorCode;
+}
+
+ErrCode WallpaperService::SetWallpaperV9BySharedPixels(int fd, int32_t wallpaperType, int32_t storageFormat)
+{
+    if (!IsSystemApp()) {
+        HILOG_INFO("CallingApp is not SystemApp.");
+        close(fd);
+        return E_NOT_SYSTEM_APP;
+    }
+    return SetWallpaperBySharedPixels(fd, wallpaperType, storageFormat);
+}
+
+std::shared_ptr<OHOS::Media::PixelMap> WallpaperService::CreatePixelMapBySharedPixels(int32_t fd)
+{
+    auto sharedPixels = std::make_shared<SharedPixels>();
+    if (!sharedPixels->Map(fd)) {
+        return nullptr;
+    }
+    const SharedPixelsHeader &header = sharedPixels->GetHeader();
+    auto pixelFormat = static_cast<OHOS::Media::PixelFormat>(header.pixelFormat);
+    if (pixelFormat != OHOS::Media::PixelFormat::RGBA_8888 && pixelFormat != OHOS::Media::PixelFormat::BGRA_8888) {
+        HILOG_ERROR("Unsupported shared pixel format %{public}d", header.pixelFormat);
+        return nullptr;
+    }
+    if (static_cast<int64_t>(header.rowStride) == static_cast<int64_t>(header.width) * sizeof(uint32_t)) {
+        return WrapSharedPixels(sharedPixels);
+    }
+    OHOS::Media::InitializationOptions opts;
+    opts.size = { header.width, header.height };
+    opts.srcPixelFormat = pixelFormat;
+    opts.pixelFormat = pixelFormat;
+    opts.alphaType = static_cast<OHOS::Media::AlphaType>(header.alphaType);
+    // PixelMap rows are packed, padded rows are copied once into a PixelMap the packer can encode from.
+    std::unique_ptr<OHOS::Media::PixelMap> pixelMap =
+        PixelMap::Create(static_cast<const uint32_t *>(sharedPixels->GetPixels()),
+            static_cast<uint32_t>(header.pixelsSize / sizeof(uint32_t)), 0,
+            static_cast<int32_t>(header.rowStride / sizeof(uint32_t)), opts);
+    return std::shared_ptr<OHOS::Media::PixelMap>(std::move(pixelMap));
+}
+
+std::shared_ptr<OHOS::Media::PixelMap> WallpaperService::WrapSharedPixels(std::shared_ptr<SharedPixels> sharedPixels)
+{
+    const SharedPixelsHeader &header = sharedPixels->GetHeader();
+    OHOS::Media::ImageInfo imageInfo;
+    imageInfo.size = { header.width, header.height };
+    imageInfo.pixelFormat = static_cast<OHOS::Media::PixelFormat>(header.pixelFormat);
+    imageInfo.alphaType = static_cast<OHOS::Media::AlphaType>(header.alphaType);
+    auto *pixelMap = new (std::nothrow) OHOS::Media::PixelMap();
+    if (pixelMap == nullptr || pixelMap->SetImageInfo(imageInfo) != OHOS::Media::SUCCESS) {
+        HILOG_ERROR("Init shared pixel map failed.");
+        delete pixelMap;
+        return nullptr;
+    }
+    // The PixelMap reads the sealed pages in place and is only handed to the packer, which never writes them.
+    // CUSTOM_ALLOC without a free function leaves the pages alone, the mapping goes with the last PixelMap ref.
+    pixelMap->SetPixelsAddr(const_cast<void *>(sharedPixels->GetPixels()), nullptr,
+        static_cast<uint32_t>(header.pixelsSize), OHOS::Media::AllocatorType::CUSTOM_ALLOC, nullptr);
+    return std::shared_ptr<OHOS::Media::PixelMap>(pixelMap, [sharedPixels](OHOS::Media::PixelMap *pixels) {
+        delete pixels;
+    });
+}
+
+ErrorCode WallpaperService::SetWallpaperBackupData(int32_t userId, WallpaperResourceType resourceType,
+    const std::string &uriOrPixelMap, WallpaperType wallpaperType, const std::string &formatHint,
+    const std::map<std::string, uint64_t> &digests)
+{
+    HILOG_INFO("set wallpaper and backup data Start.");
+    if (!OHOS::FileExists(uriOrPixelMap)) {
+        return E_DEAL_FAILED;
+    }
+    // Sets of the same slot queue on its lock; a picture still waiting there when a newer set arrives is dropped.
+    uint64_t ticket = IssueSetTicket(userId, wallpaperType);
+    {
+        auto wallpaperLock = GetWallpaperLock(userId, wallpaperType);
+        std::lock_guard<std::mutex> lock(*wallpaperLock);
+        if (resourceType == PICTURE && IsSetSuperseded(userId, wallpaperType, ticket)) {
+            HILOG_INFO("Wallpaper set superseded by a newer one, skip set.");
+            FileDeal::DeleteFile(uriOrPixelMap);
+            return E_SUPERSEDED;
+        }
+        WallpaperData wallpaperData;
+        bool ret = GetWallpaperSafeLocked(userId, wallpaperType, wallpaperData);
+        if (!ret) {
+            HILOG_ERROR("GetWallpaperSafeLocked failed!");
             FileDeal::DeleteFile(uriOrPixelMap);
             return E_DEAL_FAILED;
         }
-        if (!FileDeal::DeleteFile(uriOrPixelMap)) {
+        if (IsWallpaperUnchanged(userId, wallpaperType, resourceType, digests)) {
+            HILOG_INFO("Wallpaper content unchanged, skip set.");
+            FileDeal::DeleteFile(uriOrPixelMap);
+            return NO_ERROR;
+        }
+        wallpaperData.resourceType = resourceType;
+        wallpaperData.formatHint = formatHint;
+        wallpaperData.thumbnailFiles.clear();
+        wallpaperData.textureFiles.clear();
+        wallpaperData.mainColor = 0;
+        wallpaperData.palette = WallpaperPalette();
+        wallpaperData.wallpaperId = MakeWallpaperIdLocked();
+        if (resourceType == PICTURE || resourceType == DEFAULT) {
+            wallpaperData.wallpaperFile = GetVersionedFile(GetWallpaperDir(userId, wallpaperType) + "/"
+                + (wallpaperType == WALLPAPER_SYSTEM ? WALLPAPER_HOME : WALLPAPER_LOCK), wallpaperData.wallpaperId);
+        }
+        std::string wallpaperFile;
+        WallpaperService::GetWallpaperFile(resourceType, wallpaperData, wallpaperFile);
+        if (!FileDeal::CommitFile(uriOrPixelMap, wallpaperFile)) {
+            HILOG_ERROR("CommitFile failed!");
+            FileDeal::DeleteFile(uriOrPixelMap);
             return E_DEAL_FAILED;
         }
+        SetWallpaperDigests(wallpaperData, digests);
+        // Only an encoded PixelMap has a known format, it is kept in the manifest so it survives a restart.
+        std::vector<std::string> keepFiles = { wallpaperFile };
+        if (!formatHint.empty() && WriteWallpaperManifest(GetWallpaperDir(userId, wallpaperType), wallpaperData)) {
+            keepFiles.push_back(GetWallpaperDir(userId, wallpaperType) + "/" + WALLPAPER_SET_MANIFEST);
+        }
+        if (!SaveWallpaperState(userId, wallpaperType, resourceType)) {
+            HILOG_ERROR("Save wallpaper state failed!");
+            return E_DEAL_FAILED;
+        }
+        auto publishLock = GetPublishLock(userId, wallpaperType);
+        std::lock_guard<std::shared_mutex> publish(*publishLock);
+        if (wallpaperType == WALLPAPER_SYSTEM) {
+            systemWallpaperMap_.InsertOrAssign(userId, wallpaperData);
+        } else if (wallpaperType == WALLPAPER_LOCKSCREEN) {
+            lockWallpaperMap_.InsertOrAssign(userId, wallpaperData);
+        }
+        wallpaperFdCache_.Invalidate(userId, wallpaperType);
+        // Readers resolve and open under the shared publish lock, so previous versions can go once the map points
+        // at the new one.
+        if (!FileDeal::DeleteDirExcept(GetWallpaperDir(userId, wallpaperType), keepFiles)) {
+            HILOG_WARN("Clear previous wallpaper files failed!");
+        }
     }
-    if (!SaveWallpaperState(userId, wallpaperType, resourceType)) {
-        HILOG_ERROR("Save wallpaper state failed!");
-        return E_DEAL_FAILED;
-    }
-    if (wallpaperType == WALLPAPER_SYSTEM) {
-        systemWallpaperMap_.InsertOrAssign(userId, wallpaperData);
-    } else if (wallpaperType == WALLPAPER_LOCKSCREEN) {
-        lockWallpaperMap_.InsertOrAssign(userId, wallpaperData);
+    if (resourceType == PICTURE) {
+        PostSaveColorTask(userId, wallpaperType);
+        PostRenditionTask(userId, wallpaperType);
     }
     if (!SendWallpaperChangeEvent(userId, wallpaperType)) {
         HILOG_ERROR("Send wallpaper state failed!");
@@ -988,6 +2148,7 @@ ErrCode WallpaperService::SetCustomWallpaper(int fd, int32_t type, int32_t lengt
     } else if (wallpaperType == WALLPAPER_LOCKSCREEN) {
         lockWallpaperMap_.InsertOrAssign(userId, wallpaperData);
     }
+    wallpaperFdCache_.Invalidate(userId, wallpaperType);
     if (!SendWallpaperChangeEvent(userId, wallpaperType)) {
         HILOG_ERROR("Send wallpaper state failed!");
         close(fd);
@@ -998,7 +2159,17 @@ ErrCode WallpaperService::SetCustomWallpaper(int fd, int32_t type, int32_t lengt
     return wallpaperErrorCode;
 }
 
-ErrCode WallpaperService::GetPixelMap(int32_t wallpaperType, int32_t &size, int &fd)
+ErrCode WallpaperService::GetPixelMap(int32_t wallpaperType, int32_t &size, bool &hasFd, int &fd)
+{
+    WallpaperHandle handle;
+    ErrorCode ret = GetWallpaperHandle(wallpaperType, handle);
+    size = handle.GetSize();
+    hasFd = handle.GetFd() >= 0;
+    fd = handle.Release();
+    return ret;
+}
+
+ErrorCode WallpaperService::GetWallpaperHandle(int32_t wallpaperType, WallpaperHandle &handle)
 {
     HILOG_INFO("WallpaperService::getPixelMap start.");
     if (!IsSystemApp()) {
@@ -1016,30 +2187,30 @@ ErrCode WallpaperService::GetPixelMap(int32_t wallpaperType, int32_t &size, int
     auto type = static_cast<WallpaperType>(wallpaperType);
     int32_t userId = QueryActiveUserId();
     HILOG_INFO("QueryCurrentOsAccount userId: %{public}d", userId);
-    // current user's wallpaper is live video, not image
+    // current user's wallpaper is live video, not image, the handle stays empty
     WallpaperResourceType resType = GetResType(userId, type);
     if (resType != PICTURE && resType != DEFAULT) {
         HILOG_ERROR("Current user's wallpaper is live video, not image.");
-        size = 0; // 0: empty file size
-        fd = -1;  // -1: invalid file description
         return NO_ERROR;
     }
-    ErrorCode ret = GetImageSize(userId, type, size);
-    if (ret != NO_ERROR) {
-        HILOG_ERROR("GetImageSize failed!");
-        return ret;
-    }
-    ret = GetImageFd(userId, type, fd);
+    WallpaperFdKey key(userId, type, static_cast<int32_t>(FoldState::NORMAL), static_cast<int32_t>(RotateState::PORT));
+    ErrorCode ret = OpenCachedWallpaperHandle(
+        key,
+        [](const WallpaperData &wallpaperData, std::string &filePath) {
+            filePath = wallpaperData.wallpaperFile;
+            return !filePath.empty();
+        },
+        handle);
     if (ret != NO_ERROR) {
-        HILOG_ERROR("GetImageFd failed!");
+        HILOG_ERROR("OpenWallpaperHandle failed!");
         return ret;
     }
     return NO_ERROR;
 }
 
-ErrCode WallpaperService::GetPixelMapV9(int32_t wallpaperType, int32_t &size, int &fd)
+ErrCode WallpaperService::GetPixelMapV9(int32_t wallpaperType, int32_t &size, bool &hasFd, int &fd)
 {
-    return GetPixelMap(wallpaperType, size, fd);
+    return GetPixelMap(wallpaperType, size, hasFd, fd);
 }
 
 int32_t WallpaperService::GetWallpaperId(int32_t wallpaperType)
@@ -1063,6 +2234,25 @@ int32_t WallpaperService::GetWallpaperId(int32_t wallpaperType)
     return iWallpaperId;
 }
 
+ErrCode WallpaperService::CheckWallpaperAccess(int32_t wallpaperType, int32_t &wallpaperId)
+{
+    // Same checks as GetPixelMap and GetCorrespondWallpaper, clients validate their cached decodes with it.
+    if (!IsSystemApp()) {
+        HILOG_ERROR("CallingApp is not SystemApp.");
+        return E_NOT_SYSTEM_APP;
+    }
+    if (!CheckCallingPermission(WALLPAPER_PERMISSION_NAME_GET_WALLPAPER)) {
+        HILOG_ERROR("CheckWallpaperAccess no get permission!");
+        return E_NO_PERMISSION;
+    }
+    if (wallpaperType != static_cast<int32_t>(WALLPAPER_LOCKSCREEN)
+        && wallpaperType != static_cast<int32_t>(WALLPAPER_SYSTEM)) {
+        return E_PARAMETERS_INVALID;
+    }
+    wallpaperId = GetWallpaperId(wallpaperType);
+    return NO_ERROR;
+}
+
 ErrCode WallpaperService::IsChangePermitted(bool &isChangePermitted)
 {
     HILOG_INFO("IsChangePermitted wallpaper Start.");
@@ -1112,31 +2302,38 @@ ErrCode WallpaperService::ResetWallpaperV9(int32_t wallpaperType)
 
 ErrorCode WallpaperService::SetDefaultDataForWallpaper(int32_t userId, WallpaperType wallpaperType)
 {
-    WallpaperData wallpaperData;
-    if (!GetWallpaperSafeLocked(userId, wallpaperType, wallpaperData)) {
-        return E_DEAL_FAILED;
-    }
-    if (!RestoreUserResources(userId, wallpaperData, wallpaperType)) {
-        HILOG_ERROR("RestoreUserResources error!");
-        return E_DEAL_FAILED;
-    }
-    if (!SaveWallpaperState(userId, wallpaperType, DEFAULT)) {
-        HILOG_ERROR("Save wallpaper state failed!");
-        return E_DEAL_FAILED;
-    }
-    wallpaperData.wallpaperId = DEFAULT_WALLPAPER_ID;
-    wallpaperData.resourceType = DEFAULT;
-    wallpaperData.allowBackup = true;
-    if (wallpaperType == WALLPAPER_LOCKSCREEN) {
-        lockWallpaperMap_.InsertOrAssign(userId, wallpaperData);
-    } else if (wallpaperType == WALLPAPER_SYSTEM) {
-        systemWallpaperMap_.InsertOrAssign(userId, wallpaperData);
+    {
+        auto wallpaperLock = GetWallpaperLock(userId, wallpaperType);
+        std::lock_guard<std::mutex> lock(*wallpaperLock);
+        WallpaperData wallpaperData;
+        if (!GetWallpaperSafeLocked(userId, wallpaperType, wallpaperData)) {
+            return E_DEAL_FAILED;
+        }
+        auto publishLock = GetPublishLock(userId, wallpaperType);
+        std::lock_guard<std::shared_mutex> publish(*publishLock);
+        if (!RestoreUserResources(userId, wallpaperData, wallpaperType)) {
+            HILOG_ERROR("RestoreUserResources error!");
+            return E_DEAL_FAILED;
+        }
+        if (!SaveWallpaperState(userId, wallpaperType, DEFAULT)) {
+            HILOG_ERROR("Save wallpaper state failed!");
+            return E_DEAL_FAILED;
+        }
+        wallpaperData.wallpaperId = DEFAULT_WALLPAPER_ID;
+        wallpaperData.resourceType = DEFAULT;
+        wallpaperData.allowBackup = true;
+        if (wallpaperType == WALLPAPER_LOCKSCREEN) {
+            lockWallpaperMap_.InsertOrAssign(userId, wallpaperData);
+        } else if (wallpaperType == WALLPAPER_SYSTEM) {
+            systemWallpaperMap_.InsertOrAssign(userId, wallpaperData);
+        }
+        wallpaperFdCache_.Invalidate(userId, wallpaperType);
     }
     if (!SendWallpaperChangeEvent(userId, wallpaperType)) {
         HILOG_ERROR("Send wallpaper state failed!");
         return E_DEAL_FAILED;
     }
-    SaveColor(userId, wallpaperType);
+    PostSaveColorTask(userId, wallpaperType);
     return NO_ERROR;
 }
 
@@ -1226,6 +2423,7 @@ void WallpaperService::ClearWallpaperLocked(int32_t userId, WallpaperType wallpa
         } else if (wallpaperType == WALLPAPER_SYSTEM) {
             systemWallpaperMap_.Erase(userId);
         }
+        wallpaperFdCache_.Invalidate(userId, wallpaperType);
     }
 }
 
@@ -1320,52 +2518,20 @@ ErrorCode WallpaperService::GetImageFd(int32_t userId, WallpaperType wallpaperTy
         HILOG_INFO("The current wallpaper is a custom wallpaper");
         return NO_ERROR;
     }
-    {
-        std::lock_guard<std::mutex> lock(mtx_);
-        fd = open(filePathName.c_str(), O_RDONLY, S_IREAD);
-    }
-    if (fd < 0) {
-        HILOG_ERROR("Open file failed, errno %{public}d", errno);
+    ErrorCode ret = OpenWallpaperFile(
+        userId, wallpaperType,
+        [this](const WallpaperData &wallpaperData, std::string &filePath) {
+            return GetFileNameFromData(wallpaperData, filePath);
+        },
+        fd);
+    if (ret != NO_ERROR) {
         ReporterFault(FaultType::LOAD_WALLPAPER_FAULT, FaultCode::RF_FD_INPUT_FAILED);
         return E_DEAL_FAILED;
     }
-    fdsan_exchange_owner_tag(fd, 0, WP_DOMAIN);
     HILOG_INFO("fd = %{public}d", fd);
     return NO_ERROR;
 }
 
-ErrorCode WallpaperService::GetImageSize(int32_t userId, WallpaperType wallpaperType, int32_t &size)
-{
-    HILOG_INFO("WallpaperService::GetImageSize start.");
-    std::string filePathName;
-    HILOG_INFO("userId = %{public}d", userId);
-    if (!GetPictureFileName(userId, wallpaperType, filePathName)) {
-        return E_DEAL_FAILED;
-    }
-
-    if (!OHOS::FileExists(filePathName)) {
-        HILOG_ERROR("file is not exist.");
-        return E_NOT_FOUND;
-    }
-    std::lock_guard<std::mutex> lock(mtx_);
-    FILE *fd = fopen(filePathName.c_str(), "rb");
-    if (fd == nullptr) {
-        HILOG_ERROR("fopen file failed, errno %{public}d", errno);
-        return E_FILE_ERROR;
-    }
-    int32_t fend = fseek(fd, 0, SEEK_END);
-    long length = ftell(fd);
-    int32_t fset = fseek(fd, 0, SEEK_SET);
-    if (length <= 0 || length > INT32_MAX || fend != 0 || fset != 0) {
-        HILOG_ERROR("ftell file failed or fseek file failed, errno %{public}d", errno);
-        fclose(fd);
-        return E_FILE_ERROR;
-    }
-    size = static_cast<int32_t>(length);
-    fclose(fd);
-    return NO_ERROR;
-}
-
 int32_t WallpaperService::QueryActiveUserId()
 {
     std::vector<int32_t> ids;
@@ -1405,162 +2571,204 @@ ErrorCode WallpaperService::SetWallpaper(
     if (errCode != NO_ERROR) {
         return errCode;
     }
-    std::string uri = wallpaperTmpFullPath_;
-    char *paperBuf = new (std::nothrow) char[length]();
-    if (paperBuf == nullptr) {
-        return E_NO_MEMORY;
+    std::string uri = MakeStagingPath();
+    mode_t mode = S_IRUSR | S_IWUSR;
+    int32_t fdw = open(uri.c_str(), O_WRONLY | O_CREAT | O_TRUNC, mode);
+    if (fdw < 0) {
+        HILOG_ERROR("Open wallpaper tmpFullPath failed, errno %{public}d", errno);
+        return E_DEAL_FAILED;
     }
-    {
-        std::lock_guard<std::mutex> lock(mtx_);
-        if (read(fd, paperBuf, length) <= 0) {
-            HILOG_ERROR("read fd failed!");
-            delete[] paperBuf;
-            return E_DEAL_FAILED;
-        }
-        mode_t mode = S_IRUSR | S_IWUSR;
-        int32_t fdw = open(uri.c_str(), O_WRONLY | O_CREAT, mode);
-        if (fdw < 0) {
-            HILOG_ERROR("Open wallpaper tmpFullPath failed, errno %{public}d", errno);
-            delete[] paperBuf;
-            return E_DEAL_FAILED;
-        }
-        fdsan_exchange_owner_tag(fdw, 0, WP_DOMAIN);
-        if (write(fdw, paperBuf, length) <= 0) {
-            HILOG_ERROR("Write to fdw failed, errno %{public}d", errno);
-            ReporterFault(FaultType::SET_WALLPAPER_FAULT, FaultCode::RF_DROP_FAILED);
-            delete[] paperBuf;
-            fdsan_close_with_tag(fdw, WP_DOMAIN);
-            return E_DEAL_FAILED;
-        }
-        delete[] paperBuf;
+    fdsan_exchange_owner_tag(fdw, 0, WP_DOMAIN);
+    // Only pictures are compared by content, videos and packages keep the in-kernel copy.
+    ContentDigest digest;
+    bool transferred = resourceType == PICTURE ? FileDeal::TransferFd(fd, fdw, length, digest)
+                                               : FileDeal::TransferFd(fd, fdw, length);
+    if (!transferred) {
+        HILOG_ERROR("Transfer fd to fdw failed!");
+        ReporterFault(FaultType::SET_WALLPAPER_FAULT, FaultCode::RF_DROP_FAILED);
         fdsan_close_with_tag(fdw, WP_DOMAIN);
+        FileDeal::DeleteFile(uri);
+        return E_DEAL_FAILED;
     }
-    WallpaperType type = static_cast<WallpaperType>(wallpaperType);
-    ErrorCode wallpaperErrorCode = SetWallpaperBackupData(userId, resourceType, uri, type);
+    if (!FileDeal::SyncFd(fdw, DurabilityMode::DATA_SYNC)) {
+        fdsan_close_with_tag(fdw, WP_DOMAIN);
+        FileDeal::DeleteFile(uri);
+        return E_DEAL_FAILED;
+    }
+    fdsan_close_with_tag(fdw, WP_DOMAIN);
+    std::map<std::string, uint64_t> digests;
     if (resourceType == PICTURE) {
-        SaveColor(userId, type);
+        digests[GetVariantName(FoldState::NORMAL, RotateState::PORT)] = digest.Final();
     }
-    return wallpaperErrorCode;
+    WallpaperType type = static_cast<WallpaperType>(wallpaperType);
+    return SetWallpaperBackupData(userId, resourceType, uri, type, "", digests);
 }
 
-ErrorCode WallpaperService::SetWallpaperByPixelMap(
-    std::shared_ptr<OHOS::Media::PixelMap> pixelMap, int32_t wallpaperType, WallpaperResourceType resourceType)
+ErrorCode WallpaperService::SetWallpaperByPixelMap(std::shared_ptr<OHOS::Media::PixelMap> pixelMap,
+    int32_t wallpaperType, WallpaperResourceType resourceType, int32_t storageFormat)
 {
     if (pixelMap == nullptr) {
         HILOG_ERROR("pixelMap is nullptr");
         return E_FILE_ERROR;
     }
+    OHOS::Media::PackOption option;
+    if (!GetStoragePackOption(storageFormat, option)) {
+        HILOG_ERROR("Invalid storage format %{public}d", storageFormat);
+        return E_PARAMETERS_INVALID;
+    }
     int32_t userId = QueryActiveUserId();
     HILOG_INFO("QueryCurrentOsAccount userId: %{public}d", userId);
     if (!CheckUserPermissionById(userId)) {
         return E_USER_IDENTITY_ERROR;
     }
-    std::string uri = wallpaperTmpFullPath_;
-    ErrorCode errCode = WritePixelMapToFile(pixelMap, uri, wallpaperType, resourceType);
+    std::string uri = MakeStagingPath();
+    uint64_t digest = 0;
+    ErrorCode errCode = WritePixelMapToFile(pixelMap, uri, wallpaperType, resourceType, option, digest);
     if (errCode != NO_ERROR) {
         HILOG_ERROR("WritePixelMapToFile failed!");
         return errCode;
     }
-    WallpaperType type = static_cast<WallpaperType>(wallpaperType);
-    ErrorCode wallpaperErrorCode = SetWallpaperBackupData(userId, resourceType, uri, type);
+    std::map<std::string, uint64_t> digests;
     if (resourceType == PICTURE) {
-        SaveColor(userId, type);
+        digests[GetVariantName(FoldState::NORMAL, RotateState::PORT)] = digest;
     }
-    return wallpaperErrorCode;
+    WallpaperType type = static_cast<WallpaperType>(wallpaperType);
+    return SetWallpaperBackupData(userId, resourceType, uri, type, option.format, digests);
 }
 
 ErrorCode WallpaperService::WritePixelMapToFile(std::shared_ptr<OHOS::Media::PixelMap> pixelMap,
-    std::string wallpaperTmpFullPath, int32_t wallpaperType, WallpaperResourceType resourceType)
+    std::string wallpaperTmpFullPath, int32_t wallpaperType, WallpaperResourceType resourceType,
+    const OHOS::Media::PackOption &option, uint64_t &digest)
 {
     if (pixelMap == nullptr) {
         HILOG_ERROR("pixelMap is nullptr");
         return E_FILE_ERROR;
     }
-    std::stringbuf stringBuf;
-    std::ostream ostream(&stringBuf);
-    int32_t mapSize = WritePixelMapToStream(pixelMap, ostream);
-    if (mapSize <= 0) {
+    int32_t maxLength = resourceType == VIDEO ? MAX_VIDEO_SIZE : FOO_MAX_LEN;
+    mode_t mode = S_IRUSR | S_IWUSR;
+    int32_t fdw = open(wallpaperTmpFullPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, mode);
+    if (fdw < 0) {
+        HILOG_ERROR("Open wallpaper tmpFullPath failed, errno %{public}d", errno);
+        return E_DEAL_FAILED;
+    }
+    fdsan_exchange_owner_tag(fdw, 0, WP_DOMAIN);
+    // The packer output goes through the bounded stream buffer, the encoded image is never held in memory.
+    StreamWriter writer(fdw);
+    writer.SetMaxSize(maxLength);
+    ContentDigest contentDigest;
+    writer.SetDigest(&contentDigest);
+    StreamWriterBuf streamBuf(writer);
+    std::ostream ostream(&streamBuf);
+    int64_t mapSize = WritePixelMapToStream(pixelMap, ostream, option);
+    bool flushed = writer.Flush() && FileDeal::SyncFd(fdw, DurabilityMode::DATA_SYNC);
+    fdsan_close_with_tag(fdw, WP_DOMAIN);
+    ErrorCode errCode = NO_ERROR;
+    if (writer.GetStatus() == StreamStatus::OVERSIZED) {
+        errCode = E_PICTURE_OVERSIZED;
+    } else if (!flushed) {
+        ReporterFault(FaultType::SET_WALLPAPER_FAULT, FaultCode::RF_DROP_FAILED);
+        errCode = writer.GetStatus() == StreamStatus::NO_MEMORY ? E_NO_MEMORY : E_DEAL_FAILED;
+    } else if (mapSize <= 0) {
         HILOG_ERROR("WritePixelMapToStream failed!");
-        return E_WRITE_PARCEL_ERROR;
+        errCode = E_WRITE_PARCEL_ERROR;
+    } else {
+        errCode = CheckValid(wallpaperType, static_cast<int32_t>(writer.GetTotalSize()), resourceType);
     }
-    ErrorCode errCode = CheckValid(wallpaperType, mapSize, resourceType);
     if (errCode != NO_ERROR) {
-        HILOG_ERROR("CheckValid failed!");
+        HILOG_ERROR("Write pixelMap to file failed, errCode=%{public}d", errCode);
+        FileDeal::DeleteFile(wallpaperTmpFullPath);
         return errCode;
     }
-    char *buffer = new (std::nothrow) char[mapSize]();
-    if (buffer == nullptr) {
-        HILOG_ERROR("buffer failed!");
-        return E_NO_MEMORY;
-    }
-    stringBuf.sgetn(buffer, mapSize);
-    {
-        std::lock_guard<std::mutex> lock(mtx_);
-        mode_t mode = S_IRUSR | S_IWUSR;
-        int32_t fdw = open(wallpaperTmpFullPath.c_str(), O_WRONLY | O_CREAT, mode);
-        if (fdw < 0) {
-            HILOG_ERROR("Open wallpaper tmpFullPath failed, errno %{public}d", errno);
-            delete[] buffer;
-            return E_DEAL_FAILED;
-        }
-        fdsan_exchange_owner_tag(fdw, 0, WP_DOMAIN);
-        if (write(fdw, buffer, mapSize) <= 0) {
-            HILOG_ERROR("Write to fdw failed, errno %{public}d", errno);
-            ReporterFault(FaultType::SET_WALLPAPER_FAULT, FaultCode::RF_DROP_FAILED);
-            delete[] buffer;
-            fdsan_close_with_tag(fdw, WP_DOMAIN);
-            return E_DEAL_FAILED;
-        }
-        delete[] buffer;
-        fdsan_close_with_tag(fdw, WP_DOMAIN);
-    }
+    digest = contentDigest.Final();
     return NO_ERROR;
 }
 
-int64_t WallpaperService::WritePixelMapToStream(
-    std::shared_ptr<OHOS::Media::PixelMap> pixelMap, std::ostream &outputStream)
+int64_t WallpaperService::WritePixelMapToStream(std::shared_ptr<OHOS::Media::PixelMap> pixelMap,
+    std::ostream &outputStream, const OHOS::Media::PackOption &option)
 {
     if (pixelMap == nullptr) {
         HILOG_ERROR("pixelMap is nullptr");
         return 0;
     }
     OHOS::Media::ImagePacker imagePacker;
-    OHOS::Media::PackOption option;
-    option.format = "image/jpeg";
-    option.quality = OPTION_QUALITY;
-    option.numberHint = 1;
-    std::set<std::string> formats;
-    uint32_t ret = imagePacker.GetSupportedFormats(formats);
-    if (ret != 0) {
-        HILOG_ERROR("image packer get supported format failed, ret=%{public}u.", ret);
+    // The packer writes each encoded chunk to outputStream as it goes, nothing is packed into memory first.
+    uint32_t ret = imagePacker.StartPacking(outputStream, option);
+    if (ret == 0) {
+        ret = imagePacker.AddImage(*pixelMap);
     }
-
-    imagePacker.StartPacking(outputStream, option);
-    imagePacker.AddImage(*pixelMap);
     int64_t packedSize = 0;
-    imagePacker.FinalizePacking(packedSize);
+    if (ret == 0) {
+        ret = imagePacker.FinalizePacking(packedSize);
+    }
+    if (ret != 0) {
+        HILOG_ERROR("image packer pack failed, ret=%{public}u.", ret);
+        return 0;
+    }
     HILOG_INFO("FrameWork WritePixelMapToStream End! packedSize=%{public}lld.", static_cast<long long>(packedSize));
     return packedSize;
 }
 
-void WallpaperService::OnColorsChange(WallpaperType wallpaperType, const ColorManager::Color &color)
+bool WallpaperService::IsPackFormatSupported(const std::string &format)
+{
+    // The encoders do not change while the service runs, so the packer is only asked once.
+    static const std::set<std::string> supportedFormats = []() {
+        std::set<std::string> formats;
+        OHOS::Media::ImagePacker imagePacker;
+        if (imagePacker.GetSupportedFormats(formats) != 0) {
+            HILOG_WARN("GetSupportedFormats failed, only jpeg is packed.");
+            formats.clear();
+        }
+        return formats;
+    }();
+    return supportedFormats.find(format) != supportedFormats.end();
+}
+
+bool WallpaperService::GetStoragePackOption(int32_t storageFormat, OHOS::Media::PackOption &option)
 {
-    std::vector<uint64_t> colors;
-    if (wallpaperType == WALLPAPER_SYSTEM && !CompareColor(systemWallpaperColor_, color)) {
-        {
-            std::lock_guard<std::mutex> lock(wallpaperColorMtx_);
-            systemWallpaperColor_ = color.PackValue();
-            colors.emplace_back(systemWallpaperColor_);
+    if (storageFormat < STORAGE_DEFAULT || storageFormat > STORAGE_HEIF) {
+        return false;
+    }
+    if (storageFormat == STORAGE_DEFAULT) {
+        storageFormat = GetIntParameter(STORAGE_FORMAT_PARAM, STORAGE_JPEG_BEST);
+    }
+    option.format = MIME_TYPE_JPEG;
+    option.quality = OPTION_QUALITY;
+    option.numberHint = 1;
+    switch (storageFormat) {
+        case STORAGE_JPEG_HIGH:
+            option.quality = JPEG_HIGH_QUALITY;
+            break;
+        case STORAGE_JPEG_MEDIUM:
+            option.quality = JPEG_MEDIUM_QUALITY;
+            break;
+        case STORAGE_WEBP:
+        case STORAGE_HEIF: {
+            std::string format = storageFormat == STORAGE_WEBP ? MIME_TYPE_WEBP : MIME_TYPE_HEIF;
+            if (!IsPackFormatSupported(format)) {
+                HILOG_WARN("%{public}s encoder is not supported, store as jpeg.", format.c_str());
+                break;
+            }
+            option.format = format;
+            option.quality = COMPACT_FORMAT_QUALITY;
+            break;
         }
-        NotifyColorChange(colors, WALLPAPER_SYSTEM);
-    } else if (wallpaperType == WALLPAPER_LOCKSCREEN && !CompareColor(lockWallpaperColor_, color)) {
-        {
-            std::lock_guard<std::mutex> lock(wallpaperColorMtx_);
-            lockWallpaperColor_ = color.PackValue();
-            colors.emplace_back(lockWallpaperColor_);
+        default:
+            break;
+    }
+    return true;
+}
+
+void WallpaperService::OnColorsChange(WallpaperType wallpaperType, uint64_t color)
+{
+    {
+        std::lock_guard<std::mutex> lock(wallpaperColorMtx_);
+        uint64_t &notifiedColor = wallpaperType == WALLPAPER_SYSTEM ? systemWallpaperColor_ : lockWallpaperColor_;
+        if (notifiedColor == color) {
+            return;
         }
-        NotifyColorChange(colors, WALLPAPER_LOCKSCREEN);
+        notifiedColor = color;
     }
+    NotifyColorChange({ color }, wallpaperType);
 }
 
 ErrorCode WallpaperService::CheckValid(int32_t wallpaperType, int32_t length, WallpaperResourceType resourceType)
@@ -1659,20 +2867,20 @@ bool WallpaperService::SaveWallpaperState(
 bool WallpaperService::WriteWallpapercfgFile(char *wallpaperJson, int32_t userId)
 {
     std::string userPath = WALLPAPER_USERID_PATH + std::to_string(userId) + "/wallpapercfg";
-    mode_t mode = S_IRUSR | S_IWUSR;
-    int fd = open(userPath.c_str(), O_CREAT | O_WRONLY | O_SYNC, mode);
-    if (fd <= 0) {
-        HILOG_ERROR("open user config file failed! %{public}d", errno);
+    // wallpapercfg holds both wallpaper types of the user, so it is not covered by the per type locks.
+    std::lock_guard<std::mutex> lock(mtx_);
+    // Written aside and renamed over, so a crash leaves either the old or the new config, synced once.
+    std::string stagingPath = MakeStagingPath();
+    if (!FileDeal::WriteFile(stagingPath, wallpaperJson, DurabilityMode::DATA_SYNC)) {
+        HILOG_ERROR("write user config file failed!");
+        FileDeal::DeleteFile(stagingPath);
         return false;
     }
-    fdsan_exchange_owner_tag(fd, 0, WP_DOMAIN);
-    ssize_t size = write(fd, wallpaperJson, strlen(wallpaperJson));
-    if (size <= 0) {
-        HILOG_ERROR("write user config file failed!");
-        fdsan_close_with_tag(fd, WP_DOMAIN);
+    if (!FileDeal::CommitFile(stagingPath, userPath)) {
+        HILOG_ERROR("commit user config file failed!");
+        FileDeal::DeleteFile(stagingPath);
         return false;
     }
-    fdsan_close_with_tag(fd, WP_DOMAIN);
     return true;
 }
 
@@ -1843,28 +3051,41 @@ ErrorCode WallpaperService::SetAllWallpapers(
     }
     ErrorCode errCode;
     for (auto &wallpaperInfo : allWallpaperInfos) {
-        wallpaperInfo.tempPath = std::string(WALLPAPER_USERID_PATH) + GetFoldStateName(wallpaperInfo.foldState) + "_"
-                                 + GetRotateStateName(wallpaperInfo.rotateState);
+        wallpaperInfo.tempPath =
+            MakeStagingPath() + "_" + GetVariantName(wallpaperInfo.foldState, wallpaperInfo.rotateState);
         errCode = CheckValid(wallpaperType, wallpaperInfo.length, resourceType);
         if (errCode != NO_ERROR) {
+            DeleteTempResource(allWallpaperInfos);
             return errCode;
         }
-        errCode = WriteFdToFile(wallpaperInfo, wallpaperInfo.tempPath);
-        if (errCode != NO_ERROR) {
+    }
+    std::map<std::string, uint64_t> digests;
+    errCode = IngestWallpaperInfos(allWallpaperInfos, digests);
+    if (errCode != NO_ERROR) {
+        DeleteTempResource(allWallpaperInfos);
+        HILOG_ERROR("IngestWallpaperInfos failed!");
+        return errCode;
+    }
+    WallpaperType type = static_cast<WallpaperType>(wallpaperType);
+    IssueSetTicket(userId, type);
+    {
+        auto wallpaperLock = GetWallpaperLock(userId, type);
+        std::lock_guard<std::mutex> lock(*wallpaperLock);
+        if (IsWallpaperUnchanged(userId, type, PICTURE, digests)) {
+            HILOG_INFO("All wallpapers content unchanged, skip set.");
             DeleteTempResource(allWallpaperInfos);
-            HILOG_ERROR("WriteFdToFile failed!");
-            return errCode;
+            FinishAsyncTrace(
+                HITRACE_TAG_MISC, "SetAllWallpapers", static_cast<int32_t>(TraceTaskId::SET_ALL_WALLPAPERS));
+            return NO_ERROR;
         }
+        errCode = UpdateWallpaperData(allWallpaperInfos, userId, type, digests);
     }
-    WallpaperType type = static_cast<WallpaperType>(wallpaperType);
-    std::string wallpaperPath = GetWallpaperDir(userId, type);
-    FileDeal::DeleteDir(wallpaperPath, false);
-    errCode = UpdateWallpaperData(allWallpaperInfos, userId, type);
     if (errCode != NO_ERROR) {
         HILOG_ERROR("UpdateWallpaperData failed!");
         return errCode;
     }
-    SaveColor(userId, type);
+    PostSaveColorTask(userId, type);
+    PostRenditionTask(userId, type);
     if (!SendWallpaperChangeEvent(userId, type)) {
         HILOG_ERROR("Send wallpaper state failed!");
         return E_DEAL_FAILED;
@@ -1873,8 +3094,8 @@ ErrorCode WallpaperService::SetAllWallpapers(
     return errCode;
 }
 
-ErrorCode WallpaperService::UpdateWallpaperData(
-    std::vector<WallpaperPictureInfo> allWallpaperInfos, int32_t userId, WallpaperType wallpaperType)
+ErrorCode WallpaperService::UpdateWallpaperData(std::vector<WallpaperPictureInfo> allWallpaperInfos, int32_t userId,
+    WallpaperType wallpaperType, const std::map<std::string, uint64_t> &digests)
 {
     ErrorCode errCode;
     WallpaperData wallpaperData;
@@ -1884,57 +3105,156 @@ ErrorCode WallpaperService::UpdateWallpaperData(
         return E_DEAL_FAILED;
     }
     ClearnWallpaperDataFile(wallpaperData);
-    errCode = SetAllWallpaperBackupData(allWallpaperInfos, userId, wallpaperType, wallpaperData);
+    wallpaperData.wallpaperId = MakeWallpaperIdLocked();
+    // Variants arrive as already encoded files of unknown format, decoders sniff them and the manifest records no hint.
+    wallpaperData.formatHint = "";
+    // The new set is built next to the live dir and swapped in as a whole, readers keep seeing the old set until then.
+    std::string wallpaperDir = GetWallpaperDir(userId, wallpaperType);
+    std::string stagingDir = wallpaperDir + WALLPAPER_STAGING_DIR_SUFFIX;
+    FileDeal::DeleteDir(stagingDir, true);
+    if (!FileDeal::Mkdir(stagingDir)) {
+        DeleteTempResource(allWallpaperInfos);
+        return E_DEAL_FAILED;
+    }
+    errCode = SetAllWallpaperBackupData(allWallpaperInfos, stagingDir, userId, wallpaperType, wallpaperData);
+    // Variants are written with DurabilityMode::BATCHED_SYNC, a single syncfs persists them before the manifest.
+    if (errCode == NO_ERROR && !FileDeal::SyncFileSystem(stagingDir)) {
+        errCode = E_DEAL_FAILED;
+    }
+    if (errCode == NO_ERROR && !WriteWallpaperManifest(stagingDir, wallpaperData)) {
+        errCode = E_DEAL_FAILED;
+    }
+    wallpaperData.resourceType = PICTURE;
+    SetWallpaperDigests(wallpaperData, digests);
+    if (errCode == NO_ERROR) {
+        // Readers resolve and open under the shared publish lock, so they see either the old dir and map entry or
+        // the new ones, never the map still pointing at the set that was just swapped out.
+        auto publishLock = GetPublishLock(userId, wallpaperType);
+        std::lock_guard<std::shared_mutex> publish(*publishLock);
+        if (!FileDeal::ExchangeDir(stagingDir, wallpaperDir)) {
+            errCode = E_DEAL_FAILED;
+        } else if (wallpaperType == WALLPAPER_SYSTEM) {
+            systemWallpaperMap_.InsertOrAssign(userId, wallpaperData);
+        } else if (wallpaperType == WALLPAPER_LOCKSCREEN) {
+            lockWallpaperMap_.InsertOrAssign(userId, wallpaperData);
+        }
+    }
     if (errCode != NO_ERROR) {
         DeleteTempResource(allWallpaperInfos);
+        FileDeal::DeleteDir(stagingDir, true);
         HILOG_ERROR("SetAllWallpaperBackupData failed!");
         return errCode;
     }
-    wallpaperData.resourceType = PICTURE;
-    wallpaperData.wallpaperId = MakeWallpaperIdLocked();
-    if (wallpaperType == WALLPAPER_SYSTEM) {
-        systemWallpaperMap_.InsertOrAssign(userId, wallpaperData);
-    } else if (wallpaperType == WALLPAPER_LOCKSCREEN) {
-        lockWallpaperMap_.InsertOrAssign(userId, wallpaperData);
+    wallpaperFdCache_.Invalidate(userId, wallpaperType);
+    if (FileDeal::IsDirExist(stagingDir) && !FileDeal::DeleteDir(stagingDir, true)) {
+        HILOG_WARN("Clear previous wallpaper files failed!");
     }
     return NO_ERROR;
 }
 
-ErrorCode WallpaperService::WriteFdToFile(WallpaperPictureInfo &wallpaperPictureInfo, std::string &path)
+ErrorCode WallpaperService::WriteFdToFile(
+    WallpaperPictureInfo &wallpaperPictureInfo, std::string &path, DurabilityMode mode, uint64_t &digest)
 {
-    std::lock_guard<std::mutex> lock(mtx_);
-    char *wallpaperBuffer = new (std::nothrow) char[wallpaperPictureInfo.length]();
-    if (wallpaperBuffer == nullptr) {
-        HILOG_ERROR("create wallpaperBuffer failed!");
-        return E_NO_MEMORY;
-    }
-    if (read(wallpaperPictureInfo.fd, wallpaperBuffer, wallpaperPictureInfo.length) <= 0) {
-        HILOG_ERROR("read fd failed!");
-        delete[] wallpaperBuffer;
-        return E_DEAL_FAILED;
-    }
-    mode_t mode = S_IRUSR | S_IWUSR;
-    int32_t fdw = open(path.c_str(), O_WRONLY | O_CREAT, mode);
+    mode_t fileMode = S_IRUSR | S_IWUSR;
+    int32_t fdw = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, fileMode);
     if (fdw < 0) {
         HILOG_ERROR("Open wallpaper tmpFullPath failed, errno %{public}d", errno);
-        delete[] wallpaperBuffer;
         return E_DEAL_FAILED;
     }
     fdsan_exchange_owner_tag(fdw, 0, WP_DOMAIN);
-    if (write(fdw, wallpaperBuffer, wallpaperPictureInfo.length) <= 0) {
-        HILOG_ERROR("Write to fdw failed, errno %{public}d", errno);
+    ContentDigest contentDigest;
+    if (!FileDeal::TransferFd(wallpaperPictureInfo.fd, fdw, wallpaperPictureInfo.length, contentDigest)) {
+        HILOG_ERROR("Transfer fd to fdw failed!");
         ReporterFault(FaultType::SET_WALLPAPER_FAULT, FaultCode::RF_DROP_FAILED);
-        delete[] wallpaperBuffer;
         fdsan_close_with_tag(fdw, WP_DOMAIN);
+        FileDeal::DeleteFile(path);
+        return E_DEAL_FAILED;
+    }
+    if (!FileDeal::SyncFd(fdw, mode)) {
+        fdsan_close_with_tag(fdw, WP_DOMAIN);
+        FileDeal::DeleteFile(path);
         return E_DEAL_FAILED;
     }
-    delete[] wallpaperBuffer;
     fdsan_close_with_tag(fdw, WP_DOMAIN);
+    digest = contentDigest.Final();
+    return NO_ERROR;
+}
+
+int32_t WallpaperService::GetIntParameter(const char *key, int32_t defaultValue)
+{
+    char value[PARAM_VALUE_LEN] = { 0 };
+    if (GetParameter(key, "", value, PARAM_VALUE_LEN) > 0) {
+        return atoi(value);
+    }
+    return defaultValue;
+}
+
+int32_t WallpaperService::GetIngestParallelism()
+{
+    int32_t parallelism = GetIntParameter(INGEST_PARALLELISM_PARAM, DEFAULT_INGEST_PARALLELISM);
+    return std::clamp(parallelism, 1, MAX_INGEST_PARALLELISM);
+}
+
+void WallpaperService::StartIngestPool()
+{
+    // Sized once, the parameter is read only. The calling thread is always one of the workers.
+    int32_t threadCount = GetIngestParallelism() - 1;
+    if (threadCount <= 0) {
+        return;
+    }
+    if (ingestPool_.Start(threadCount) != ERR_OK) {
+        HILOG_WARN("Start ingest pool failed, variants are ingested by the calling thread.");
+    }
+}
+
+ErrorCode WallpaperService::IngestWallpaperInfos(
+    std::vector<WallpaperPictureInfo> &allWallpaperInfos, std::map<std::string, uint64_t> &digests)
+{
+    size_t count = allWallpaperInfos.size();
+    std::vector<ErrorCode> results(count, NO_ERROR);
+    std::vector<uint64_t> variantDigests(count, 0);
+    std::atomic<size_t> nextIndex{ 0 };
+    auto ingest = [&]() {
+        for (size_t index = nextIndex++; index < count; index = nextIndex++) {
+            auto &wallpaperInfo = allWallpaperInfos[index];
+            results[index] = WriteFdToFile(
+                wallpaperInfo, wallpaperInfo.tempPath, DurabilityMode::BATCHED_SYNC, variantDigests[index]);
+        }
+    };
+    size_t workerCount = std::min(count, static_cast<size_t>(GetIngestParallelism()));
+    size_t helperCount = workerCount > 1 ? workerCount - 1 : 0;
+    size_t pendingHelpers = helperCount;
+    std::mutex helperMutex;
+    std::condition_variable helperDone;
+    if (helperCount > 0) {
+        std::call_once(ingestPoolOnce_, [this]() { StartIngestPool(); });
+    }
+    for (size_t i = 0; i < helperCount; i++) {
+        // A helper that starts after the variants are taken finds nothing left and only signals.
+        ingestPool_.AddTask([&]() {
+            ingest();
+            std::lock_guard<std::mutex> lock(helperMutex);
+            pendingHelpers--;
+            helperDone.notify_one();
+        });
+    }
+    ingest();
+    {
+        std::unique_lock<std::mutex> lock(helperMutex);
+        helperDone.wait(lock, [&pendingHelpers]() { return pendingHelpers == 0; });
+    }
+    for (size_t index = 0; index < count; index++) {
+        if (results[index] != NO_ERROR) {
+            return results[index];
+        }
+        const auto &wallpaperInfo = allWallpaperInfos[index];
+        digests[GetVariantName(wallpaperInfo.foldState, wallpaperInfo.rotateState)] = variantDigests[index];
+    }
     return NO_ERROR;
 }
 
 ErrorCode WallpaperService::SetAllWallpaperBackupData(std::vector<WallpaperPictureInfo> allWallpaperInfos,
-    int32_t userId, WallpaperType wallpaperType, WallpaperData &wallpaperData)
+    const std::string &stagingDir, int32_t userId, WallpaperType wallpaperType, WallpaperData &wallpaperData)
 {
     HILOG_INFO("set All wallpaper and backup data Start.");
     for (auto &wallpaperInfo : allWallpaperInfos) {
@@ -1942,17 +3262,13 @@ ErrorCode WallpaperService::SetAllWallpaperBackupData(std::vector<WallpaperPictu
             return E_DEAL_FAILED;
         }
         UpdateWallpaperDataFile(wallpaperInfo, userId, wallpaperType, wallpaperData);
-        std::string wallpaperFile = GetWallpaperDataFile(wallpaperInfo, userId, wallpaperType);
-        {
-            std::lock_guard<std::mutex> lock(mtx_);
-            if (!FileDeal::CopyFile(wallpaperInfo.tempPath, wallpaperFile)) {
-                HILOG_ERROR("CopyFile failed!");
-                FileDeal::DeleteFile(wallpaperInfo.tempPath);
-                return E_DEAL_FAILED;
-            }
-            if (!FileDeal::DeleteFile(wallpaperInfo.tempPath)) {
-                return E_DEAL_FAILED;
-            }
+        std::string wallpaperFile =
+            GetWallpaperDataFile(wallpaperInfo, userId, wallpaperType, wallpaperData.wallpaperId);
+        std::string stagingFile = stagingDir + wallpaperFile.substr(wallpaperFile.find_last_of('/'));
+        if (!FileDeal::CommitFile(wallpaperInfo.tempPath, stagingFile, false)) {
+            HILOG_ERROR("CommitFile failed!");
+            FileDeal::DeleteFile(wallpaperInfo.tempPath);
+            return E_DEAL_FAILED;
         }
     }
     return NO_ERROR;
@@ -1961,29 +3277,30 @@ ErrorCode WallpaperService::SetAllWallpaperBackupData(std::vector<WallpaperPictu
 void WallpaperService::UpdateWallpaperDataFile(WallpaperPictureInfo &wallpaperPictureInfo, int32_t userId,
     WallpaperType wallpaperType, WallpaperData &wallpaperData)
 {
+    std::string wallpaperFile =
+        GetWallpaperDataFile(wallpaperPictureInfo, userId, wallpaperType, wallpaperData.wallpaperId);
     switch (static_cast<FoldState>(wallpaperPictureInfo.foldState)) {
         case FoldState::NORMAL:
             if (static_cast<RotateState>(wallpaperPictureInfo.rotateState) == RotateState::PORT) {
-                wallpaperData.wallpaperFile = GetWallpaperDir(userId, wallpaperType) + "/"
-                                              + (wallpaperType == WALLPAPER_SYSTEM ? WALLPAPER_HOME : WALLPAPER_LOCK);
+                wallpaperData.wallpaperFile = wallpaperFile;
             } else if (static_cast<RotateState>(wallpaperPictureInfo.rotateState) == RotateState::LAND) {
-                wallpaperData.normalLandFile = GetWallpaperDataFile(wallpaperPictureInfo, userId, wallpaperType);
+                wallpaperData.normalLandFile = wallpaperFile;
             }
             break;
 
         case FoldState::UNFOLD_1:
             if (static_cast<RotateState>(wallpaperPictureInfo.rotateState) == RotateState::PORT) {
-                wallpaperData.unfoldedOnePortFile = GetWallpaperDataFile(wallpaperPictureInfo, userId, wallpaperType);
+                wallpaperData.unfoldedOnePortFile = wallpaperFile;
             } else if (static_cast<RotateState>(wallpaperPictureInfo.rotateState) == RotateState::LAND) {
-                wallpaperData.unfoldedOneLandFile = GetWallpaperDataFile(wallpaperPictureInfo, userId, wallpaperType);
+                wallpaperData.unfoldedOneLandFile = wallpaperFile;
             }
             break;
 
         case FoldState::UNFOLD_2:
             if (static_cast<RotateState>(wallpaperPictureInfo.rotateState) == RotateState::PORT) {
-                wallpaperData.unfoldedTwoPortFile = GetWallpaperDataFile(wallpaperPictureInfo, userId, wallpaperType);
+                wallpaperData.unfoldedTwoPortFile = wallpaperFile;
             } else if (static_cast<RotateState>(wallpaperPictureInfo.rotateState) == RotateState::LAND) {
-                wallpaperData.unfoldedTwoLandFile = GetWallpaperDataFile(wallpaperPictureInfo, userId, wallpaperType);
+                wallpaperData.unfoldedTwoLandFile = wallpaperFile;
             }
             break;
         default:
@@ -1992,17 +3309,17 @@ void WallpaperService::UpdateWallpaperDataFile(WallpaperPictureInfo &wallpaperPi
 }
 
 std::string WallpaperService::GetWallpaperDataFile(
-    WallpaperPictureInfo &wallpaperPictureInfo, int32_t userId, WallpaperType wallpaperType)
+    WallpaperPictureInfo &wallpaperPictureInfo, int32_t userId, WallpaperType wallpaperType, int32_t wallpaperId)
 {
     std::string wallpaperTypeName = wallpaperType == WALLPAPER_SYSTEM ? WALLPAPER_HOME : WALLPAPER_LOCK;
     std::string foldStateName = GetFoldStateName(wallpaperPictureInfo.foldState);
     std::string rotateStateName = GetRotateStateName(wallpaperPictureInfo.rotateState);
     if (foldStateName == "normal" && rotateStateName == "port") {
-        return GetWallpaperDir(userId, wallpaperType) + "/" + wallpaperTypeName;
+        return GetVersionedFile(GetWallpaperDir(userId, wallpaperType) + "/" + wallpaperTypeName, wallpaperId);
     }
     std::string wallpaperFile =
         GetWallpaperDir(userId, wallpaperType) + "/" + foldStateName + "_" + rotateStateName + "_" + wallpaperTypeName;
-    return wallpaperFile;
+    return GetVersionedFile(wallpaperFile, wallpaperId);
 }
 
 void WallpaperService::ClearnWallpaperDataFile(WallpaperData &wallpaperData)
@@ -2012,10 +3329,25 @@ void WallpaperService::ClearnWallpaperDataFile(WallpaperData &wallpaperData)
     wallpaperData.unfoldedOneLandFile = "";
     wallpaperData.unfoldedTwoPortFile = "";
     wallpaperData.unfoldedTwoLandFile = "";
+    wallpaperData.thumbnailFiles.clear();
+    wallpaperData.textureFiles.clear();
+    wallpaperData.mainColor = 0;
+    wallpaperData.palette = WallpaperPalette();
 }
 
 ErrCode WallpaperService::GetCorrespondWallpaper(
-    int32_t wallpaperType, int32_t foldState, int32_t rotateState, int32_t &size, int &fd)
+    int32_t wallpaperType, int32_t foldState, int32_t rotateState, int32_t &size, bool &hasFd, int &fd)
+{
+    WallpaperHandle handle;
+    ErrorCode ret = GetCorrespondWallpaperHandle(wallpaperType, foldState, rotateState, handle);
+    size = handle.GetSize();
+    hasFd = handle.GetFd() >= 0;
+    fd = handle.Release();
+    return ret;
+}
+
+ErrorCode WallpaperService::GetCorrespondWallpaperHandle(
+    int32_t wallpaperType, int32_t foldState, int32_t rotateState, WallpaperHandle &handle)
 {
     StartAsyncTrace(
         HITRACE_TAG_MISC, "GetCorrespondWallpaper", static_cast<int32_t>(TraceTaskId::GET_CORRESPOND_WALLPAPER));
@@ -2035,83 +3367,249 @@ ErrCode WallpaperService::GetCorrespondWallpaper(
     auto type = static_cast<WallpaperType>(wallpaperType);
     int32_t userId = QueryActiveUserId();
     HILOG_INFO("QueryCurrentOsAccount userId: %{public}d", userId);
-    // current user's wallpaper is live video, not image
+    // current user's wallpaper is live video, not image, the handle stays empty
     WallpaperResourceType resType = GetResType(userId, type);
     if (resType != PICTURE && resType != DEFAULT) {
         HILOG_ERROR("Current user's wallpaper is live video, not image.");
-        size = 0; // 0: empty file size
-        fd = -1;  // -1: invalid file description
         return NO_ERROR;
     }
-    ErrorCode ret = GetImageSize(userId, type, size, foldState, rotateState);
+    ErrorCode ret = OpenCachedWallpaperHandle(
+        WallpaperFdKey(userId, type, foldState, rotateState),
+        [this, foldState, rotateState](const WallpaperData &wallpaperData, std::string &filePath) {
+            filePath = GetWallpaperPath(foldState, rotateState, wallpaperData);
+            return !filePath.empty();
+        },
+        handle);
     if (ret != NO_ERROR) {
-        HILOG_ERROR("GetImageSize failed!");
+        HILOG_ERROR("OpenWallpaperHandle failed!");
         return ret;
     }
-    ret = GetImageFd(userId, type, fd, foldState, rotateState);
+    return NO_ERROR;
+}
+
+ErrCode WallpaperService::GetAllCorrespondWallpapers(
+    int32_t wallpaperType, std::vector<int32_t> &variantInfos, std::vector<int> &fds)
+{
+    std::vector<std::unique_ptr<WallpaperHandle>> handles;
+    ErrorCode ret = GetAllCorrespondWallpaperHandles(wallpaperType, variantInfos, handles);
+    for (auto &handle : handles) {
+        fds.push_back(handle->Release());
+    }
+    return ret;
+}
+
+ErrorCode WallpaperService::GetAllCorrespondWallpaperHandles(int32_t wallpaperType,
+    std::vector<int32_t> &variantInfos, std::vector<std::unique_ptr<WallpaperHandle>> &handles)
+{
+    if (!IsSystemApp()) {
+        HILOG_ERROR("CallingApp is not SystemApp.");
+        return E_NOT_SYSTEM_APP;
+    }
+    if (!CheckCallingPermission(WALLPAPER_PERMISSION_NAME_GET_WALLPAPER)) {
+        HILOG_ERROR("GetAllCorrespondWallpapers no get permission!");
+        return E_NO_PERMISSION;
+    }
+    if (wallpaperType != static_cast<int32_t>(WALLPAPER_LOCKSCREEN)
+        && wallpaperType != static_cast<int32_t>(WALLPAPER_SYSTEM)) {
+        return E_PARAMETERS_INVALID;
+    }
+    auto type = static_cast<WallpaperType>(wallpaperType);
+    int32_t userId = QueryActiveUserId();
+    // current user's wallpaper is live video, not image, no variant is returned
+    WallpaperResourceType resType = GetResType(userId, type);
+    if (resType != PICTURE && resType != DEFAULT) {
+        HILOG_ERROR("Current user's wallpaper is live video, not image.");
+        return NO_ERROR;
+    }
+    // Initing a missing user takes the slot locks, so it happens before the publish lock is held.
+    WallpaperData wallpaperData;
+    if (!FindWallpaperData(userId, type, wallpaperData)) {
+        return E_DEAL_FAILED;
+    }
+    ErrorCode ret = E_DEAL_FAILED;
+    {
+        // All variants are resolved and opened under one shared publish lock, so a set landing meanwhile neither
+        // mixes two versions nor removes a file before it is opened.
+        auto publishLock = GetPublishLock(userId, type);
+        std::shared_lock<std::shared_mutex> lock(*publishLock);
+        auto iterator = type == WALLPAPER_SYSTEM ? systemWallpaperMap_.Find(userId) : lockWallpaperMap_.Find(userId);
+        if (iterator.first) {
+            ret = OpenWallpaperVariants(iterator.second, variantInfos, handles);
+        }
+    }
     if (ret != NO_ERROR) {
-        HILOG_ERROR("GetImageFd failed!");
-        return ret;
+        ReporterFault(FaultType::LOAD_WALLPAPER_FAULT, FaultCode::RF_FD_INPUT_FAILED);
+        variantInfos.clear();
+        handles.clear();
+    }
+    return ret;
+}
+
+ErrorCode WallpaperService::OpenWallpaperVariants(const WallpaperData &wallpaperData,
+    std::vector<int32_t> &variantInfos, std::vector<std::unique_ptr<WallpaperHandle>> &handles)
+{
+    std::map<std::string, int32_t> fileIndexes;
+    for (FoldState foldState : { FoldState::NORMAL, FoldState::UNFOLD_1, FoldState::UNFOLD_2 }) {
+        for (RotateState rotateState : { RotateState::PORT, RotateState::LAND }) {
+            std::string filePath =
+                GetWallpaperPath(static_cast<int32_t>(foldState), static_cast<int32_t>(rotateState), wallpaperData);
+            if (filePath.empty()) {
+                continue;
+            }
+            // Variants falling back to the same file share one fd, the client decodes it once for all of them.
+            auto fileIndex = fileIndexes.find(filePath);
+            if (fileIndex == fileIndexes.end()) {
+                int32_t fd = open(filePath.c_str(), O_RDONLY, S_IREAD);
+                if (fd < 0) {
+                    int32_t openErrno = errno;
+                    HILOG_ERROR("Open file failed, errno %{public}d", openErrno);
+                    return openErrno == ENOENT ? E_NOT_FOUND : E_FILE_ERROR;
+                }
+                fdsan_exchange_owner_tag(fd, 0, WP_DOMAIN);
+                handles.push_back(std::make_unique<WallpaperHandle>());
+                if (!handles.back()->Attach(fd)) {
+                    return E_FILE_ERROR;
+                }
+                fileIndex = fileIndexes.emplace(filePath, static_cast<int32_t>(handles.size()) - 1).first;
+            }
+            // Laid out as VariantInfoField.
+            variantInfos.insert(variantInfos.end(), { static_cast<int32_t>(foldState),
+                static_cast<int32_t>(rotateState), handles[fileIndex->second]->GetSize(), wallpaperData.wallpaperId,
+                fileIndex->second });
+        }
     }
     return NO_ERROR;
 }
 
-ErrorCode WallpaperService::GetImageSize(
-    int32_t userId, WallpaperType wallpaperType, int32_t &size, int32_t foldState, int32_t rotateState)
+ErrCode WallpaperService::GetThumbnail(int32_t wallpaperType, int32_t foldState, int32_t rotateState, int32_t maxEdge,
+    int32_t &size, bool &hasFd, int &fd)
 {
-    HILOG_DEBUG("WallpaperService::GetImageSize start.");
-    std::string filePathName;
-    if (!GetWallpaperDataPath(userId, wallpaperType, filePathName, foldState, rotateState)) {
-        return E_DEAL_FAILED;
+    WallpaperHandle handle;
+    ErrorCode ret = GetThumbnailHandle(wallpaperType, foldState, rotateState, maxEdge, handle);
+    size = handle.GetSize();
+    hasFd = handle.GetFd() >= 0;
+    fd = handle.Release();
+    return ret;
+}
+
+ErrorCode WallpaperService::GetThumbnailHandle(
+    int32_t wallpaperType, int32_t foldState, int32_t rotateState, int32_t maxEdge, WallpaperHandle &handle)
+{
+    if (!IsSystemApp()) {
+        HILOG_ERROR("CallingApp is not SystemApp.");
+        return E_NOT_SYSTEM_APP;
     }
-    HILOG_INFO("GetImageSize file: %{public}s", FileDeal::ToBeAnonymous(filePathName).c_str());
-    if (!OHOS::FileExists(filePathName)) {
-        HILOG_ERROR("file is not exist.");
-        return E_NOT_FOUND;
+    if (!CheckCallingPermission(WALLPAPER_PERMISSION_NAME_GET_WALLPAPER)) {
+        HILOG_ERROR("GetThumbnail no get permission!");
+        return E_NO_PERMISSION;
     }
-    std::lock_guard<std::mutex> lock(mtx_);
-    FILE *fd = fopen(filePathName.c_str(), "rb");
-    if (fd == nullptr) {
-        HILOG_ERROR("fopen file failed, errno %{public}d", errno);
-        return E_FILE_ERROR;
+    if ((wallpaperType != static_cast<int32_t>(WALLPAPER_LOCKSCREEN)
+        && wallpaperType != static_cast<int32_t>(WALLPAPER_SYSTEM)) || maxEdge <= 0) {
+        return E_PARAMETERS_INVALID;
     }
-    int32_t fend = fseek(fd, 0, SEEK_END);
-    size = ftell(fd);
-    int32_t fset = fseek(fd, 0, SEEK_SET);
-    if (size <= 0 || fend != 0 || fset != 0) {
-        HILOG_ERROR("ftell file failed or fseek file failed, errno %{public}d", errno);
-        fclose(fd);
-        return E_FILE_ERROR;
+    auto type = static_cast<WallpaperType>(wallpaperType);
+    int32_t userId = QueryActiveUserId();
+    WallpaperResourceType resType = GetResType(userId, type);
+    if (resType != PICTURE && resType != DEFAULT) {
+        HILOG_ERROR("Current user's wallpaper is live video, not image.");
+        return NO_ERROR;
+    }
+    // Renditions are served uncached, the fd cache is kept for the full size pictures every client decodes.
+    ErrorCode ret = OpenWallpaperHandle(
+        userId, type,
+        [this, foldState, rotateState, maxEdge](const WallpaperData &wallpaperData, std::string &filePath) {
+            return GetThumbnailPath(wallpaperData, filePath, foldState, rotateState, maxEdge);
+        },
+        handle);
+    if (ret != NO_ERROR) {
+        HILOG_ERROR("OpenWallpaperHandle failed!");
+        return ret;
     }
-    fclose(fd);
     return NO_ERROR;
 }
 
-ErrorCode WallpaperService::GetImageFd(
-    int32_t userId, WallpaperType wallpaperType, int32_t &fd, int32_t foldState, int32_t rotateState)
+bool WallpaperService::GetThumbnailPath(const WallpaperData &wallpaperData, std::string &filePathName,
+    int32_t foldState, int32_t rotateState, int32_t maxEdge)
 {
-    HILOG_DEBUG("WallpaperService::GetImageFd start.");
-    std::string filePathName;
-    if (!GetWallpaperDataPath(userId, wallpaperType, filePathName, foldState, rotateState)) {
-        return E_DEAL_FAILED;
+    std::string sourceFile = GetWallpaperPath(foldState, rotateState, wallpaperData);
+    if (sourceFile.empty()) {
+        return false;
     }
-    if (GetResType(userId, wallpaperType) == WallpaperResourceType::PACKAGE) {
-        HILOG_INFO("The current wallpaper is a custom wallpaper");
+    filePathName = PickThumbnailFile(wallpaperData, sourceFile, maxEdge);
+    return true;
+}
+
+ErrCode WallpaperService::GetWallpaperTexture(int32_t wallpaperType, int32_t foldState, int32_t rotateState,
+    int32_t &size, int32_t &width, int32_t &height, int32_t &blockFormat, int32_t &mipCount, bool &hasFd, int &fd)
+{
+    WallpaperHandle handle;
+    WallpaperTextureInfo textureInfo;
+    ErrorCode ret = GetWallpaperTextureHandle(wallpaperType, foldState, rotateState, handle, textureInfo);
+    hasFd = handle.GetFd() >= 0;
+    size = handle.GetSize();
+    width = textureInfo.width;
+    height = textureInfo.height;
+    blockFormat = textureInfo.blockFormat;
+    mipCount = textureInfo.mipCount;
+    fd = handle.Release();
+    return ret;
+}
+
+ErrorCode WallpaperService::GetWallpaperTextureHandle(int32_t wallpaperType, int32_t foldState, int32_t rotateState,
+    WallpaperHandle &handle, WallpaperTextureInfo &textureInfo)
+{
+    if (!IsSystemApp()) {
+        HILOG_ERROR("CallingApp is not SystemApp.");
+        return E_NOT_SYSTEM_APP;
+    }
+    if (!CheckCallingPermission(WALLPAPER_PERMISSION_NAME_GET_WALLPAPER)) {
+        HILOG_ERROR("GetWallpaperTexture no get permission!");
+        return E_NO_PERMISSION;
+    }
+    if (wallpaperType != static_cast<int32_t>(WALLPAPER_LOCKSCREEN)
+        && wallpaperType != static_cast<int32_t>(WALLPAPER_SYSTEM)) {
+        return E_PARAMETERS_INVALID;
+    }
+    auto type = static_cast<WallpaperType>(wallpaperType);
+    int32_t userId = QueryActiveUserId();
+    WallpaperData currentData;
+    std::string texturePath;
+    // Without a sidecar the handle stays empty and the caller decodes the picture as before.
+    if (GetResType(userId, type) != PICTURE || !FindWallpaperData(userId, type, currentData)
+        || !GetTexturePath(currentData, texturePath, foldState, rotateState)) {
         return NO_ERROR;
     }
-    fd = open(filePathName.c_str(), O_RDONLY, S_IREAD);
-    if (fd < 0) {
-        HILOG_ERROR("Open file failed, errno %{public}d", errno);
-        ReporterFault(FaultType::LOAD_WALLPAPER_FAULT, FaultCode::RF_FD_INPUT_FAILED);
-        return E_DEAL_FAILED;
+    ErrorCode ret = OpenWallpaperHandle(
+        userId, type,
+        [this, foldState, rotateState](const WallpaperData &wallpaperData, std::string &filePath) {
+            return GetTexturePath(wallpaperData, filePath, foldState, rotateState);
+        },
+        handle);
+    if (ret != NO_ERROR) {
+        HILOG_ERROR("OpenWallpaperHandle failed!");
+        return ret;
+    }
+    if (!ReadTextureHeader(handle.GetFd(), textureInfo)) {
+        handle.Reset();
+        textureInfo = WallpaperTextureInfo();
+        return E_FILE_ERROR;
     }
-    fdsan_exchange_owner_tag(fd, 0, WP_DOMAIN);
-    HILOG_INFO("fd = %{public}d", fd);
     return NO_ERROR;
 }
 
-bool WallpaperService::GetWallpaperDataPath(
-    int32_t userId, WallpaperType wallpaperType, std::string &filePathName, int32_t foldState, int32_t rotateState)
+bool WallpaperService::GetTexturePath(
+    const WallpaperData &wallpaperData, std::string &filePathName, int32_t foldState, int32_t rotateState)
+{
+    std::string sourceFile = GetWallpaperPath(foldState, rotateState, wallpaperData);
+    auto textureFile = wallpaperData.textureFiles.find(sourceFile);
+    if (textureFile == wallpaperData.textureFiles.end()) {
+        return false;
+    }
+    filePathName = textureFile->second;
+    return true;
+}
+
+bool WallpaperService::FindWallpaperData(int32_t userId, WallpaperType wallpaperType, WallpaperData &wallpaperData)
 {
     auto iterator = wallpaperType == WALLPAPER_SYSTEM ? systemWallpaperMap_.Find(userId)
                                                       : lockWallpaperMap_.Find(userId);
@@ -2125,11 +3623,12 @@ bool WallpaperService::GetWallpaperDataPath(
             return false;
         }
     }
-    filePathName = GetWallpaperPath(foldState, rotateState, iterator.second);
-    return filePathName != "";
+    wallpaperData = iterator.second;
+    return true;
 }
 
-std::string WallpaperService::GetWallpaperPath(int32_t foldState, int32_t rotateState, WallpaperData &wallpaperData)
+std::string WallpaperService::GetWallpaperPath(
+    int32_t foldState, int32_t rotateState, const WallpaperData &wallpaperData)
 {
     std::string wallpaperFilePath;
     if (foldState == static_cast<int32_t>(FoldState::UNFOLD_2)) {
@@ -2242,14 +3741,23 @@ int32_t WallpaperService::CallbackParcel(
 {
     switch (static_cast<IWallpaperServiceIpcCode>(code)) {
         case IWallpaperServiceIpcCode::COMMAND_GET_PIXEL_MAP: {
-            return GetPixleMapParcel(data, reply, false);
+            return GetPixleMapParcel(data, reply);
         }
         case IWallpaperServiceIpcCode::COMMAND_GET_PIXEL_MAP_V9: {
-            return GetPixleMapParcel(data, reply, true);
+            return GetPixleMapParcel(data, reply);
         }
         case IWallpaperServiceIpcCode::COMMAND_GET_CORRESPOND_WALLPAPER: {
             return GetCorrespondWallpaperParcel(data, reply);
         }
+        case IWallpaperServiceIpcCode::COMMAND_GET_ALL_CORRESPOND_WALLPAPERS: {
+            return GetAllCorrespondWallpapersParcel(data, reply);
+        }
+        case IWallpaperServiceIpcCode::COMMAND_GET_THUMBNAIL: {
+            return GetThumbnailParcel(data, reply);
+        }
+        case IWallpaperServiceIpcCode::COMMAND_GET_WALLPAPER_TEXTURE: {
+            return GetWallpaperTextureParcel(data, reply);
+        }
         case IWallpaperServiceIpcCode::COMMAND_GET_FILE: {
             return GetFileParcel(data, reply);
         }
@@ -2264,7 +3772,7 @@ int32_t WallpaperService::CallbackParcel(
     }
 }
 
-int32_t WallpaperService::GetPixleMapParcel(MessageParcel &data, MessageParcel &reply, bool isSystemApi)
+int32_t WallpaperService::GetPixleMapParcel(MessageParcel &data, MessageParcel &reply)
 {
     std::u16string myDescriptor = WallpaperServiceStub::GetDescriptor();
     std::u16string remoteDescriptor = data.ReadInterfaceToken();
@@ -2273,38 +3781,64 @@ int32_t WallpaperService::GetPixleMapParcel(MessageParcel &data, MessageParcel &
         return E_CHECK_DESCRIPTOR_ERROR;
     }
     int32_t wallpaperType = data.ReadInt32();
-    int32_t size;
-    int fd = DEFAULT_WALLPAPER_ID;
-    ErrCode errCode = E_UNKNOWN;
-    if (isSystemApi) {
-        errCode = GetPixelMapV9(wallpaperType, size, fd);
-    } else {
-        errCode = GetPixelMap(wallpaperType, size, fd);
+    // GetPixelMap and GetPixelMapV9 serve the same handle.
+    WallpaperHandle handle;
+    ErrCode errCode = GetWallpaperHandle(wallpaperType, handle);
+    return WriteWallpaperHandle(reply, errCode, handle);
+}
+
+int32_t WallpaperService::GetCorrespondWallpaperParcel(MessageParcel &data, MessageParcel &reply)
+{
+    std::u16string myDescriptor = WallpaperServiceStub::GetDescriptor();
+    std::u16string remoteDescriptor = data.ReadInterfaceToken();
+    if (myDescriptor != remoteDescriptor) {
+        HILOG_ERROR("Remote descriptor not the same as local descriptor.");
+        return E_CHECK_DESCRIPTOR_ERROR;
     }
+    int32_t wallpaperType = data.ReadInt32();
+    int32_t foldState = data.ReadInt32();
+    int32_t rotateState = data.ReadInt32();
+    WallpaperHandle handle;
+    ErrCode errCode = GetCorrespondWallpaperHandle(wallpaperType, foldState, rotateState, handle);
+    return WriteWallpaperHandle(reply, errCode, handle);
+}
+
+int32_t WallpaperService::GetAllCorrespondWallpapersParcel(MessageParcel &data, MessageParcel &reply)
+{
+    std::u16string myDescriptor = WallpaperServiceStub::GetDescriptor();
+    std::u16string remoteDescriptor = data.ReadInterfaceToken();
+    if (myDescriptor != remoteDescriptor) {
+        HILOG_ERROR("Remote descriptor not the same as local descriptor.");
+        return E_CHECK_DESCRIPTOR_ERROR;
+    }
+    int32_t wallpaperType = data.ReadInt32();
+    std::vector<int32_t> variantInfos;
+    std::vector<std::unique_ptr<WallpaperHandle>> handles;
+    ErrCode errCode = GetAllCorrespondWallpaperHandles(wallpaperType, variantInfos, handles);
     if (!reply.WriteInt32(errCode)) {
         HILOG_ERROR("WriteInt32 fail!");
-        if (fd > DEFAULT_WALLPAPER_ID) {
-            fdsan_close_with_tag(fd, WP_DOMAIN);
-        }
         return ERR_INVALID_VALUE;
     }
-    if (!reply.WriteInt32(size)) {
+    if (!reply.WriteInt32(static_cast<int32_t>(variantInfos.size()))) {
         HILOG_ERROR("WriteInt32 fail!");
-        if (fd > DEFAULT_WALLPAPER_ID) {
-            fdsan_close_with_tag(fd, WP_DOMAIN);
-        }
         return ERR_INVALID_DATA;
     }
-    HILOG_ERROR("getpixelmap fd %{public}d!", fd);
-    if (!reply.WriteFileDescriptor(fd)) {
-        HILOG_ERROR("WriteFileDescriptor fail!");
-        if (fd > DEFAULT_WALLPAPER_ID) {
-            fdsan_close_with_tag(fd, WP_DOMAIN);
+    for (int32_t variantInfo : variantInfos) {
+        if (!reply.WriteInt32(variantInfo)) {
+            HILOG_ERROR("WriteInt32 fail!");
+            return ERR_INVALID_DATA;
         }
+    }
+    if (!reply.WriteInt32(static_cast<int32_t>(handles.size()))) {
+        HILOG_ERROR("WriteInt32 fail!");
         return ERR_INVALID_DATA;
     }
-    if (fd > DEFAULT_WALLPAPER_ID) {
-        fdsan_close_with_tag(fd, WP_DOMAIN);
+    // The handles close their fds once the reply holds its own duplicates.
+    for (const auto &handle : handles) {
+        if (!reply.WriteFileDescriptor(handle->GetFd())) {
+            HILOG_ERROR("WriteFileDescriptor fail!");
+            return ERR_INVALID_DATA;
+        }
     }
     if (errCode == NO_ERROR) {
         return E_OK;
@@ -2312,7 +3846,24 @@ int32_t WallpaperService::GetPixleMapParcel(MessageParcel &data, MessageParcel &
     return errCode;
 }
 
-int32_t WallpaperService::GetCorrespondWallpaperParcel(MessageParcel &data, MessageParcel &reply)
+int32_t WallpaperService::GetThumbnailParcel(MessageParcel &data, MessageParcel &reply)
+{
+    std::u16string myDescriptor = WallpaperServiceStub::GetDescriptor();
+    std::u16string remoteDescriptor = data.ReadInterfaceToken();
+    if (myDescriptor != remoteDescriptor) {
+        HILOG_ERROR("Remote descriptor not the same as local descriptor.");
+        return E_CHECK_DESCRIPTOR_ERROR;
+    }
+    int32_t wallpaperType = data.ReadInt32();
+    int32_t foldState = data.ReadInt32();
+    int32_t rotateState = data.ReadInt32();
+    int32_t maxEdge = data.ReadInt32();
+    WallpaperHandle handle;
+    ErrCode errCode = GetThumbnailHandle(wallpaperType, foldState, rotateState, maxEdge, handle);
+    return WriteWallpaperHandle(reply, errCode, handle);
+}
+
+int32_t WallpaperService::GetWallpaperTextureParcel(MessageParcel &data, MessageParcel &reply)
 {
     std::u16string myDescriptor = WallpaperServiceStub::GetDescriptor();
     std::u16string remoteDescriptor = data.ReadInterfaceToken();
@@ -2323,32 +3874,42 @@ int32_t WallpaperService::GetCorrespondWallpaperParcel(MessageParcel &data, Mess
     int32_t wallpaperType = data.ReadInt32();
     int32_t foldState = data.ReadInt32();
     int32_t rotateState = data.ReadInt32();
-    int32_t size;
-    int fd = DEFAULT_WALLPAPER_ID;
-    ErrCode errCode = GetCorrespondWallpaper(wallpaperType, foldState, rotateState, size, fd);
+    WallpaperHandle handle;
+    WallpaperTextureInfo textureInfo;
+    ErrCode errCode = GetWallpaperTextureHandle(wallpaperType, foldState, rotateState, handle, textureInfo);
     if (!reply.WriteInt32(errCode)) {
         HILOG_ERROR("WriteInt32 fail!");
-        if (fd > DEFAULT_WALLPAPER_ID) {
-            fdsan_close_with_tag(fd, WP_DOMAIN);
-        }
         return ERR_INVALID_VALUE;
     }
-    if (!reply.WriteInt32(size)) {
+    if (!reply.WriteInt32(handle.GetSize()) || !reply.WriteInt32(textureInfo.width)
+        || !reply.WriteInt32(textureInfo.height) || !reply.WriteInt32(textureInfo.blockFormat)
+        || !reply.WriteInt32(textureInfo.mipCount)) {
         HILOG_ERROR("WriteInt32 fail!");
-        if (fd > DEFAULT_WALLPAPER_ID) {
-            fdsan_close_with_tag(fd, WP_DOMAIN);
-        }
         return ERR_INVALID_DATA;
     }
-    if (!reply.WriteFileDescriptor(fd)) {
-        HILOG_ERROR("WriteFileDescriptor fail!");
-        if (fd > DEFAULT_WALLPAPER_ID) {
-            fdsan_close_with_tag(fd, WP_DOMAIN);
-        }
+    // Without a sidecar there is no fd to send, the client falls back to decoding the picture.
+    if (!WriteHandleFd(reply, handle)) {
         return ERR_INVALID_DATA;
     }
-    if (fd > DEFAULT_WALLPAPER_ID) {
-        fdsan_close_with_tag(fd, WP_DOMAIN);
+    if (errCode == NO_ERROR) {
+        return E_OK;
+    }
+    return errCode;
+}
+
+int32_t WallpaperService::WriteWallpaperHandle(MessageParcel &reply, ErrCode errCode, const WallpaperHandle &handle)
+{
+    if (!reply.WriteInt32(errCode)) {
+        HILOG_ERROR("WriteInt32 fail!");
+        return ERR_INVALID_VALUE;
+    }
+    if (!reply.WriteInt32(handle.GetSize())) {
+        HILOG_ERROR("WriteInt32 fail!");
+        return ERR_INVALID_DATA;
+    }
+    // A live wallpaper or a failed open leaves the handle empty, only the has-fd flag is sent then.
+    if (!WriteHandleFd(reply, handle)) {
+        return ERR_INVALID_DATA;
     }
     if (errCode == NO_ERROR) {
         return E_OK;
@@ -2356,6 +3917,20 @@ int32_t WallpaperService::GetCorrespondWallpaperParcel(MessageParcel &data, Mess
     return errCode;
 }
 
+bool WallpaperService::WriteHandleFd(MessageParcel &reply, const WallpaperHandle &handle)
+{
+    bool hasFd = handle.GetFd() >= 0;
+    if (!reply.WriteBool(hasFd)) {
+        HILOG_ERROR("WriteBool fail!");
+        return false;
+    }
+    if (hasFd && !reply.WriteFileDescriptor(handle.GetFd())) {
+        HILOG_ERROR("WriteFileDescriptor fail!");
+        return false;
+    }
+    return true;
+}
+
 int32_t WallpaperService::GetFileParcel(MessageParcel &data, MessageParcel &reply)
 {
     std::u16string myDescriptor = WallpaperServiceStub::GetDescriptor();
@@ -2407,11 +3982,17 @@ int32_t WallpaperService::SetwallpaperByPixelMapParcel(MessageParcel &data, Mess
     }
     wallpaperRawData.data = data.ReadRawData(wallpaperRawData.size);
     int32_t wallpaperType = data.ReadInt32();
+    // The storage format is part of the IDL signature, proxies always send it along with the wallpaper type.
+    int32_t storageFormat = STORAGE_DEFAULT;
+    if (!data.ReadInt32(storageFormat)) {
+        HILOG_ERROR("Read storage format fail!");
+        return ERR_INVALID_DATA;
+    }
     ErrCode errCode = E_UNKNOWN;
     if (isSystemApi) {
-        errCode = SetWallpaperV9ByPixelMap(wallpaperRawData, wallpaperType);
+        errCode = SetWallpaperV9ByPixelMap(wallpaperRawData, wallpaperType, storageFormat);
     } else {
-        errCode = SetWallpaperByPixelMap(wallpaperRawData, wallpaperType);
+        errCode = SetWallpaperByPixelMap(wallpaperRawData, wallpaperType, storageFormat);
     }
     if (errCode == NO_ERROR) {
         return E_OK;
@@ -65,6 +65,8 @@ void GetImageFuzzTest(FuzzedDataProvider &provider)
     WallpaperMgrService::WallpaperManager::GetInstance().GetPixelMap(wallpaperType, apiInfo, pixelMap);
     WallpaperMgrService::WallpaperManager::GetInstance().GetCorrespondWallpaper(
         wallpaperType, FoldState::NORMAL, RotateState::PORT, pixelMap);
+    std::vector<WallpaperMgrService::CorrespondWallpaper> wallpapers;
+    WallpaperMgrService::WallpaperManager::GetInstance().GetAllCorrespondWallpapers(wallpaperType, wallpapers);
 }
 } // namespace OHOS
 
@@ -71,13 +71,17 @@ void WallpaperManagerProxyFuzzTest(FuzzedDataProvider &provider)
     WallpaperMgrService::WallpaperRawData wallpaperRawData;
     wallpaperRawData.size = value.size();
     wallpaperRawData.data = value.data();
-    wallpaperProxy->SetWallpaperByPixelMap(wallpaperRawData, wallpaperType);
-    wallpaperProxy->SetWallpaperV9ByPixelMap(wallpaperRawData, wallpaperType);
+    int32_t storageFormat = provider.ConsumeIntegral<int32_t>();
+    wallpaperProxy->SetWallpaperByPixelMap(wallpaperRawData, wallpaperType, storageFormat);
+    wallpaperProxy->SetWallpaperV9ByPixelMap(wallpaperRawData, wallpaperType, storageFormat);
+    wallpaperProxy->SetWallpaperBySharedPixels(fd, wallpaperType, storageFormat);
+    wallpaperProxy->SetWallpaperV9BySharedPixels(fd, wallpaperType, storageFormat);
 
     int32_t pixelmapSize;
     int32_t pixelmapFd;
-    wallpaperProxy->GetPixelMapV9(wallpaperType, pixelmapSize, pixelmapFd);
-    wallpaperProxy->GetPixelMap(wallpaperType, pixelmapSize, pixelmapFd);
+    bool hasFd = false;
+    wallpaperProxy->GetPixelMapV9(wallpaperType, pixelmapSize, hasFd, pixelmapFd);
+    wallpaperProxy->GetPixelMap(wallpaperType, pixelmapSize, hasFd, pixelmapFd);
     WallpaperMgrService::WallpaperPictureInfoByParcel wallpaperPictureInfoByParcel;
 
     WallpaperMgrService::WallpaperPictureInfo wallpaperPictureInfo;
@@ -92,7 +96,19 @@ void WallpaperManagerProxyFuzzTest(FuzzedDataProvider &provider)
 
     int32_t foldState = 0;
     int32_t rotateState = 0;
-    wallpaperProxy->GetCorrespondWallpaper(wallpaperType, foldState, rotateState, pixelmapSize, pixelmapFd);
+    wallpaperProxy->GetCorrespondWallpaper(wallpaperType, foldState, rotateState, pixelmapSize, hasFd, pixelmapFd);
+    int32_t maxEdge = provider.ConsumeIntegral<int32_t>();
+    wallpaperProxy->GetThumbnail(wallpaperType, foldState, rotateState, maxEdge, pixelmapSize, hasFd, pixelmapFd);
+    WallpaperMgrService::WallpaperTextureInfo textureInfo;
+    wallpaperProxy->GetWallpaperTexture(wallpaperType, foldState, rotateState, pixelmapSize, textureInfo.width,
+        textureInfo.height, textureInfo.blockFormat, textureInfo.mipCount, hasFd, pixelmapFd);
+    std::vector<int32_t> variantInfos;
+    std::vector<int> variantFds;
+    wallpaperProxy->GetAllCorrespondWallpapers(wallpaperType, variantInfos, variantFds);
+    std::vector<uint64_t> palette;
+    wallpaperProxy->GetColorPalette(wallpaperType, palette);
+    int32_t wallpaperId = 0;
+    wallpaperProxy->CheckWallpaperAccess(wallpaperType, wallpaperId);
 }
 } // namespace OHOS
 
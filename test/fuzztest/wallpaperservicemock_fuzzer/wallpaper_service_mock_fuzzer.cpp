@@ -53,28 +53,32 @@ public:
         return 0;
     }
 
-    ErrCode SetWallpaperByPixelMap(const WallpaperRawData &wallpaperRawdata, int32_t wallpaperType) override
+    ErrCode SetWallpaperByPixelMap(
+        const WallpaperRawData &wallpaperRawdata, int32_t wallpaperType, int32_t storageFormat) override
     {
         (void)wallpaperRawdata;
         (void)wallpaperType;
+        (void)storageFormat;
         return 0;
     }
 
-    ErrCode GetPixelMap(int32_t wallpaperType, int32_t &size, int &fd) override
+    ErrCode GetPixelMap(int32_t wallpaperType, int32_t &size, bool &hasFd, int &fd) override
     {
         (void)wallpaperType;
         (void)size;
+        (void)hasFd;
         (void)fd;
         return 0;
     }
 
-    ErrCode GetCorrespondWallpaper(
-        int32_t wallpaperType, int32_t foldState, int32_t rotateState, int32_t &size, int &fd) override
+    ErrCode GetCorrespondWallpaper(int32_t wallpaperType, int32_t foldState, int32_t rotateState, int32_t &size,
+        bool &hasFd, int &fd) override
     {
         (void)wallpaperType;
         (void)foldState;
         (void)rotateState;
         (void)size;
+        (void)hasFd;
         (void)fd;
         return 0;
     }
@@ -147,17 +151,20 @@ public:
         return 0;
     }
 
-    ErrCode SetWallpaperV9ByPixelMap(const WallpaperRawData &wallpaperRawdata, int32_t wallpaperType) override
+    ErrCode SetWallpaperV9ByPixelMap(
+        const WallpaperRawData &wallpaperRawdata, int32_t wallpaperType, int32_t storageFormat) override
     {
         (void)wallpaperRawdata;
         (void)wallpaperType;
+        (void)storageFormat;
         return 0;
     }
 
-    ErrCode GetPixelMapV9(int32_t wallpaperType, int32_t &size, int &fd) override
+    ErrCode GetPixelMapV9(int32_t wallpaperType, int32_t &size, bool &hasFd, int &fd) override
     {
         (void)wallpaperType;
         (void)size;
+        (void)hasFd;
         (void)fd;
         return 0;
     }
@@ -206,6 +213,75 @@ public:
         return 0;
     }
 
+    ErrCode SetWallpaperBySharedPixels(int fd, int32_t wallpaperType, int32_t storageFormat) override
+    {
+        (void)fd;
+        (void)wallpaperType;
+        (void)storageFormat;
+        return 0;
+    }
+
+    ErrCode SetWallpaperV9BySharedPixels(int fd, int32_t wallpaperType, int32_t storageFormat) override
+    {
+        (void)fd;
+        (void)wallpaperType;
+        (void)storageFormat;
+        return 0;
+    }
+
+    ErrCode GetThumbnail(int32_t wallpaperType, int32_t foldState, int32_t rotateState, int32_t maxEdge,
+        int32_t &size, bool &hasFd, int &fd) override
+    {
+        (void)wallpaperType;
+        (void)foldState;
+        (void)rotateState;
+        (void)maxEdge;
+        (void)size;
+        (void)hasFd;
+        (void)fd;
+        return 0;
+    }
+
+    ErrCode GetWallpaperTexture(int32_t wallpaperType, int32_t foldState, int32_t rotateState, int32_t &size,
+        int32_t &width, int32_t &height, int32_t &blockFormat, int32_t &mipCount, bool &hasFd,
+        int &fd) override
+    {
+        (void)wallpaperType;
+        (void)foldState;
+        (void)rotateState;
+        (void)size;
+        (void)width;
+        (void)height;
+        (void)blockFormat;
+        (void)mipCount;
+        (void)hasFd;
+        (void)fd;
+        return 0;
+    }
+
+    ErrCode GetAllCorrespondWallpapers(
+        int32_t wallpaperType, std::vector<int32_t> &variantInfos, std::vector<int> &fds) override
+    {
+        (void)wallpaperType;
+        (void)variantInfos;
+        (void)fds;
+        return 0;
+    }
+
+    ErrCode GetColorPalette(int32_t wallpaperType, std::vector<uint64_t> &palette) override
+    {
+        (void)wallpaperType;
+        (void)palette;
+        return 0;
+    }
+
+    ErrCode CheckWallpaperAccess(int32_t wallpaperType, int32_t &wallpaperId) override
+    {
+        (void)wallpaperType;
+        (void)wallpaperId;
+        return 0;
+    }
+
     int32_t CallbackParcel(uint32_t code, MessageParcel &data, MessageParcel &reply, MessageOption &option) override
     {
         return 0;
@@ -250,6 +250,23 @@ HWTEST_F(WallpaperPermissionTest, GetColorPermission001, TestSize.Level0)
     EXPECT_EQ(wallpaperErrorCode, E_NOT_SYSTEM_APP) << "throw not system app failed";
     HILOG_INFO("GetColorPermission001 end");
 }
+
+/**
+* @tc.name:    GetColorPalettePermission001
+* @tc.desc:    GetColorPalette throw not system app.
+* @tc.type:    FUNC
+* @tc.require:
+*/
+HWTEST_F(WallpaperPermissionTest, GetColorPalettePermission001, TestSize.Level0)
+{
+    HILOG_INFO("GetColorPalettePermission001 begin");
+    WallpaperPalette palette;
+    ErrorCode wallpaperErrorCode =
+        OHOS::WallpaperMgrService::WallpaperManager::GetInstance().GetColorPalette(LOCKSCREEN, palette);
+    EXPECT_EQ(wallpaperErrorCode, E_NOT_SYSTEM_APP) << "throw not system app failed";
+    EXPECT_TRUE(palette.swatches.empty());
+    HILOG_INFO("GetColorPalettePermission001 end");
+}
 /*********************   GetColor   *********************/
 
 /*********************   RegisterWallpaperCallback   *********************/
@@ -18,22 +18,36 @@
 #undef private
 #undef protected
 
+#include <fcntl.h>
 #include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include <atomic>
+#include <chrono>
 #include <ctime>
+#include <fstream>
+#include <future>
+#include <set>
+#include <thread>
 
 #include "accesstoken_kit.h"
+#include "content_digest.h"
 #include "directory_ex.h"
 #include "file_deal.h"
 #include "hilog_wrapper.h"
 #include "image_packer.h"
 #include "nativetoken_kit.h"
 #include "pixel_map.h"
+#include "pixel_map_cache.h"
 #include "scene_board_judgement.h"
+#include "shared_pixels.h"
+#include "stream_writer.h"
 #include "token_setproc.h"
 #include "wallpaper_common_event_subscriber.h"
 #include "wallpaper_manager.h"
 #include "wallpaper_manager_client.h"
+#include "wallpaper_palette_engine.h"
 #include "wallpaper_service.h"
 #include "permission_utils_mock.h"
 
@@ -988,6 +1002,208 @@ HWTEST_F(WallpaperTest, FILE_DEAL001, TestSize.Level0)
     isExist = fileOperation.IsFileExist("/data/test/theme/wallpaper/errorURI");
     EXPECT_EQ(isExist, false);
 }
+
+/**
+* @tc.name:    FILE_DEAL002
+* @tc.desc:    TransferFd copies exactly length bytes and rejects a short source
+* @tc.type:    FUNC
+* @tc.require:
+*/
+HWTEST_F(WallpaperTest, FILE_DEAL002, TestSize.Level0)
+{
+    HILOG_INFO("FILE_DEAL002  begin");
+    std::string dstFile = "/data/test/theme/wallpaper/transfer_dst.jpg";
+    int32_t srcFd = open(URI, O_RDONLY);
+    ASSERT_GE(srcFd, 0);
+    struct stat srcStat = {};
+    ASSERT_EQ(fstat(srcFd, &srcStat), 0);
+    int32_t dstFd = open(dstFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    ASSERT_GE(dstFd, 0);
+    EXPECT_EQ(FileDeal::TransferFd(srcFd, dstFd, srcStat.st_size), true);
+    struct stat dstStat = {};
+    EXPECT_EQ(fstat(dstFd, &dstStat), 0);
+    EXPECT_EQ(dstStat.st_size, srcStat.st_size);
+    lseek(srcFd, 0, SEEK_SET);
+    EXPECT_EQ(FileDeal::TransferFd(srcFd, dstFd, srcStat.st_size + 1), false);
+    EXPECT_EQ(FileDeal::TransferFd(-1, dstFd, srcStat.st_size), false);
+    close(dstFd);
+    close(srcFd);
+    FileDeal::DeleteFile(dstFile);
+}
+
+/**
+* @tc.name:    FILE_DEAL003
+* @tc.desc:    CommitFile publishes the staging file by rename, DeleteDirExcept keeps the published file
+* @tc.type:    FUNC
+* @tc.require:
+*/
+HWTEST_F(WallpaperTest, FILE_DEAL003, TestSize.Level0)
+{
+    HILOG_INFO("FILE_DEAL003  begin");
+    std::string dir = "/data/test/theme/wallpaper/commit";
+    std::string stagingFile = "/data/test/theme/wallpaper/commit_staging";
+    std::string newFile = dir + "/wallpaper_home";
+    std::string staleFile = dir + "/normal_land_wallpaper_home";
+    EXPECT_EQ(FileDeal::Mkdir(dir), true);
+    std::ofstream(stagingFile) << "new";
+    std::ofstream(newFile) << "old";
+    std::ofstream(staleFile) << "stale";
+    EXPECT_EQ(FileDeal::CommitFile(stagingFile, newFile), true);
+    EXPECT_EQ(FileDeal::IsFileExist(stagingFile), false);
+    EXPECT_EQ(FileDeal::DeleteDirExcept(dir, { newFile }), true);
+    EXPECT_EQ(FileDeal::IsFileExist(staleFile), false);
+    std::string content;
+    std::ifstream(newFile) >> content;
+    EXPECT_EQ(content, "new");
+    EXPECT_EQ(FileDeal::CommitFile(stagingFile, newFile), false);
+    FileDeal::DeleteDir(dir, true);
+}
+
+/**
+* @tc.name:    FILE_DEAL004
+* @tc.desc:    StreamWriter drains through its fixed buffer, reports progress per chunk and enforces max size
+* @tc.type:    FUNC
+* @tc.require:
+*/
+HWTEST_F(WallpaperTest, FILE_DEAL004, TestSize.Level0)
+{
+    HILOG_INFO("FILE_DEAL004  begin");
+    std::string dstFile = "/data/test/theme/wallpaper/stream_writer_dst";
+    int32_t dstFd = open(dstFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    ASSERT_GE(dstFd, 0);
+    constexpr size_t bufferSize = 16;
+    std::string payload(bufferSize * 3 + 5, 'w');
+    int32_t chunkCount = 0;
+    StreamWriter writer(dstFd, bufferSize);
+    ContentDigest digest;
+    writer.SetDigest(&digest);
+    writer.SetProgressCallback([&chunkCount](int64_t writtenSize) {
+        chunkCount++;
+        EXPECT_GT(writtenSize, 0);
+        return true;
+    });
+    EXPECT_EQ(writer.Append(payload.data(), payload.size()), true);
+    EXPECT_EQ(chunkCount, 3);
+    EXPECT_EQ(writer.Flush(), true);
+    EXPECT_EQ(chunkCount, 4);
+    EXPECT_EQ(writer.GetTotalSize(), static_cast<int64_t>(payload.size()));
+    close(dstFd);
+    struct stat dstStat = {};
+    EXPECT_EQ(stat(dstFile.c_str(), &dstStat), 0);
+    EXPECT_EQ(dstStat.st_size, static_cast<off_t>(payload.size()));
+    uint64_t fileDigest = 0;
+    EXPECT_EQ(ContentDigest::DigestFile(dstFile, fileDigest), true);
+    EXPECT_EQ(digest.Final(), fileDigest);
+
+    StreamWriter limitWriter(-1, bufferSize);
+    limitWriter.SetMaxSize(bufferSize);
+    EXPECT_EQ(limitWriter.Append(payload.data(), payload.size()), false);
+    EXPECT_EQ(limitWriter.GetStatus(), StreamStatus::OVERSIZED);
+    FileDeal::DeleteFile(dstFile);
+}
+
+/**
+* @tc.name:    FILE_DEAL005
+* @tc.desc:    ContentDigest gives the same digest for the same content, however it is fed
+* @tc.type:    FUNC
+* @tc.require:
+*/
+HWTEST_F(WallpaperTest, FILE_DEAL005, TestSize.Level0)
+{
+    HILOG_INFO("FILE_DEAL005  begin");
+    EXPECT_EQ(ContentDigest().Final(), 0xEF46DB3751D8E999ULL);
+    std::string payload(1000, 'd');
+    ContentDigest oneShot;
+    oneShot.Update(payload.data(), payload.size());
+    ContentDigest streamed;
+    streamed.Update(payload.data(), 7);
+    streamed.Update(payload.data() + 7, payload.size() - 7);
+    EXPECT_EQ(oneShot.Final(), streamed.Final());
+
+    std::string digestFile = "/data/test/theme/wallpaper/content_digest";
+    FILE *fp = fopen(digestFile.c_str(), "wb");
+    ASSERT_NE(fp, nullptr);
+    fwrite(payload.data(), 1, payload.size(), fp);
+    fclose(fp);
+    uint64_t fileDigest = 0;
+    EXPECT_EQ(ContentDigest::DigestFile(digestFile, fileDigest), true);
+    EXPECT_EQ(fileDigest, oneShot.Final());
+    payload[payload.size() - 1] = 'e';
+    ContentDigest changed;
+    changed.Update(payload.data(), payload.size());
+    EXPECT_NE(changed.Final(), fileDigest);
+    EXPECT_EQ(ContentDigest::DigestFile("/data/test/theme/wallpaper/not_exist", fileDigest), false);
+    FileDeal::DeleteFile(digestFile);
+}
+
+/**
+* @tc.name:    FILE_DEAL006
+* @tc.desc:    SharedPixels hands pixels over in a sealed memfd and rejects malformed headers
+* @tc.type:    FUNC
+* @tc.require:
+*/
+HWTEST_F(WallpaperTest, FILE_DEAL006, TestSize.Level0)
+{
+    HILOG_INFO("FILE_DEAL006  begin");
+    constexpr int32_t width = 4;
+    constexpr int32_t height = 2;
+    std::vector<uint32_t> pixels(width * height, 0xFF336699);
+    SharedPixelsHeader header = {};
+    header.magic = SharedPixels::MAGIC;
+    header.width = width;
+    header.height = height;
+    header.pixelFormat = static_cast<int32_t>(OHOS::Media::PixelFormat::RGBA_8888);
+    header.alphaType = static_cast<int32_t>(OHOS::Media::AlphaType::IMAGE_ALPHA_TYPE_OPAQUE);
+    header.rowStride = width * sizeof(uint32_t);
+    header.pixelsSize = pixels.size() * sizeof(uint32_t);
+    int32_t fd = SharedPixels::Create(header, pixels.data());
+    ASSERT_GE(fd, 0);
+    EXPECT_LT(write(fd, pixels.data(), sizeof(uint32_t)), 0);
+    {
+        SharedPixels sharedPixels;
+        EXPECT_EQ(sharedPixels.Map(fd), true);
+        EXPECT_EQ(sharedPixels.GetHeader().width, width);
+        EXPECT_EQ(memcmp(sharedPixels.GetPixels(), pixels.data(), header.pixelsSize), 0);
+    }
+    std::shared_ptr<WallpaperService> wallpaperService = std::make_shared<WallpaperService>();
+    auto pixelMap = wallpaperService->CreatePixelMapBySharedPixels(fd);
+    ASSERT_NE(pixelMap, nullptr);
+    EXPECT_EQ(pixelMap->GetWidth(), width);
+    EXPECT_EQ(pixelMap->GetHeight(), height);
+    close(fd);
+    // Packed rows are read in place, the mapping stays valid after the fd is closed.
+    EXPECT_EQ(memcmp(pixelMap->GetPixels(), pixels.data(), header.pixelsSize), 0);
+    header.rowStride = width;
+    EXPECT_LT(SharedPixels::Create(header, pixels.data()), 0);
+}
+
+/**
+* @tc.name:    FILE_DEAL007
+* @tc.desc:    WriteFile replaces the whole content, CopyFile and SyncFileSystem persist through their own fds
+* @tc.type:    FUNC
+* @tc.require:
+*/
+HWTEST_F(WallpaperTest, FILE_DEAL007, TestSize.Level0)
+{
+    HILOG_INFO("FILE_DEAL007  begin");
+    std::string dir = "/data/test/theme/wallpaper/durability";
+    ASSERT_TRUE(FileDeal::Mkdir(dir));
+    std::string file = dir + "/config";
+    EXPECT_EQ(FileDeal::WriteFile(file, "a longer first version", DurabilityMode::DATA_SYNC), true);
+    EXPECT_EQ(FileDeal::WriteFile(file, "short", DurabilityMode::NONE), true);
+    std::ifstream config(file);
+    std::string content((std::istreambuf_iterator<char>(config)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(content, "short");
+    std::string copy = dir + "/copy";
+    EXPECT_EQ(FileDeal::CopyFile(file, copy), true);
+    struct stat fileStat = {};
+    EXPECT_EQ(stat(copy.c_str(), &fileStat), 0);
+    EXPECT_EQ(fileStat.st_size, static_cast<off_t>(content.size()));
+    EXPECT_EQ(FileDeal::CopyFile(dir + "/not_exist", copy), false);
+    EXPECT_EQ(FileDeal::SyncFileSystem(dir), true);
+    EXPECT_EQ(FileDeal::SyncFileSystem(dir + "/not_exist"), false);
+    FileDeal::DeleteDir(dir, true);
+}
 /*********************   FILE_DEAL   *********************/
 
 /**
@@ -1392,7 +1608,7 @@ HWTEST_F(WallpaperTest, GetPictureFileName_001, TestSize.Level0)
     auto wallpaperDefault = fileName.find(WALLPAPER_DEFAULT);
     auto homeWallpaper = fileName.find(HOME_WALLPAPER);
     EXPECT_EQ((wallpaperDefault != string::npos) || (homeWallpaper != string::npos), true);
-    wallpaperService->SetWallpaperBackupData(TEST_USERID1, PICTURE, URI, WALLPAPER_SYSTEM);
+    wallpaperService->SetWallpaperBackupData(TEST_USERID1, PICTURE, URI, WALLPAPER_SYSTEM, "", {});
     wallpaperService->GetPictureFileName(TEST_USERID1, WALLPAPER_SYSTEM, fileName);
     auto pos = fileName.find(to_string(TEST_USERID1));
     EXPECT_NE(pos, string::npos);
@@ -1535,6 +1751,46 @@ HWTEST_F(WallpaperTest, SetAllWallpapers006, TestSize.Level0)
     EXPECT_EQ(wallpaperErrorCode, E_OK) << "Failed to SetAllWallpapers";
 }
 
+/**
+* @tc.name: SetAllWallpapers007
+* @tc.desc: GetCorrespondWallpaper and GetAllCorrespondWallpapers keep succeeding while SetAllWallpapers swaps the
+*           wallpaper dir
+* @tc.type: FUNC
+* @tc.require:
+*/
+HWTEST_F(WallpaperTest, SetAllWallpapers007, TestSize.Level0)
+{
+    HILOG_INFO("SetAllWallpapers007 begin");
+    constexpr int32_t setTimes = 10;
+    // The two sets differ in content, so none of them is skipped as unchanged and every one swaps the dir.
+    std::vector<WallpaperInfo> wallpaperInfo = { wallpaperInfo_normal_port, wallpaperInfo_normal_land };
+    std::vector<WallpaperInfo> swappedInfo = { { FoldState::NORMAL, RotateState::PORT, NORMAL_LAND_URI },
+        { FoldState::NORMAL, RotateState::LAND, NORMAL_PORT_URI } };
+    std::atomic<bool> setDone{ false };
+    std::atomic<int32_t> setFailed{ 0 };
+    std::thread setter([&]() {
+        for (int32_t i = 0; i < setTimes; i++) {
+            auto &infos = i % 2 == 0 ? swappedInfo : wallpaperInfo;
+            if (WallpaperManager::GetInstance().SetAllWallpapers(infos, SYSTYEM) != E_OK) {
+                setFailed++;
+            }
+        }
+        setDone = true;
+    });
+    int32_t getTimes = 0;
+    while (!setDone) {
+        std::shared_ptr<OHOS::Media::PixelMap> pixelMap;
+        EXPECT_EQ(WallpaperManager::GetInstance().GetCorrespondWallpaper(SYSTYEM, NORMAL, PORT, pixelMap), E_OK);
+        std::vector<CorrespondWallpaper> wallpapers;
+        EXPECT_EQ(WallpaperManager::GetInstance().GetAllCorrespondWallpapers(SYSTYEM, wallpapers), E_OK);
+        getTimes++;
+    }
+    setter.join();
+    EXPECT_EQ(setFailed, 0);
+    EXPECT_GT(getTimes, 0);
+    EXPECT_EQ(WallpaperManager::GetInstance().SetAllWallpapers(wallpaperInfo, SYSTYEM), E_OK);
+}
+
 /*********************   SetAllWallpapers   *********************/
 
 /*********************   GetCorrespondWallpaper   *********************/
@@ -1965,6 +2221,813 @@ HWTEST_F(WallpaperTest, WallpaperTest_StateAtomic001, TestSize.Level1)
     EXPECT_EQ(wallpaperService->state_.load(),
         WallpaperService::ServiceRunningState::STATE_NOT_START) << "Failed to State";
 }
+
+/**
+ * @tc.name: WallpaperTest_WallpaperLock001
+ * @tc.desc: Test each (userId, wallpaperType) gets its own lock and every request its own staging file
+ * @tc.type: FUNC
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_WallpaperLock001, TestSize.Level1)
+{
+    HILOG_INFO("WallpaperTest_WallpaperLock001 begin");
+    std::shared_ptr<WallpaperService> wallpaperService = std::make_shared<WallpaperService>();
+    auto systemLock = wallpaperService->GetWallpaperLock(DEFAULT_USERID, WALLPAPER_SYSTEM);
+    EXPECT_EQ(systemLock, wallpaperService->GetWallpaperLock(DEFAULT_USERID, WALLPAPER_SYSTEM));
+    EXPECT_NE(systemLock, wallpaperService->GetWallpaperLock(DEFAULT_USERID, WALLPAPER_LOCKSCREEN));
+    EXPECT_NE(systemLock, wallpaperService->GetWallpaperLock(DEFAULT_USERID + 1, WALLPAPER_SYSTEM));
+    std::lock_guard<std::mutex> lock(*systemLock);
+    auto lockScreenLock = wallpaperService->GetWallpaperLock(DEFAULT_USERID, WALLPAPER_LOCKSCREEN);
+    EXPECT_TRUE(lockScreenLock->try_lock());
+    lockScreenLock->unlock();
+    wallpaperService->RemoveWallpaperLocks(DEFAULT_USERID + 1);
+    EXPECT_EQ(wallpaperService->wallpaperLockMap_.size(), 2U);
+    wallpaperService->RemoveWallpaperLocks(DEFAULT_USERID);
+    EXPECT_EQ(systemLock, wallpaperService->GetWallpaperLock(DEFAULT_USERID, WALLPAPER_SYSTEM));
+    EXPECT_EQ(lockScreenLock, wallpaperService->GetWallpaperLock(DEFAULT_USERID, WALLPAPER_LOCKSCREEN));
+    EXPECT_NE(wallpaperService->MakeStagingPath(), wallpaperService->MakeStagingPath());
+}
+
+/**
+ * @tc.name: WallpaperTest_WallpaperLock002
+ * @tc.desc: Test a reader resolving a path holds off a publish of the same slot only
+ * @tc.type: FUNC
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_WallpaperLock002, TestSize.Level1)
+{
+    HILOG_INFO("WallpaperTest_WallpaperLock002 begin");
+    std::shared_ptr<WallpaperService> wallpaperService = std::make_shared<WallpaperService>();
+    auto publishLock = wallpaperService->GetPublishLock(DEFAULT_USERID, WALLPAPER_SYSTEM);
+    EXPECT_EQ(publishLock, wallpaperService->GetPublishLock(DEFAULT_USERID, WALLPAPER_SYSTEM));
+    auto lockScreenPublishLock = wallpaperService->GetPublishLock(DEFAULT_USERID, WALLPAPER_LOCKSCREEN);
+    EXPECT_NE(publishLock, lockScreenPublishLock);
+    {
+        std::shared_lock<std::shared_mutex> reader(*publishLock);
+        EXPECT_TRUE(publishLock->try_lock_shared());
+        publishLock->unlock_shared();
+        EXPECT_FALSE(publishLock->try_lock());
+        EXPECT_TRUE(lockScreenPublishLock->try_lock());
+        lockScreenPublishLock->unlock();
+    }
+    EXPECT_TRUE(publishLock->try_lock());
+    publishLock->unlock();
+    lockScreenPublishLock.reset();
+    wallpaperService->RemoveWallpaperLocks(DEFAULT_USERID);
+    EXPECT_EQ(publishLock, wallpaperService->GetPublishLock(DEFAULT_USERID, WALLPAPER_SYSTEM));
+    EXPECT_EQ(wallpaperService->publishLockMap_.size(), 1U);
+}
+
+/**
+ * @tc.name: WallpaperTest_WallpaperVersion001
+ * @tc.desc: Test the newest committed version is found and unrelated files are ignored
+ * @tc.type: FUNC
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_WallpaperVersion001, TestSize.Level1)
+{
+    HILOG_INFO("WallpaperTest_WallpaperVersion001 begin");
+    std::shared_ptr<WallpaperService> wallpaperService = std::make_shared<WallpaperService>();
+    std::string dir = "/data/test/theme/wallpaper/version";
+    EXPECT_EQ(FileDeal::Mkdir(dir), true);
+    int32_t version = 0;
+    EXPECT_FALSE(wallpaperService->FindCommittedVersion(dir, "wallpaper_home", version));
+    std::ofstream(dir + "/wallpaper_home") << "legacy";
+    EXPECT_TRUE(wallpaperService->FindCommittedVersion(dir, "wallpaper_home", version));
+    EXPECT_EQ(version, -1);
+    EXPECT_EQ(wallpaperService->GetVersionedFile(dir + "/wallpaper_home", version), dir + "/wallpaper_home");
+    std::ofstream(dir + "/wallpaper_home.3") << "old";
+    std::ofstream(dir + "/wallpaper_home.12") << "new";
+    std::ofstream(dir + "/wallpaper_home.20.staging") << "staging";
+    std::ofstream(dir + "/normal_land_wallpaper_home.30") << "variant";
+    EXPECT_TRUE(wallpaperService->FindCommittedVersion(dir, "wallpaper_home", version));
+    EXPECT_EQ(version, 12);
+    EXPECT_EQ(wallpaperService->GetVersionedFile(dir + "/wallpaper_home", version), dir + "/wallpaper_home.12");
+    FileDeal::DeleteDir(dir, true);
+}
+
+/**
+ * @tc.name: WallpaperTest_IngestWallpaperInfos001
+ * @tc.desc: Ingest every variant concurrently into its staging file and digest it
+ * @tc.type: FUNC
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_IngestWallpaperInfos001, TestSize.Level0)
+{
+    HILOG_INFO("WallpaperTest_IngestWallpaperInfos001 begin");
+    std::shared_ptr<WallpaperService> wallpaperService = std::make_shared<WallpaperService>();
+    int32_t parallelism = wallpaperService->GetIngestParallelism();
+    EXPECT_GE(parallelism, 1);
+    EXPECT_LE(parallelism, 6);
+    std::string dir = "/data/test/theme/wallpaper/ingest";
+    ASSERT_TRUE(FileDeal::Mkdir(dir));
+    std::string srcFile = dir + "/src";
+    std::string payload(4096, 'i');
+    std::ofstream(srcFile) << payload;
+    std::vector<WallpaperPictureInfo> wallpaperInfos;
+    for (auto foldState : { FoldState::NORMAL, FoldState::UNFOLD_1, FoldState::UNFOLD_2 }) {
+        WallpaperPictureInfo wallpaperInfo;
+        wallpaperInfo.foldState = foldState;
+        wallpaperInfo.rotateState = RotateState::PORT;
+        wallpaperInfo.fd = open(srcFile.c_str(), O_RDONLY);
+        wallpaperInfo.length = static_cast<int32_t>(payload.size());
+        wallpaperInfo.tempPath = dir + "/" + wallpaperService->GetFoldStateName(foldState);
+        wallpaperInfos.push_back(wallpaperInfo);
+    }
+    std::map<std::string, uint64_t> digests;
+    EXPECT_EQ(wallpaperService->IngestWallpaperInfos(wallpaperInfos, digests), NO_ERROR);
+    ContentDigest expected;
+    expected.Update(payload.data(), payload.size());
+    EXPECT_EQ(digests.size(), wallpaperInfos.size());
+    for (const auto &wallpaperInfo : wallpaperInfos) {
+        close(wallpaperInfo.fd);
+        struct stat fileStat = {};
+        EXPECT_EQ(stat(wallpaperInfo.tempPath.c_str(), &fileStat), 0);
+        EXPECT_EQ(fileStat.st_size, static_cast<off_t>(payload.size()));
+        EXPECT_EQ(digests[wallpaperService->GetVariantName(wallpaperInfo.foldState, wallpaperInfo.rotateState)],
+            expected.Final());
+    }
+    FileDeal::DeleteDir(dir, true);
+}
+
+/**
+ * @tc.name: WallpaperTest_WallpaperManifest001
+ * @tc.desc: A wallpaper set manifest is only valid once every listed variant exists and keeps the format hint
+ * @tc.type: FUNC
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_WallpaperManifest001, TestSize.Level0)
+{
+    HILOG_INFO("WallpaperTest_WallpaperManifest001 begin");
+    std::shared_ptr<WallpaperService> wallpaperService = std::make_shared<WallpaperService>();
+    std::string dir = "/data/test/theme/wallpaper/manifest";
+    ASSERT_TRUE(FileDeal::Mkdir(dir));
+    WallpaperData wallpaperData;
+    wallpaperData.wallpaperId = 7;
+    wallpaperData.wallpaperFile = "/data/service/el1/public/wallpaper/100/system/wallpaper_home.7";
+    wallpaperData.normalLandFile = "/data/service/el1/public/wallpaper/100/system/normal_land_wallpaper_home.7";
+    wallpaperData.formatHint = "image/webp";
+    int32_t wallpaperId = -1;
+    std::string formatHint;
+    EXPECT_FALSE(wallpaperService->ReadWallpaperManifest(dir, wallpaperId, formatHint));
+    ASSERT_TRUE(wallpaperService->WriteWallpaperManifest(dir, wallpaperData));
+    std::ofstream(dir + "/wallpaper_home.7") << "port";
+    EXPECT_FALSE(wallpaperService->ReadWallpaperManifest(dir, wallpaperId, formatHint));
+    std::ofstream(dir + "/normal_land_wallpaper_home.7") << "land";
+    EXPECT_TRUE(wallpaperService->ReadWallpaperManifest(dir, wallpaperId, formatHint));
+    EXPECT_EQ(wallpaperId, 7);
+    EXPECT_EQ(formatHint, "image/webp");
+    FileDeal::DeleteDir(dir, true);
+}
+
+/**
+ * @tc.name: WallpaperTest_WallpaperManifest002
+ * @tc.desc: A finished staging set newer than the live one is rolled forward, an unfinished one is dropped
+ * @tc.type: FUNC
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_WallpaperManifest002, TestSize.Level0)
+{
+    HILOG_INFO("WallpaperTest_WallpaperManifest002 begin");
+    std::shared_ptr<WallpaperService> wallpaperService = std::make_shared<WallpaperService>();
+    ASSERT_TRUE(wallpaperService->InitUserDir(TEST_USERID1));
+    std::string wallpaperDir = wallpaperService->GetWallpaperDir(TEST_USERID1, WALLPAPER_SYSTEM);
+    std::string stagingDir = wallpaperDir + ".staging";
+    std::ofstream(wallpaperDir + "/wallpaper_home.3") << "live";
+    ASSERT_TRUE(FileDeal::Mkdir(stagingDir));
+    std::ofstream(stagingDir + "/wallpaper_home.5") << "unfinished";
+    wallpaperService->RecoverWallpaperDir(TEST_USERID1, WALLPAPER_SYSTEM);
+    EXPECT_FALSE(FileDeal::IsDirExist(stagingDir));
+    EXPECT_TRUE(FileDeal::IsFileExist(wallpaperDir + "/wallpaper_home.3"));
+    ASSERT_TRUE(FileDeal::Mkdir(stagingDir));
+    WallpaperData wallpaperData;
+    wallpaperData.wallpaperId = 5;
+    wallpaperData.wallpaperFile = stagingDir + "/wallpaper_home.5";
+    std::ofstream(wallpaperData.wallpaperFile) << "finished";
+    ASSERT_TRUE(wallpaperService->WriteWallpaperManifest(stagingDir, wallpaperData));
+    wallpaperService->RecoverWallpaperDir(TEST_USERID1, WALLPAPER_SYSTEM);
+    EXPECT_FALSE(FileDeal::IsDirExist(stagingDir));
+    EXPECT_TRUE(FileDeal::IsFileExist(wallpaperDir + "/wallpaper_home.5"));
+    EXPECT_FALSE(FileDeal::IsFileExist(wallpaperDir + "/wallpaper_home.3"));
+    wallpaperService->OnRemovedUser(TEST_USERID1);
+}
+
+/**
+ * @tc.name: WallpaperTest_StoragePackOption001
+ * @tc.desc: Storage format tiers resolve to a pack option and invalid formats are rejected
+ * @tc.type: FUNC
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_StoragePackOption001, TestSize.Level0)
+{
+    HILOG_INFO("WallpaperTest_StoragePackOption001 begin");
+    std::shared_ptr<WallpaperService> wallpaperService = std::make_shared<WallpaperService>();
+    OHOS::Media::PackOption option;
+    EXPECT_TRUE(wallpaperService->GetStoragePackOption(STORAGE_JPEG_BEST, option));
+    EXPECT_EQ(option.format, "image/jpeg");
+    EXPECT_EQ(option.quality, 100);
+    EXPECT_TRUE(wallpaperService->GetStoragePackOption(STORAGE_JPEG_MEDIUM, option));
+    EXPECT_EQ(option.format, "image/jpeg");
+    EXPECT_LT(option.quality, 100);
+    EXPECT_TRUE(wallpaperService->GetStoragePackOption(STORAGE_WEBP, option));
+    EXPECT_TRUE(option.format == "image/webp" || option.format == "image/jpeg");
+    EXPECT_TRUE(wallpaperService->GetStoragePackOption(STORAGE_DEFAULT, option));
+    EXPECT_FALSE(wallpaperService->GetStoragePackOption(STORAGE_HEIF + 1, option));
+    EXPECT_FALSE(wallpaperService->GetStoragePackOption(-1, option));
+}
+
+/**
+ * @tc.name: WallpaperTest_WallpaperHandle001
+ * @tc.desc: A wallpaper handle takes the size from the fd it serves and rejects empty files
+ * @tc.type: FUNC
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_WallpaperHandle001, TestSize.Level0)
+{
+    HILOG_INFO("WallpaperTest_WallpaperHandle001 begin");
+    std::string dir = "/data/test/theme/wallpaper/handle";
+    ASSERT_TRUE(FileDeal::Mkdir(dir));
+    std::string file = dir + "/wallpaper";
+    std::string payload(1024, 'h');
+    std::ofstream(file) << payload;
+    std::shared_ptr<WallpaperService> wallpaperService = std::make_shared<WallpaperService>();
+    WallpaperHandle handle;
+    ErrorCode ret = wallpaperService->OpenWallpaperHandle(
+        DEFAULT_USERID, WALLPAPER_SYSTEM,
+        [&file](const WallpaperData &wallpaperData, std::string &filePath) {
+            filePath = file;
+            return true;
+        },
+        handle);
+    EXPECT_EQ(ret, NO_ERROR);
+    EXPECT_GE(handle.GetFd(), 0);
+    EXPECT_EQ(handle.GetSize(), static_cast<int32_t>(payload.size()));
+    int32_t fd = handle.Release();
+    EXPECT_EQ(handle.GetFd(), -1);
+    EXPECT_EQ(handle.GetSize(), 0);
+    fdsan_close_with_tag(fd, WP_DOMAIN);
+    std::ofstream(file, std::ios::trunc).close();
+    ret = wallpaperService->OpenWallpaperHandle(
+        DEFAULT_USERID, WALLPAPER_SYSTEM,
+        [&file](const WallpaperData &wallpaperData, std::string &filePath) {
+            filePath = file;
+            return true;
+        },
+        handle);
+    EXPECT_EQ(ret, E_FILE_ERROR);
+    EXPECT_EQ(handle.GetFd(), -1);
+    FileDeal::DeleteDir(dir, true);
+}
+
+/**
+ * @tc.name: WallpaperTest_WallpaperFdCache001
+ * @tc.desc: Cached fds are served with their own offset, invalidated per wallpaper and evicted by LRU
+ * @tc.type: FUNC
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_WallpaperFdCache001, TestSize.Level0)
+{
+    HILOG_INFO("WallpaperTest_WallpaperFdCache001 begin");
+    std::string dir = "/data/test/theme/wallpaper/fdcache";
+    ASSERT_TRUE(FileDeal::Mkdir(dir));
+    std::string file = dir + "/wallpaper";
+    std::ofstream(file) << "wallpaper";
+    WallpaperFdCache fdCache(2);
+    WallpaperFdKey key(DEFAULT_USERID, WALLPAPER_SYSTEM, 0, 0);
+    WallpaperHandle served;
+    EXPECT_FALSE(fdCache.Acquire(key, served));
+    uint64_t generation = fdCache.GetGeneration(DEFAULT_USERID, WALLPAPER_SYSTEM);
+    int32_t fd = open(file.c_str(), O_RDONLY);
+    fdsan_exchange_owner_tag(fd, 0, WP_DOMAIN);
+    ASSERT_TRUE(served.Attach(fd));
+    fdCache.Insert(key, served, generation);
+    char buffer[4] = { 0 };
+    EXPECT_EQ(read(served.GetFd(), buffer, sizeof(buffer)), static_cast<ssize_t>(sizeof(buffer)));
+    WallpaperHandle cached;
+    ASSERT_TRUE(fdCache.Acquire(key, cached));
+    EXPECT_EQ(cached.GetSize(), served.GetSize());
+    EXPECT_EQ(lseek(cached.GetFd(), 0, SEEK_CUR), 0);
+    fdCache.Invalidate(DEFAULT_USERID, WALLPAPER_SYSTEM);
+    EXPECT_FALSE(fdCache.Acquire(key, cached));
+    fdCache.Insert(key, served, generation);
+    EXPECT_FALSE(fdCache.Acquire(key, cached));
+    generation = fdCache.GetGeneration(DEFAULT_USERID, WALLPAPER_SYSTEM);
+    for (int32_t foldState = 0; foldState < 3; foldState++) {
+        fdCache.Insert(WallpaperFdKey(DEFAULT_USERID, WALLPAPER_SYSTEM, foldState, 0), served, generation);
+    }
+    EXPECT_FALSE(fdCache.Acquire(WallpaperFdKey(DEFAULT_USERID, WALLPAPER_SYSTEM, 0, 0), cached));
+    EXPECT_TRUE(fdCache.Acquire(WallpaperFdKey(DEFAULT_USERID, WALLPAPER_SYSTEM, 2, 0), cached));
+    fdCache.Clear();
+    EXPECT_FALSE(fdCache.Acquire(WallpaperFdKey(DEFAULT_USERID, WALLPAPER_SYSTEM, 2, 0), cached));
+    EXPECT_NE(fdCache.Dump().find("hits=2"), std::string::npos);
+    FileDeal::DeleteDir(dir, true);
+}
+
+/**
+ * @tc.name: WallpaperTest_PixelMapCache001
+ * @tc.desc: Cached decodes are handed out as copies, invalidated per type and evicted by LRU within the byte limit
+ * @tc.type: FUNC
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_PixelMapCache001, TestSize.Level0)
+{
+    HILOG_INFO("WallpaperTest_PixelMapCache001 begin");
+    std::shared_ptr<PixelMap> pixelMap = WallpaperTest::CreateTempPixelMap();
+    ASSERT_NE(pixelMap, nullptr);
+    size_t bytes = static_cast<size_t>(pixelMap->GetByteCount());
+    PixelMapCache disabled;
+    PixelMapCacheKey key(WALLPAPER_SYSTEM, NORMAL, PORT, 1, 0, 0, 0, 0);
+    EXPECT_FALSE(disabled.IsEnabled());
+    disabled.Put(key, pixelMap);
+    EXPECT_EQ(disabled.Get(key), nullptr);
+    PixelMapCache cache(bytes * 2);
+    cache.Put(key, pixelMap);
+    std::shared_ptr<PixelMap> cached = cache.Get(key);
+    ASSERT_NE(cached, nullptr);
+    EXPECT_NE(cached, pixelMap);
+    EXPECT_EQ(cached->GetWidth(), pixelMap->GetWidth());
+    EXPECT_EQ(cached->GetHeight(), pixelMap->GetHeight());
+    EXPECT_EQ(cache.Get(PixelMapCacheKey(WALLPAPER_SYSTEM, NORMAL, PORT, 2, 0, 0, 0, 0)), nullptr);
+    cache.Put(PixelMapCacheKey(WALLPAPER_LOCKSCREEN, NORMAL, PORT, 1, 0, 0, 0, 0), pixelMap);
+    cache.Invalidate(WALLPAPER_SYSTEM);
+    EXPECT_EQ(cache.Get(key), nullptr);
+    EXPECT_NE(cache.Get(PixelMapCacheKey(WALLPAPER_LOCKSCREEN, NORMAL, PORT, 1, 0, 0, 0, 0)), nullptr);
+    cache.Put(key, pixelMap);
+    cache.Put(PixelMapCacheKey(WALLPAPER_SYSTEM, UNFOLD_1, PORT, 1, 0, 0, 0, 0), pixelMap);
+    EXPECT_EQ(cache.GetUsedBytes(), bytes * 2);
+    EXPECT_EQ(cache.Get(PixelMapCacheKey(WALLPAPER_LOCKSCREEN, NORMAL, PORT, 1, 0, 0, 0, 0)), nullptr);
+    cache.SetCapacity(bytes);
+    EXPECT_EQ(cache.Get(key), nullptr);
+    EXPECT_NE(cache.Get(PixelMapCacheKey(WALLPAPER_SYSTEM, UNFOLD_1, PORT, 1, 0, 0, 0, 0)), nullptr);
+    cache.Clear();
+    EXPECT_EQ(cache.GetUsedBytes(), 0U);
+}
+
+/**
+ * @tc.name: WallpaperTest_PixelMapCache002
+ * @tc.desc: The decode cache is on by default and lookups are validated by the permission checked wallpaper id
+ * @tc.type: FUNC
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_PixelMapCache002, TestSize.Level0)
+{
+    HILOG_INFO("WallpaperTest_PixelMapCache002 begin");
+    EXPECT_TRUE(WallpaperManager::GetInstance().pixelMapCache_.IsEnabled());
+    std::shared_ptr<WallpaperService> wallpaperService = std::make_shared<WallpaperService>();
+    int32_t wallpaperId = DEFAULT_WALLPAPER_ID;
+    EXPECT_EQ(wallpaperService->CheckWallpaperAccess(INVALID_WALLPAPER_TYPE, wallpaperId),
+        static_cast<int32_t>(E_PARAMETERS_INVALID));
+    EXPECT_EQ(wallpaperService->CheckWallpaperAccess(WALLPAPER_SYSTEM, wallpaperId), static_cast<int32_t>(NO_ERROR));
+    EXPECT_EQ(wallpaperId, wallpaperService->GetWallpaperId(WALLPAPER_SYSTEM));
+}
+
+/**
+ * @tc.name: WallpaperTest_DecodeOptions001
+ * @tc.desc: Decode options scale, crop and convert the decoded wallpaper, the log reports time and bytes per option
+ * @tc.type: PERF
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_DecodeOptions001, TestSize.Level1)
+{
+    HILOG_INFO("WallpaperTest_DecodeOptions001 begin");
+    InitializationOptions sourceOpts = { { 2048, 1024 }, OHOS::Media::PixelFormat::RGBA_8888 };
+    std::unique_ptr<PixelMap> source = PixelMap::Create(sourceOpts);
+    ASSERT_NE(source, nullptr);
+    std::string file = "/data/test/theme/wallpaper/decode_options.jpg";
+    ImagePacker imagePacker;
+    PackOption packOption;
+    packOption.format = "image/jpeg";
+    packOption.quality = HUNDRED;
+    packOption.numberHint = 1;
+    imagePacker.StartPacking(file, packOption);
+    imagePacker.AddImage(*source);
+    int64_t packedSize = 0;
+    imagePacker.FinalizePacking(packedSize);
+    ASSERT_GT(packedSize, 0);
+    struct DecodeCase {
+        WallpaperDecodeOptions options;
+        int32_t width;
+        int32_t height;
+    };
+    std::vector<DecodeCase> cases = {
+        { {}, 2048, 1024 },
+        { { 512, 0, 0, FIT_CONTAIN }, 512, 256 },
+        { { 200, 400, 0, FIT_CONTAIN }, 200, 100 },
+        { { 200, 400, 0, FIT_COVER }, 200, 400 },
+        { { 200, 400, 0, FIT_FILL }, 200, 400 },
+        { { 512, 0, static_cast<int32_t>(OHOS::Media::PixelFormat::RGB_565), FIT_CONTAIN }, 512, 256 },
+    };
+    for (const auto &decodeCase : cases) {
+        int32_t fd = open(file.c_str(), O_RDONLY);
+        ASSERT_GE(fd, 0);
+        std::shared_ptr<PixelMap> pixelMap;
+        auto begin = std::chrono::steady_clock::now();
+        ErrorCode ret = WallpaperManager::GetInstance().CreatePixelMapByFd(
+            fd, static_cast<int32_t>(packedSize), pixelMap, decodeCase.options);
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin);
+        ASSERT_EQ(ret, E_OK);
+        ASSERT_NE(pixelMap, nullptr);
+        EXPECT_EQ(pixelMap->GetWidth(), decodeCase.width);
+        EXPECT_EQ(pixelMap->GetHeight(), decodeCase.height);
+        HILOG_INFO("decode %{public}dx%{public}d format %{public}d fit %{public}d: %{public}lld us, %{public}d bytes",
+            decodeCase.options.desiredWidth, decodeCase.options.desiredHeight, decodeCase.options.pixelFormat,
+            decodeCase.options.fitMode, static_cast<long long>(elapsed.count()), pixelMap->GetByteCount());
+    }
+    WallpaperDecodeOptions invalid;
+    invalid.pixelFormat = static_cast<int32_t>(OHOS::Media::PixelFormat::NV21);
+    EXPECT_FALSE(WallpaperManager::GetInstance().IsValidDecodeOptions(invalid));
+    invalid = WallpaperDecodeOptions();
+    invalid.desiredWidth = -1;
+    EXPECT_FALSE(WallpaperManager::GetInstance().IsValidDecodeOptions(invalid));
+    FileDeal::DeleteFile(file);
+}
+
+/**
+ * @tc.name: WallpaperTest_Thumbnail001
+ * @tc.desc: Renditions are staged at 1/2, 1/4 and 1/8 and the smallest one reaching maxEdge is served
+ * @tc.type: FUNC
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_Thumbnail001, TestSize.Level0)
+{
+    HILOG_INFO("WallpaperTest_Thumbnail001 begin");
+    std::string dir = "/data/test/theme/wallpaper/thumbnail";
+    ASSERT_TRUE(FileDeal::Mkdir(dir));
+    InitializationOptions sourceOpts = { { 2048, 1024 }, OHOS::Media::PixelFormat::RGBA_8888 };
+    std::unique_ptr<PixelMap> source = PixelMap::Create(sourceOpts);
+    ASSERT_NE(source, nullptr);
+    std::string sourceFile = dir + "/wallpaper_home.1";
+    ImagePacker imagePacker;
+    PackOption packOption;
+    packOption.format = "image/jpeg";
+    packOption.quality = HUNDRED;
+    packOption.numberHint = 1;
+    imagePacker.StartPacking(sourceFile, packOption);
+    imagePacker.AddImage(*source);
+    int64_t packedSize = 0;
+    imagePacker.FinalizePacking(packedSize);
+    ASSERT_GT(packedSize, 0);
+    std::shared_ptr<WallpaperService> wallpaperService = std::make_shared<WallpaperService>();
+    wallpaperService->wallpaperTmpFullPath_ = dir + "/fwsettmp";
+    std::vector<WallpaperService::StagedThumbnail> stagedThumbnails;
+    ASSERT_TRUE(wallpaperService->StageThumbnails(sourceFile, "", stagedThumbnails));
+    ASSERT_EQ(stagedThumbnails.size(), 3U);
+    EXPECT_EQ(stagedThumbnails[0].longEdge, 1024);
+    EXPECT_EQ(stagedThumbnails[1].longEdge, 512);
+    EXPECT_EQ(stagedThumbnails[2].longEdge, 256);
+    for (const auto &stagedThumbnail : stagedThumbnails) {
+        EXPECT_TRUE(FileDeal::CommitFile(stagedThumbnail.stagingPath,
+            wallpaperService->GetThumbnailFile(sourceFile, stagedThumbnail.longEdge), false));
+    }
+    WallpaperData wallpaperData;
+    wallpaperData.wallpaperFile = sourceFile;
+    wallpaperService->LoadThumbnailFiles(dir, wallpaperData);
+    ASSERT_EQ(wallpaperData.thumbnailFiles[sourceFile].size(), 3U);
+    EXPECT_EQ(wallpaperService->PickThumbnailFile(wallpaperData, sourceFile, 100), sourceFile + "_thumb_256");
+    EXPECT_EQ(wallpaperService->PickThumbnailFile(wallpaperData, sourceFile, 300), sourceFile + "_thumb_512");
+    EXPECT_EQ(wallpaperService->PickThumbnailFile(wallpaperData, sourceFile, 1024), sourceFile + "_thumb_1024");
+    EXPECT_EQ(wallpaperService->PickThumbnailFile(wallpaperData, sourceFile, 2000), sourceFile);
+    FileDeal::DeleteDir(dir);
+}
+
+/**
+ * @tc.name: WallpaperTest_Texture001
+ * @tc.desc: ASTC texture headers are parsed and a staged texture describes the source picture
+ * @tc.type: FUNC
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_Texture001, TestSize.Level0)
+{
+    HILOG_INFO("WallpaperTest_Texture001 begin");
+    std::string dir = "/data/test/theme/wallpaper/texture";
+    ASSERT_TRUE(FileDeal::Mkdir(dir));
+    std::shared_ptr<WallpaperService> wallpaperService = std::make_shared<WallpaperService>();
+    wallpaperService->wallpaperTmpFullPath_ = dir + "/fwsettmp";
+    std::string header = { '\x13', '\xAB', '\xA1', '\x5C', 4, 4, 1, 0, 8, 0, 0, 4, 0, 1, 0, 0 };
+    std::string headerFile = dir + "/header_astc";
+    ASSERT_TRUE(FileDeal::WriteFile(headerFile, header, DurabilityMode::NONE));
+    int32_t fd = open(headerFile.c_str(), O_RDONLY);
+    ASSERT_GE(fd, 0);
+    WallpaperTextureInfo textureInfo;
+    EXPECT_TRUE(wallpaperService->ReadTextureHeader(fd, textureInfo));
+    close(fd);
+    EXPECT_EQ(textureInfo.width, 2048);
+    EXPECT_EQ(textureInfo.height, 1024);
+    EXPECT_EQ(textureInfo.blockFormat, TEXTURE_FORMAT_ASTC_4X4);
+    EXPECT_EQ(textureInfo.mipCount, 1);
+    std::set<std::string> formats;
+    ImagePacker imagePacker;
+    if (imagePacker.GetSupportedFormats(formats) != 0 || formats.find("image/astc/4*4") == formats.end()) {
+        HILOG_INFO("ASTC encoder is not supported, skip staging.");
+        FileDeal::DeleteDir(dir);
+        return;
+    }
+    InitializationOptions sourceOpts = { { 256, 128 }, OHOS::Media::PixelFormat::RGBA_8888 };
+    std::unique_ptr<PixelMap> source = PixelMap::Create(sourceOpts);
+    ASSERT_NE(source, nullptr);
+    std::string sourceFile = dir + "/wallpaper_home.1";
+    PackOption packOption;
+    packOption.format = "image/jpeg";
+    packOption.quality = HUNDRED;
+    packOption.numberHint = 1;
+    imagePacker.StartPacking(sourceFile, packOption);
+    imagePacker.AddImage(*source);
+    int64_t packedSize = 0;
+    imagePacker.FinalizePacking(packedSize);
+    ASSERT_GT(packedSize, 0);
+    std::string stagingPath;
+    ASSERT_TRUE(wallpaperService->StageTexture(sourceFile, "", stagingPath));
+    fd = open(stagingPath.c_str(), O_RDONLY);
+    ASSERT_GE(fd, 0);
+    textureInfo = WallpaperTextureInfo();
+    EXPECT_TRUE(wallpaperService->ReadTextureHeader(fd, textureInfo));
+    close(fd);
+    EXPECT_EQ(textureInfo.width, 256);
+    EXPECT_EQ(textureInfo.height, 128);
+    FileDeal::DeleteDir(dir);
+}
+
+/**
+ * @tc.name: WallpaperTest_Texture002
+ * @tc.desc: Without a texture sidecar the reply carries no fd and GetWallpaperTexture still succeeds
+ * @tc.type: FUNC
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_Texture002, TestSize.Level0)
+{
+    HILOG_INFO("WallpaperTest_Texture002 begin");
+    std::shared_ptr<WallpaperService> wallpaperService = std::make_shared<WallpaperService>();
+    MessageParcel data;
+    MessageParcel reply;
+    ASSERT_TRUE(data.WriteInterfaceToken(WallpaperServiceStub::GetDescriptor()));
+    data.WriteInt32(SYSTYEM);
+    data.WriteInt32(NORMAL);
+    data.WriteInt32(PORT);
+    EXPECT_EQ(wallpaperService->GetWallpaperTextureParcel(data, reply), E_OK);
+    EXPECT_EQ(reply.ReadInt32(), NO_ERROR);
+    // size, width, height, blockFormat and mipCount, the sidecar is off unless its parameter is set.
+    constexpr int32_t textureFieldCount = 5;
+    for (int32_t i = 0; i < textureFieldCount; i++) {
+        reply.ReadInt32();
+    }
+    EXPECT_FALSE(reply.ReadBool());
+    WallpaperTextureInfo textureInfo;
+    int32_t textureFd = -1;
+    ErrorCode wallpaperErrorCode =
+        WallpaperManager::GetInstance().GetWallpaperTexture(SYSTYEM, NORMAL, PORT, textureInfo, textureFd);
+    EXPECT_EQ(wallpaperErrorCode, E_OK);
+    EXPECT_EQ(textureFd, -1);
+    EXPECT_EQ(textureInfo.blockFormat, TEXTURE_FORMAT_NONE);
+}
+
+/**
+ * @tc.name: WallpaperTest_AllCorrespondWallpapers001
+ * @tc.desc: Every variant is returned with the fallback applied and variants of one file share its fd
+ * @tc.type: FUNC
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_AllCorrespondWallpapers001, TestSize.Level0)
+{
+    HILOG_INFO("WallpaperTest_AllCorrespondWallpapers001 begin");
+    std::string dir = "/data/test/theme/wallpaper/variants";
+    ASSERT_TRUE(FileDeal::Mkdir(dir));
+    WallpaperData wallpaperData;
+    wallpaperData.wallpaperId = 1;
+    wallpaperData.wallpaperFile = dir + "/wallpaper_home.1";
+    wallpaperData.unfoldedOnePortFile = dir + "/unfold1_port_wallpaper_home.1";
+    ASSERT_TRUE(FileDeal::WriteFile(wallpaperData.wallpaperFile, "normal", DurabilityMode::NONE));
+    ASSERT_TRUE(FileDeal::WriteFile(wallpaperData.unfoldedOnePortFile, "unfolded", DurabilityMode::NONE));
+    std::shared_ptr<WallpaperService> wallpaperService = std::make_shared<WallpaperService>();
+    std::vector<int32_t> variantInfos;
+    std::vector<std::unique_ptr<WallpaperHandle>> handles;
+    EXPECT_EQ(wallpaperService->OpenWallpaperVariants(wallpaperData, variantInfos, handles), NO_ERROR);
+    ASSERT_EQ(handles.size(), 2U);
+    ASSERT_EQ(variantInfos.size(), 6U * VARIANT_INFO_FIELDS);
+    for (size_t i = 0; i < variantInfos.size(); i += VARIANT_INFO_FIELDS) {
+        bool unfolded = variantInfos[i + VARIANT_FOLD_STATE] == static_cast<int32_t>(FoldState::UNFOLD_1);
+        EXPECT_EQ(variantInfos[i + VARIANT_FD_INDEX], unfolded ? 1 : 0);
+        EXPECT_EQ(variantInfos[i + VARIANT_SIZE], unfolded ? 8 : 6);
+        EXPECT_EQ(variantInfos[i + VARIANT_WALLPAPER_ID], 1);
+    }
+    handles.clear();
+    FileDeal::DeleteFile(wallpaperData.unfoldedOnePortFile);
+    variantInfos.clear();
+    EXPECT_EQ(wallpaperService->OpenWallpaperVariants(wallpaperData, variantInfos, handles), E_NOT_FOUND);
+    FileDeal::DeleteDir(dir);
+}
+
+/**
+ * @tc.name: WallpaperTest_Region001
+ * @tc.desc: A region decode crops and subsamples the rectangle and rejects regions outside the picture
+ * @tc.type: FUNC
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_Region001, TestSize.Level0)
+{
+    HILOG_INFO("WallpaperTest_Region001 begin");
+    std::string file = "/data/test/theme/wallpaper/region.jpg";
+    InitializationOptions sourceOpts = { { 2048, 1024 }, OHOS::Media::PixelFormat::RGBA_8888 };
+    std::unique_ptr<PixelMap> source = PixelMap::Create(sourceOpts);
+    ASSERT_NE(source, nullptr);
+    ImagePacker imagePacker;
+    PackOption packOption;
+    packOption.format = "image/jpeg";
+    packOption.quality = HUNDRED;
+    packOption.numberHint = 1;
+    imagePacker.StartPacking(file, packOption);
+    imagePacker.AddImage(*source);
+    int64_t packedSize = 0;
+    imagePacker.FinalizePacking(packedSize);
+    ASSERT_GT(packedSize, 0);
+    WallpaperRegion region = { 100, 50, 400, 200 };
+    int32_t fd = open(file.c_str(), O_RDONLY);
+    ASSERT_GE(fd, 0);
+    std::shared_ptr<PixelMap> pixelMap;
+    ErrorCode ret = WallpaperManager::GetInstance().CreateRegionPixelMapByFd(
+        fd, static_cast<int32_t>(packedSize), region, 2, pixelMap);
+    ASSERT_EQ(ret, E_OK);
+    ASSERT_NE(pixelMap, nullptr);
+    EXPECT_EQ(pixelMap->GetWidth(), 200);
+    EXPECT_EQ(pixelMap->GetHeight(), 100);
+    region = { 2000, 0, 100, 100 };
+    fd = open(file.c_str(), O_RDONLY);
+    ASSERT_GE(fd, 0);
+    ret = WallpaperManager::GetInstance().CreateRegionPixelMapByFd(
+        fd, static_cast<int32_t>(packedSize), region, 1, pixelMap);
+    EXPECT_EQ(ret, E_PARAMETERS_INVALID);
+    region = { 0, 0, 0, 100 };
+    ret = WallpaperManager::GetInstance().GetWallpaperRegion(WALLPAPER_SYSTEM, region, 1, pixelMap);
+    EXPECT_EQ(ret, E_PARAMETERS_INVALID);
+    FileDeal::DeleteFile(file);
+}
+
+/**
+ * @tc.name: WallpaperTest_Palette001
+ * @tc.desc: The palette engine orders dominant colors by population and a palette of a replaced picture is dropped
+ * @tc.type: FUNC
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_Palette001, TestSize.Level0)
+{
+    HILOG_INFO("WallpaperTest_Palette001 begin");
+    constexpr int32_t width = 64;
+    constexpr int32_t height = 32;
+    constexpr int32_t rowStride = width * 4;
+    std::vector<uint8_t> pixels(rowStride * height);
+    for (int32_t y = 0; y < height; y++) {
+        for (int32_t x = 0; x < width; x++) {
+            uint8_t *pixel = &pixels[y * rowStride + x * 4];
+            bool red = x < width * 3 / 4;
+            pixel[0] = red ? 230 : 30;
+            pixel[1] = 40;
+            pixel[2] = red ? 40 : 90;
+            pixel[3] = 255;
+        }
+    }
+    PaletteResult result;
+    ASSERT_TRUE(WallpaperPaletteEngine::Extract(pixels.data(), width, height, rowStride, 16, result));
+    ASSERT_EQ(result.dominantColors.size(), 2U);
+    EXPECT_GT(result.dominantColors[0].red, result.dominantColors[1].red);
+    EXPECT_EQ(result.dominantColors[0].population, static_cast<uint32_t>(width * height * 3 / 4));
+    EXPECT_GT(result.swatches[SWATCH_VIBRANT].population, 0U);
+    EXPECT_GT(result.swatches[SWATCH_DARK_VIBRANT].population, 0U);
+    std::vector<uint8_t> transparent(rowStride * height, 0);
+    EXPECT_FALSE(WallpaperPaletteEngine::Extract(transparent.data(), width, height, rowStride, 16, result));
+
+    std::shared_ptr<WallpaperService> wallpaperService = std::make_shared<WallpaperService>();
+    uint64_t packed = WallpaperService::PackColor(0xffe62828);
+    EXPECT_EQ(WallpaperService::UnpackColor(packed), 0xffe62828);
+    EXPECT_EQ(WallpaperService::PackColor(0), 0U);
+    WallpaperData wallpaperData;
+    wallpaperData.wallpaperId = 7;
+    wallpaperData.wallpaperFile = "/data/test/theme/wallpaper/wallpaper_home.7";
+    wallpaperService->systemWallpaperMap_.InsertOrAssign(DEFAULT_USERID, wallpaperData);
+    WallpaperPalette palette;
+    palette.dominantColors.push_back(packed);
+    palette.swatches.assign(SWATCH_COUNT, 0);
+    palette.extracted = true;
+    EXPECT_FALSE(wallpaperService->CommitColors(DEFAULT_USERID, WALLPAPER_SYSTEM, 6, 1, packed, palette));
+    EXPECT_TRUE(wallpaperService->CommitColors(DEFAULT_USERID, WALLPAPER_SYSTEM, 7, 1, packed, palette));
+    // Colors extracted from other content than the committed one are dropped as well.
+    EXPECT_FALSE(wallpaperService->CommitColors(DEFAULT_USERID, WALLPAPER_SYSTEM, 7, 2, packed, palette));
+    auto iterator = wallpaperService->systemWallpaperMap_.Find(DEFAULT_USERID);
+    ASSERT_TRUE(iterator.first);
+    ASSERT_EQ(iterator.second.palette.dominantColors.size(), 1U);
+    EXPECT_EQ(iterator.second.palette.dominantColors[0], packed);
+    EXPECT_TRUE(iterator.second.palette.extracted);
+    EXPECT_EQ(iterator.second.fileDigests[wallpaperData.wallpaperFile], 1U);
+}
+
+/**
+ * @tc.name: WallpaperTest_ColorCache001
+ * @tc.desc: Persisted colors are reloaded for the same picture content and served by SaveColor without a decode
+ * @tc.type: FUNC
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_ColorCache001, TestSize.Level0)
+{
+    HILOG_INFO("WallpaperTest_ColorCache001 begin");
+    constexpr int32_t userId = 10099;
+    std::string userDir = "/data/service/el1/public/wallpaper/" + std::to_string(userId);
+    ASSERT_TRUE(FileDeal::Mkdir(userDir));
+    std::shared_ptr<WallpaperService> wallpaperService = std::make_shared<WallpaperService>();
+    wallpaperService->wallpaperTmpFullPath_ = userDir + "/fwsettmp";
+    // Two default pictures share DEFAULT_WALLPAPER_ID, only their content tells them apart.
+    std::string pictureFile = userDir + "/default_home";
+    std::string otherPictureFile = userDir + "/default_home_other";
+    std::ofstream(pictureFile) << "picture";
+    std::ofstream(otherPictureFile) << "other picture";
+    uint64_t sourceDigest = 0;
+    ASSERT_TRUE(ContentDigest::DigestFile(pictureFile, sourceDigest));
+    WallpaperData wallpaperData;
+    wallpaperData.wallpaperId = DEFAULT_WALLPAPER_ID;
+    wallpaperData.wallpaperFile = pictureFile;
+    wallpaperService->systemWallpaperMap_.InsertOrAssign(userId, wallpaperData);
+    uint64_t mainColor = WallpaperService::PackColor(0xffe62828);
+    WallpaperPalette palette;
+    palette.dominantColors.push_back(WallpaperService::PackColor(0xff1e285a));
+    palette.swatches.assign(SWATCH_COUNT, 0);
+    palette.swatches[SWATCH_DARK_VIBRANT] = palette.dominantColors[0];
+    palette.extracted = true;
+    ASSERT_TRUE(wallpaperService->CommitColors(
+        userId, WALLPAPER_SYSTEM, DEFAULT_WALLPAPER_ID, sourceDigest, mainColor, palette));
+    ASSERT_TRUE(wallpaperService->SaveWallpaperColors(userId));
+
+    WallpaperData loaded;
+    loaded.wallpaperId = DEFAULT_WALLPAPER_ID;
+    loaded.wallpaperFile = pictureFile;
+    wallpaperService->LoadWallpaperColors(userId, WALLPAPER_SYSTEM, loaded);
+    EXPECT_EQ(loaded.mainColor, mainColor);
+    EXPECT_TRUE(loaded.palette.extracted);
+    ASSERT_EQ(loaded.palette.swatches.size(), static_cast<size_t>(SWATCH_COUNT));
+    EXPECT_EQ(loaded.palette.swatches[SWATCH_DARK_VIBRANT], palette.dominantColors[0]);
+    EXPECT_EQ(loaded.palette.swatches[SWATCH_VIBRANT], 0U);
+    loaded.wallpaperFile = otherPictureFile;
+    wallpaperService->LoadWallpaperColors(userId, WALLPAPER_SYSTEM, loaded);
+    EXPECT_EQ(loaded.mainColor, 0U);
+    EXPECT_FALSE(loaded.palette.extracted);
+    loaded.wallpaperFile = pictureFile;
+    wallpaperService->LoadWallpaperColors(userId, WALLPAPER_LOCKSCREEN, loaded);
+    EXPECT_EQ(loaded.mainColor, 0U);
+    // The picture is no image, so only the stored colors can make SaveColor succeed.
+    EXPECT_TRUE(wallpaperService->SaveColor(userId, WALLPAPER_SYSTEM));
+    // A main color without an extracted palette is persisted as such and decoded again instead of being served.
+    ASSERT_TRUE(wallpaperService->CommitColors(
+        userId, WALLPAPER_SYSTEM, DEFAULT_WALLPAPER_ID, sourceDigest, mainColor, WallpaperPalette()));
+    ASSERT_TRUE(wallpaperService->SaveWallpaperColors(userId));
+    wallpaperService->LoadWallpaperColors(userId, WALLPAPER_SYSTEM, loaded);
+    EXPECT_EQ(loaded.mainColor, mainColor);
+    EXPECT_FALSE(loaded.palette.extracted);
+    EXPECT_FALSE(wallpaperService->SaveColor(userId, WALLPAPER_SYSTEM));
+
+    std::ofstream file(userDir + "/wallpapercolors", std::ios::trunc);
+    file << "{\"SystemColors\":{\"sourceDigest\":\"" << sourceDigest << "\",\"paletteExtracted\":true,"
+         << "\"mainColor\":1e20,\"dominantColors\":[],\"swatches\":[0,0,0,0,0,0]}}";
+    file.close();
+    wallpaperService->LoadWallpaperColors(userId, WALLPAPER_SYSTEM, loaded);
+    EXPECT_EQ(loaded.mainColor, 0U);
+    EXPECT_TRUE(loaded.palette.swatches.empty());
+    FileDeal::DeleteDir(userDir);
+}
+
+/**
+ * @tc.name: WallpaperTest_SaveColorTask001
+ * @tc.desc: A picture set returns before serviceHandler_ extracted its colors
+ * @tc.type: FUNC
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_SaveColorTask001, TestSize.Level1)
+{
+    HILOG_INFO("WallpaperTest_SaveColorTask001 begin");
+    std::shared_ptr<WallpaperService> wallpaperService = std::make_shared<WallpaperService>();
+    wallpaperService->InitServiceHandler();
+    auto handler = WallpaperService::serviceHandler_;
+    ASSERT_NE(handler, nullptr);
+    std::string stagingFile = "/data/test/theme/wallpaper/save_color_task.jpg";
+    ASSERT_TRUE(FileDeal::CopyFile(URI, stagingFile));
+    // Keep the serial handler busy so the color task can only run once the set returned.
+    std::promise<void> blocked;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    ASSERT_TRUE(handler->PostTask([&blocked, released]() {
+        blocked.set_value();
+        released.wait();
+    }));
+    blocked.get_future().wait();
+    EXPECT_EQ(wallpaperService->SetWallpaperBackupData(TEST_USERID1, PICTURE, stagingFile, WALLPAPER_SYSTEM, "", {}),
+        NO_ERROR);
+    WallpaperData wallpaperData;
+    ASSERT_TRUE(wallpaperService->FindWallpaperData(TEST_USERID1, WALLPAPER_SYSTEM, wallpaperData));
+    EXPECT_EQ(wallpaperData.mainColor, 0U);
+    release.set_value();
+    std::promise<void> drained;
+    ASSERT_TRUE(handler->PostTask([&drained]() { drained.set_value(); }));
+    drained.get_future().wait();
+    ASSERT_TRUE(wallpaperService->FindWallpaperData(TEST_USERID1, WALLPAPER_SYSTEM, wallpaperData));
+    EXPECT_NE(wallpaperData.mainColor, 0U);
+    wallpaperService->OnRemovedUser(TEST_USERID1);
+}
+
+/**
+ * @tc.name: WallpaperTest_SetTicket001
+ * @tc.desc: A set is superseded only by a later set of the same user and wallpaper type
+ * @tc.type: FUNC
+ */
+HWTEST_F(WallpaperTest, WallpaperTest_SetTicket001, TestSize.Level0)
+{
+    HILOG_INFO("WallpaperTest_SetTicket001 begin");
+    std::shared_ptr<WallpaperService> wallpaperService = std::make_shared<WallpaperService>();
+    uint64_t older = wallpaperService->IssueSetTicket(DEFAULT_USERID, WALLPAPER_SYSTEM);
+    EXPECT_FALSE(wallpaperService->IsSetSuperseded(DEFAULT_USERID, WALLPAPER_SYSTEM, older));
+    uint64_t lockScreen = wallpaperService->IssueSetTicket(DEFAULT_USERID, WALLPAPER_LOCKSCREEN);
+    EXPECT_FALSE(wallpaperService->IsSetSuperseded(DEFAULT_USERID, WALLPAPER_SYSTEM, older));
+    uint64_t newer = wallpaperService->IssueSetTicket(DEFAULT_USERID, WALLPAPER_SYSTEM);
+    EXPECT_TRUE(wallpaperService->IsSetSuperseded(DEFAULT_USERID, WALLPAPER_SYSTEM, older));
+    EXPECT_FALSE(wallpaperService->IsSetSuperseded(DEFAULT_USERID, WALLPAPER_SYSTEM, newer));
+    EXPECT_FALSE(wallpaperService->IsSetSuperseded(DEFAULT_USERID, WALLPAPER_LOCKSCREEN, lockScreen));
+    wallpaperService->RemoveWallpaperLocks(DEFAULT_USERID);
+    EXPECT_TRUE(wallpaperService->IsSetSuperseded(DEFAULT_USERID, WALLPAPER_SYSTEM, older));
+}
 /*********************   Wallpaper_service   *********************/
 } // namespace WallpaperMgrService
 } // namespace OHOS
\ No newline at end of file
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2025 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WALLPAPER_SERVICES_CONTENT_DIGEST_H
+#define WALLPAPER_SERVICES_CONTENT_DIGEST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace OHOS {
+namespace WallpaperMgrService {
+/**
+ * Streaming 64-bit xxHash (XXH64) of a payload, used to recognize a wallpaper that is set again unchanged.
+ * Not a cryptographic hash.
+ */
+class ContentDigest {
+public:
+    explicit ContentDigest(uint64_t seed = 0);
+    ~ContentDigest() = default;
+    void Update(const void *data, size_t size);
+    uint64_t Final() const;
+    static bool DigestFd(int32_t fd, uint64_t &digest);
+    static bool DigestFile(const std::string &filePath, uint64_t &digest);
+
+private:
+    static constexpr size_t STRIPE_SIZE = 32;
+    void ConsumeStripe(const uint8_t *stripe);
+
+    uint64_t seed_;
+    uint64_t acc_[4];
+    uint8_t buffer_[STRIPE_SIZE];
+    size_t bufferSize_ = 0;
+    uint64_t totalSize_ = 0;
+};
+} // namespace WallpaperMgrService
+} // namespace OHOS
+#endif // WALLPAPER_SERVICES_CONTENT_DIGEST_H
@@ -16,11 +16,21 @@
 #ifndef WALLPAPER_SERVICES_FILE_DEAL_H
 #define WALLPAPER_SERVICES_FILE_DEAL_H
 
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
 namespace OHOS {
 namespace WallpaperMgrService {
+class ContentDigest;
+
+enum class DurabilityMode : int32_t {
+    NONE,         // left to the page cache
+    DATA_SYNC,    // fdatasync on the fd that wrote the file
+    BATCHED_SYNC, // deferred, one SyncFileSystem covers every file of the transaction at commit
+};
+
 class FileDeal {
 public:
     FileDeal();
@@ -30,15 +40,27 @@ public:
     static bool CopyFile(const std::string &sourceFile, const std::string &newFile);
     static bool DeleteFile(const std::string &sourceFile);
     static bool DeleteDir(const std::string &path, bool deleteRootDir = true);
+    static bool DeleteDirExcept(const std::string &path, const std::vector<std::string> &keepFiles);
+    static bool DeleteFilesWithPrefix(const std::string &path, const std::string &prefix);
+    static bool CommitFile(const std::string &stagingFile, const std::string &newFile, bool syncDir = true);
+    static bool ExchangeDir(const std::string &srcDir, const std::string &dstDir);
     static bool IsFileExist(const std::string &name);
     static std::string GetExtension(const std::string &filePath);
     static bool GetRealPath(const std::string &inOriPath, std::string &outRealPath);
     static bool IsZipFile(const std::string &filePath);
     static bool IsFileExistInDir(const std::string &path);
     static std::string ToBeAnonymous(const std::string &path);
+    static bool TransferFd(int32_t srcFd, int32_t dstFd, int64_t length);
+    static bool TransferFd(int32_t srcFd, int32_t dstFd, int64_t length, ContentDigest &digest);
+    static bool WriteFile(const std::string &filePath, const std::string &content, DurabilityMode mode);
+    static bool SyncFd(int32_t fd, DurabilityMode mode);
+    static bool SyncFileSystem(const std::string &path);
 
 private:
-    static bool ForcedRefreshDisk(const std::string &sourcePath);
+    static bool SyncParentDir(const std::string &filePath);
+    static bool CopyFileRange(int32_t srcFd, int32_t dstFd, int64_t length, int64_t &transferred);
+    static bool SendFile(int32_t srcFd, int32_t dstFd, int64_t length, int64_t &transferred);
+    static bool ChunkedCopy(int32_t srcFd, int32_t dstFd, int64_t length, int64_t &transferred);
 };
 } // namespace WallpaperMgrService
 } // namespace OHOS
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2025 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WALLPAPER_SERVICES_SHARED_PIXELS_H
+#define WALLPAPER_SERVICES_SHARED_PIXELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace OHOS {
+namespace WallpaperMgrService {
+struct SharedPixelsHeader {
+    uint32_t magic;
+    int32_t width;
+    int32_t height;
+    int32_t pixelFormat;
+    int32_t alphaType;
+    int32_t rowStride;
+    uint64_t pixelsSize;
+};
+
+/**
+ * Pixels handed from a client to the service in a sealed memfd: a SharedPixelsHeader followed by the rows.
+ * The client writes the pixels once, the service maps them read-only, so no copy goes through the IPC buffer.
+ */
+class SharedPixels {
+public:
+    static constexpr uint32_t MAGIC = 0x57505350; // "WPSP"
+    static constexpr uint64_t MAX_PIXELS_SIZE = 268435456;
+
+    SharedPixels() = default;
+    ~SharedPixels();
+    SharedPixels(const SharedPixels &) = delete;
+    SharedPixels &operator=(const SharedPixels &) = delete;
+
+    /**
+     * Creates a sealed memfd holding header and pixels, returns the fd or -1. The caller owns the fd.
+     */
+    static int32_t Create(const SharedPixelsHeader &header, const void *pixels);
+    /**
+     * Maps a memfd made by Create read-only after checking its seals and header. Does not take over fd.
+     */
+    bool Map(int32_t fd);
+    const SharedPixelsHeader &GetHeader() const;
+    const void *GetPixels() const;
+
+private:
+    static bool IsValidHeader(const SharedPixelsHeader &header, uint64_t fileSize);
+
+    void *address_ = nullptr;
+    size_t mappedSize_ = 0;
+    SharedPixelsHeader header_ = {};
+};
+} // namespace WallpaperMgrService
+} // namespace OHOS
+#endif // WALLPAPER_SERVICES_SHARED_PIXELS_H
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2025 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WALLPAPER_SERVICES_STREAM_WRITER_H
+#define WALLPAPER_SERVICES_STREAM_WRITER_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <streambuf>
+
+namespace OHOS {
+namespace WallpaperMgrService {
+class ContentDigest;
+
+enum class StreamStatus : int32_t {
+    OK,
+    NO_MEMORY,
+    READ_FAILED,
+    WRITE_FAILED,
+    OVERSIZED,
+    CANCELED,
+};
+
+/**
+ * Writes a payload of any size to a file descriptor through one fixed-size buffer, so the
+ * peak memory of an ingest does not depend on the payload size.
+ */
+class StreamWriter {
+public:
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 262144;
+    /**
+     * Called after every chunk reaches the destination fd with the total bytes written so far.
+     * Returning false cancels the transfer.
+     */
+    using ProgressCallback = std::function<bool(int64_t writtenSize)>;
+
+    explicit StreamWriter(int32_t fd, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+    ~StreamWriter() = default;
+    StreamWriter(const StreamWriter &) = delete;
+    StreamWriter &operator=(const StreamWriter &) = delete;
+
+    void SetProgressCallback(const ProgressCallback &callback);
+    void SetMaxSize(int64_t maxSize);
+    /**
+     * Every chunk is fed to digest before it is written, so the payload is hashed without being read back.
+     */
+    void SetDigest(ContentDigest *digest);
+    bool Append(const char *data, size_t size);
+    bool AppendFromFd(int32_t srcFd, int64_t length);
+    bool Flush();
+    int64_t GetTotalSize() const;
+    StreamStatus GetStatus() const;
+
+private:
+    bool Reserve();
+    bool Drain();
+    bool Fail(StreamStatus status);
+
+    int32_t fd_;
+    size_t bufferSize_;
+    std::unique_ptr<char[]> buffer_;
+    size_t used_ = 0;
+    int64_t totalSize_ = 0;
+    int64_t writtenSize_ = 0;
+    int64_t maxSize_ = INT64_MAX;
+    ProgressCallback callback_;
+    ContentDigest *digest_ = nullptr;
+    StreamStatus status_ = StreamStatus::OK;
+};
+
+/**
+ * std::streambuf over a StreamWriter, lets std::ostream based encoders write straight to the fd.
+ */
+class StreamWriterBuf : public std::streambuf {
+public:
+    explicit StreamWriterBuf(StreamWriter &writer);
+    ~StreamWriterBuf() override = default;
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char *data, std::streamsize count) override;
+    int sync() override;
+
+private:
+    StreamWriter &writer_;
+};
+} // namespace WallpaperMgrService
+} // namespace OHOS
+#endif // WALLPAPER_SERVICES_STREAM_WRITER_H
@@ -63,6 +63,7 @@ enum ErrorCode : int32_t {
     E_CHECK_DESCRIPTOR_ERROR,
     E_PICTURE_OVERSIZED,
     E_UNKNOWN,
+    E_SUPERSEDED, // the set was not applied, a newer set of the same user and wallpaper type was queued behind it
 };
 using JsCallbackOffset = bool (*)(int32_t, int32_t);
 
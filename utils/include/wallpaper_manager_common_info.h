@@ -16,7 +16,9 @@
 #ifndef INNERKITSIMPL_WALLPAPER_MANAGER_COMMON_INFO_H
 #define INNERKITSIMPL_WALLPAPER_MANAGER_COMMON_INFO_H
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 enum WallpaperType {
     /**
@@ -43,6 +45,26 @@ enum WallpaperResourceType {
     PACKAGE
 };
 
+enum WallpaperStorageFormat {
+    // follows the device profile, JPEG at full quality when none is configured.
+    STORAGE_DEFAULT,
+
+    // JPEG at full quality.
+    STORAGE_JPEG_BEST,
+
+    // JPEG at high quality.
+    STORAGE_JPEG_HIGH,
+
+    // JPEG at medium quality.
+    STORAGE_JPEG_MEDIUM,
+
+    // WebP, falls back to JPEG when the image framework has no WebP encoder.
+    STORAGE_WEBP,
+
+    // HEIF, falls back to JPEG when the image framework has no HEIF encoder.
+    STORAGE_HEIF
+};
+
 enum FoldState {
     NORMAL,
     UNFOLD_1,
@@ -59,4 +81,78 @@ struct WallpaperInfo {
     RotateState rotateState;
     std::string source;
 };
+
+enum DecodeFitMode {
+    // scales to exactly the desired size.
+    FIT_FILL,
+
+    // keeps the aspect ratio and fits inside the desired size, never upscales.
+    FIT_CONTAIN,
+
+    // keeps the aspect ratio, crops the centre to the desired aspect and scales it down to the desired size.
+    FIT_COVER
+};
+
+struct WallpaperDecodeOptions {
+    // 0 in both keeps the stored size, 0 in one of them follows the aspect ratio of the image.
+    int32_t desiredWidth = 0;
+    int32_t desiredHeight = 0;
+
+    // OHOS::Media::PixelFormat value, 0 (UNKNOWN) keeps the format the decoder picks.
+    int32_t pixelFormat = 0;
+    int32_t fitMode = FIT_CONTAIN;
+};
+
+enum TextureBlockFormat {
+    // no texture sidecar was generated for the wallpaper.
+    TEXTURE_FORMAT_NONE,
+
+    // ASTC with 4x4 blocks, 8 bits per pixel.
+    TEXTURE_FORMAT_ASTC_4X4
+};
+
+struct WallpaperRegion {
+    int32_t x = 0;
+    int32_t y = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+};
+
+// Fields of one entry in the flattened variant list of GetAllCorrespondWallpapers, entries sharing an fd index alias.
+enum VariantInfoField {
+    VARIANT_FOLD_STATE,
+    VARIANT_ROTATE_STATE,
+    VARIANT_SIZE,
+    VARIANT_WALLPAPER_ID,
+    VARIANT_FD_INDEX,
+    VARIANT_INFO_FIELDS
+};
+
+struct WallpaperTextureInfo {
+    int32_t width = 0;
+    int32_t height = 0;
+    int32_t blockFormat = TEXTURE_FORMAT_NONE;
+    int32_t mipCount = 0;
+};
+
+enum PaletteSwatch {
+    SWATCH_VIBRANT,
+    SWATCH_LIGHT_VIBRANT,
+    SWATCH_DARK_VIBRANT,
+    SWATCH_MUTED,
+    SWATCH_LIGHT_MUTED,
+    SWATCH_DARK_MUTED,
+    SWATCH_COUNT
+};
+
+struct WallpaperPalette {
+    // packed ColorManager::Color values, most populated first.
+    std::vector<uint64_t> dominantColors;
+
+    // indexed by PaletteSwatch, 0 when the picture has no color for the swatch.
+    std::vector<uint64_t> swatches;
+
+    // true once the palette of the picture was extracted, the colors above are only meaningful then.
+    bool extracted = false;
+};
 #endif
\ No newline at end of file
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2025 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+#include "content_digest.h"
+#include "hilog_wrapper.h"
+
+namespace OHOS {
+namespace WallpaperMgrService {
+namespace {
+constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+constexpr size_t DIGEST_READ_SIZE = 262144;
+
+inline uint64_t RotateLeft(uint64_t value, int32_t bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t Read64(const uint8_t *data)
+{
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline uint32_t Read32(const uint8_t *data)
+{
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline uint64_t Round(uint64_t acc, uint64_t input)
+{
+    acc += input * PRIME2;
+    acc = RotateLeft(acc, 31);
+    return acc * PRIME1;
+}
+
+inline uint64_t MergeRound(uint64_t acc, uint64_t value)
+{
+    acc ^= Round(0, value);
+    return acc * PRIME1 + PRIME4;
+}
+} // namespace
+
+ContentDigest::ContentDigest(uint64_t seed) : seed_(seed)
+{
+    acc_[0] = seed + PRIME1 + PRIME2;
+    acc_[1] = seed + PRIME2;
+    acc_[2] = seed;
+    acc_[3] = seed - PRIME1;
+}
+
+void ContentDigest::ConsumeStripe(const uint8_t *stripe)
+{
+    for (size_t i = 0; i < sizeof(acc_) / sizeof(acc_[0]); i++) {
+        acc_[i] = Round(acc_[i], Read64(stripe + i * sizeof(uint64_t)));
+    }
+}
+
+void ContentDigest::Update(const void *data, size_t size)
+{
+    const uint8_t *input = static_cast<const uint8_t *>(data);
+    totalSize_ += size;
+    if (bufferSize_ > 0) {
+        size_t fill = std::min(size, STRIPE_SIZE - bufferSize_);
+        memcpy(buffer_ + bufferSize_, input, fill);
+        bufferSize_ += fill;
+        input += fill;
+        size -= fill;
+        if (bufferSize_ < STRIPE_SIZE) {
+            return;
+        }
+        ConsumeStripe(buffer_);
+        bufferSize_ = 0;
+    }
+    while (size >= STRIPE_SIZE) {
+        ConsumeStripe(input);
+        input += STRIPE_SIZE;
+        size -= STRIPE_SIZE;
+    }
+    if (size > 0) {
+        memcpy(buffer_, input, size);
+        bufferSize_ = size;
+    }
+}
+
+uint64_t ContentDigest::Final() const
+{
+    uint64_t hash;
+    if (totalSize_ >= STRIPE_SIZE) {
+        hash = RotateLeft(acc_[0], 1) + RotateLeft(acc_[1], 7) + RotateLeft(acc_[2], 12) + RotateLeft(acc_[3], 18);
+        for (uint64_t acc : acc_) {
+            hash = MergeRound(hash, acc);
+        }
+    } else {
+        hash = seed_ + PRIME5;
+    }
+    hash += totalSize_;
+    const uint8_t *tail = buffer_;
+    const uint8_t *end = buffer_ + bufferSize_;
+    for (; tail + sizeof(uint64_t) <= end; tail += sizeof(uint64_t)) {
+        hash ^= Round(0, Read64(tail));
+        hash = RotateLeft(hash, 27) * PRIME1 + PRIME4;
+    }
+    if (tail + sizeof(uint32_t) <= end) {
+        hash ^= static_cast<uint64_t>(Read32(tail)) * PRIME1;
+        hash = RotateLeft(hash, 23) * PRIME2 + PRIME3;
+        tail += sizeof(uint32_t);
+    }
+    for (; tail < end; tail++) {
+        hash ^= (*tail) * PRIME5;
+        hash = RotateLeft(hash, 11) * PRIME1;
+    }
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+bool ContentDigest::DigestFd(int32_t fd, uint64_t &digest)
+{
+    std::unique_ptr<uint8_t[]> buffer(new (std::nothrow) uint8_t[DIGEST_READ_SIZE]);
+    if (buffer == nullptr) {
+        HILOG_ERROR("Alloc digest buffer failed!");
+        return false;
+    }
+    ContentDigest contentDigest;
+    while (true) {
+        ssize_t readSize = read(fd, buffer.get(), DIGEST_READ_SIZE);
+        if (readSize < 0 && errno == EINTR) {
+            continue;
+        }
+        if (readSize < 0) {
+            HILOG_ERROR("Read digest fd failed, errno=%{public}d", errno);
+            return false;
+        }
+        if (readSize == 0) {
+            break;
+        }
+        contentDigest.Update(buffer.get(), static_cast<size_t>(readSize));
+    }
+    digest = contentDigest.Final();
+    return true;
+}
+
+bool ContentDigest::DigestFile(const std::string &filePath, uint64_t &digest)
+{
+    int32_t fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        HILOG_ERROR("Open digest file failed, errno=%{public}d", errno);
+        return false;
+    }
+    bool ret = DigestFd(fd, digest);
+    close(fd);
+    return ret;
+}
+} // namespace WallpaperMgrService
+} // namespace OHOS
@@ -14,18 +14,23 @@
  */
 #include <dirent.h>
 #include <fcntl.h>
+#include <sys/sendfile.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
 #include <algorithm>
 #include <cstdio>
 #include <filesystem>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include "content_digest.h"
 #include "file_deal.h"
 #include "hilog_wrapper.h"
+#include "stream_writer.h"
 
 namespace fs = std::filesystem;
 namespace OHOS {
@@ -34,6 +39,9 @@ constexpr const mode_t MODE = 0740;
 constexpr const int32_t SLICE_SIZE = 2;
 constexpr const int32_t PATH_SIZE_MIX = 4;
 constexpr const char *DEFAULT_ANONYMOUS = "***";
+constexpr const char *COMMIT_STAGING_SUFFIX = ".staging";
+constexpr const uint32_t RENAME_EXCHANGE_FLAG = 1 << 1; // RENAME_EXCHANGE of renameat2
+constexpr const int64_t TRANSFER_MAX_STEP = 0x7ffff000; // kernel limit of a single copy_file_range/sendfile call
 FileDeal::FileDeal(void)
 {
 }
@@ -64,17 +72,33 @@ bool FileDeal::Mkdir(const std::string &path)
 
 bool FileDeal::CopyFile(const std::string &sourceFile, const std::string &newFile)
 {
-    std::filesystem::path dstPath(newFile);
-    std::filesystem::path srcPath(sourceFile);
-    std::error_code errCode;
-    if (!std::filesystem::copy_file(srcPath, dstPath, std::filesystem::copy_options::overwrite_existing, errCode)) {
-        HILOG_ERROR("Failed to copy file, error code: %{public}d", errCode.value());
+    int srcFd = open(sourceFile.c_str(), O_RDONLY);
+    if (srcFd < 0) {
+        HILOG_ERROR("open source file failed, errInfo=%{public}s", strerror(errno));
         return false;
     }
-    if (!ForcedRefreshDisk(newFile)) {
-        HILOG_WARN("ForcedRefreshDisk failed!");
+    struct stat srcStat = {};
+    if (fstat(srcFd, &srcStat) != 0) {
+        HILOG_ERROR("fstat source file failed, errInfo=%{public}s", strerror(errno));
+        close(srcFd);
+        return false;
     }
-    return true;
+    int dstFd = open(newFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, srcStat.st_mode & ACCESSPERMS);
+    if (dstFd < 0) {
+        HILOG_ERROR("open new file failed, errInfo=%{public}s", strerror(errno));
+        close(srcFd);
+        return false;
+    }
+    // The copy is synced through the fd that wrote it, there is no need to reopen the file.
+    bool result = (srcStat.st_size == 0 || TransferFd(srcFd, dstFd, srcStat.st_size))
+                  && SyncFd(dstFd, DurabilityMode::DATA_SYNC);
+    close(srcFd);
+    close(dstFd);
+    if (!result) {
+        HILOG_ERROR("Failed to copy file.");
+        DeleteFile(newFile);
+    }
+    return result;
 }
 
 bool FileDeal::DeleteFile(const std::string &sourceFile)
@@ -125,6 +149,188 @@ bool FileDeal::DeleteDir(const std::string &path, bool deleteRootDir)
     return true;
 }
 
+bool FileDeal::DeleteDirExcept(const std::string &path, const std::vector<std::string> &keepFiles)
+{
+    DIR *dir = opendir(path.c_str());
+    if (dir == nullptr) {
+        return false;
+    }
+    bool result = true;
+    dirent *dirent;
+    while ((dirent = readdir(dir)) != nullptr) {
+        if (strcmp(dirent->d_name, ".") == 0 || strcmp(dirent->d_name, "..") == 0) {
+            continue;
+        }
+        std::string fullPath = path;
+        if (path[path.size() - 1] != '/') {
+            fullPath += '/';
+        }
+        fullPath += dirent->d_name;
+        if (std::find(keepFiles.begin(), keepFiles.end(), fullPath) != keepFiles.end()) {
+            continue;
+        }
+        if (dirent->d_type == DT_DIR) {
+            result = DeleteDir(fullPath) && result;
+        } else if (remove(fullPath.c_str()) < 0) {
+            HILOG_ERROR("remove failed, fullPath=%{public}s, errInfo=%{public}s", ToBeAnonymous(fullPath).c_str(),
+                strerror(errno));
+            result = false;
+        }
+    }
+    closedir(dir);
+    return result;
+}
+
+bool FileDeal::DeleteFilesWithPrefix(const std::string &path, const std::string &prefix)
+{
+    DIR *dir = opendir(path.c_str());
+    if (dir == nullptr) {
+        return false;
+    }
+    bool result = true;
+    dirent *dirent;
+    while ((dirent = readdir(dir)) != nullptr) {
+        if (dirent->d_type == DT_DIR || strncmp(dirent->d_name, prefix.c_str(), prefix.size()) != 0) {
+            continue;
+        }
+        std::string fullPath = path;
+        if (path[path.size() - 1] != '/') {
+            fullPath += '/';
+        }
+        fullPath += dirent->d_name;
+        if (remove(fullPath.c_str()) < 0) {
+            HILOG_ERROR("remove failed, fullPath=%{public}s, errInfo=%{public}s", ToBeAnonymous(fullPath).c_str(),
+                strerror(errno));
+            result = false;
+        }
+    }
+    closedir(dir);
+    return result;
+}
+
+bool FileDeal::CommitFile(const std::string &stagingFile, const std::string &newFile, bool syncDir)
+{
+    // The staging file is made durable by its writer, according to the writer's DurabilityMode.
+    if (rename(stagingFile.c_str(), newFile.c_str()) != 0) {
+        if (errno != EXDEV) {
+            HILOG_ERROR("rename failed, errInfo=%{public}s", strerror(errno));
+            return false;
+        }
+        // Staging file lives on another filesystem: copy it next to the destination first so that
+        // publishing is still a single rename within the destination directory.
+        std::string localStaging = newFile + COMMIT_STAGING_SUFFIX;
+        if (!CopyFile(stagingFile, localStaging)) {
+            HILOG_ERROR("Failed to stage file.");
+            return false;
+        }
+        if (rename(localStaging.c_str(), newFile.c_str()) != 0) {
+            HILOG_ERROR("rename staging file failed, errInfo=%{public}s", strerror(errno));
+            DeleteFile(localStaging);
+            return false;
+        }
+        DeleteFile(stagingFile);
+    }
+    if (syncDir && !SyncParentDir(newFile)) {
+        HILOG_WARN("SyncParentDir failed!");
+    }
+    return true;
+}
+
+bool FileDeal::ExchangeDir(const std::string &srcDir, const std::string &dstDir)
+{
+    if (!IsDirExist(dstDir)) {
+        if (rename(srcDir.c_str(), dstDir.c_str()) != 0) {
+            HILOG_ERROR("rename dir failed, errInfo=%{public}s", strerror(errno));
+            return false;
+        }
+    } else {
+#ifdef SYS_renameat2
+        if (syscall(SYS_renameat2, AT_FDCWD, srcDir.c_str(), AT_FDCWD, dstDir.c_str(), RENAME_EXCHANGE_FLAG) != 0) {
+            HILOG_ERROR("exchange dir failed, errInfo=%{public}s", strerror(errno));
+            return false;
+        }
+#else
+        HILOG_ERROR("renameat2 is not supported.");
+        return false;
+#endif
+    }
+    if (!SyncParentDir(dstDir)) {
+        HILOG_WARN("SyncParentDir failed!");
+    }
+    return true;
+}
+
+bool FileDeal::WriteFile(const std::string &filePath, const std::string &content, DurabilityMode mode)
+{
+    int fd = open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        HILOG_ERROR("open file failed, errInfo=%{public}s", strerror(errno));
+        return false;
+    }
+    size_t written = 0;
+    while (written < content.size()) {
+        ssize_t ret = write(fd, content.data() + written, content.size() - written);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            HILOG_ERROR("write file failed, errno=%{public}d", errno);
+            close(fd);
+            return false;
+        }
+        written += static_cast<size_t>(ret);
+    }
+    bool result = SyncFd(fd, mode);
+    close(fd);
+    return result;
+}
+
+bool FileDeal::SyncFd(int32_t fd, DurabilityMode mode)
+{
+    if (mode != DurabilityMode::DATA_SYNC) {
+        return true;
+    }
+    if (fdatasync(fd) != 0) {
+        HILOG_ERROR("fdatasync file failed, errno=%{public}d", errno);
+        return false;
+    }
+    return true;
+}
+
+bool FileDeal::SyncFileSystem(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        HILOG_ERROR("open dir failed, errInfo=%{public}s", strerror(errno));
+        return false;
+    }
+    if (syncfs(fd) != 0) {
+        HILOG_ERROR("syncfs failed, errno=%{public}d", errno);
+        close(fd);
+        return false;
+    }
+    close(fd);
+    return true;
+}
+
+bool FileDeal::SyncParentDir(const std::string &filePath)
+{
+    std::string::size_type pos = filePath.find_last_of('/');
+    std::string dirPath = (pos == std::string::npos) ? "." : filePath.substr(0, pos == 0 ? 1 : pos);
+    int fd = open(dirPath.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        HILOG_ERROR("open dir failed, errInfo=%{public}s", strerror(errno));
+        return false;
+    }
+    if (fsync(fd) != 0) {
+        HILOG_ERROR("fsync dir failed, errno=%{public}d", errno);
+        close(fd);
+        return false;
+    }
+    close(fd);
+    return true;
+}
+
 bool FileDeal::IsFileExist(const std::string &name)
 {
     if (access(name.c_str(), F_OK) != 0) {
@@ -182,31 +388,6 @@ bool FileDeal::IsZipFile(const std::string &filePath)
     HILOG_ERROR("this is not a zip.filePath:%{private}s", filePath.c_str());
     return false;
 }
-bool FileDeal::ForcedRefreshDisk(const std::string &sourcePath)
-{
-    std::string fileRealPath;
-    if (!GetRealPath(sourcePath, fileRealPath)) {
-        HILOG_ERROR("get real path file failed!");
-        return false;
-    }
-    FILE *file = std::fopen(fileRealPath.c_str(), "rb");
-    if (file == nullptr) {
-        HILOG_ERROR("Fopen failed, %{public}s, %{public}s", fileRealPath.c_str(), strerror(errno));
-        return false;
-    }
-    if (fflush(file) != 0) {
-        HILOG_ERROR("fflush file failed, errno=%{public}d", errno);
-        fclose(file);
-        return false;
-    }
-    if (fsync(fileno(file)) != 0) {
-        HILOG_ERROR("fsync file failed, errno=%{public}d", errno);
-        fclose(file);
-        return false;
-    }
-    (void)fclose(file);
-    return true;
-}
 bool FileDeal::IsFileExistInDir(const std::string &path)
 {
     DIR *dp = opendir(path.c_str());
@@ -250,5 +431,94 @@ std::string FileDeal::ToBeAnonymous(const std::string &path)
     return pathVector[0] + "/" + pathVector[1] + "/" + DEFAULT_ANONYMOUS + "/"
            + pathVector[pathVector.size() - SLICE_SIZE] + "/" + pathVector.back();
 }
+
+bool FileDeal::TransferFd(int32_t srcFd, int32_t dstFd, int64_t length)
+{
+    if (srcFd < 0 || dstFd < 0 || length <= 0) {
+        HILOG_ERROR("Invalid transfer param, length=%{public}lld", static_cast<long long>(length));
+        return false;
+    }
+    // Each stage continues from the offsets left by the previous one, so a partial in-kernel copy is
+    // completed by the next stage instead of being restarted.
+    int64_t transferred = 0;
+    if (CopyFileRange(srcFd, dstFd, length, transferred)) {
+        return true;
+    }
+    if (SendFile(srcFd, dstFd, length, transferred)) {
+        return true;
+    }
+    if (ChunkedCopy(srcFd, dstFd, length, transferred)) {
+        return true;
+    }
+    HILOG_ERROR("Transfer fd failed, transferred=%{public}lld, length=%{public}lld",
+        static_cast<long long>(transferred), static_cast<long long>(length));
+    return false;
+}
+
+bool FileDeal::TransferFd(int32_t srcFd, int32_t dstFd, int64_t length, ContentDigest &digest)
+{
+    if (srcFd < 0 || dstFd < 0 || length <= 0) {
+        HILOG_ERROR("Invalid transfer param, length=%{public}lld", static_cast<long long>(length));
+        return false;
+    }
+    // Hashing needs the bytes in user space, so the payload is copied in chunks and each one is hashed on its
+    // way to dstFd instead of reading the written file back.
+    StreamWriter writer(dstFd);
+    writer.SetDigest(&digest);
+    if (!writer.AppendFromFd(srcFd, length) || !writer.Flush()) {
+        HILOG_ERROR("Transfer fd failed, status=%{public}d", static_cast<int32_t>(writer.GetStatus()));
+        return false;
+    }
+    return true;
+}
+
+bool FileDeal::CopyFileRange(int32_t srcFd, int32_t dstFd, int64_t length, int64_t &transferred)
+{
+#ifdef SYS_copy_file_range
+    while (transferred < length) {
+        size_t step = static_cast<size_t>(std::min(length - transferred, TRANSFER_MAX_STEP));
+        ssize_t ret = syscall(SYS_copy_file_range, srcFd, nullptr, dstFd, nullptr, step, 0);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            HILOG_DEBUG("copy_file_range stopped, ret=%{public}zd, errno=%{public}d", ret, errno);
+            return false;
+        }
+        transferred += ret;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool FileDeal::SendFile(int32_t srcFd, int32_t dstFd, int64_t length, int64_t &transferred)
+{
+    while (transferred < length) {
+        size_t step = static_cast<size_t>(std::min(length - transferred, TRANSFER_MAX_STEP));
+        ssize_t ret = sendfile(dstFd, srcFd, nullptr, step);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            HILOG_DEBUG("sendfile stopped, ret=%{public}zd, errno=%{public}d", ret, errno);
+            return false;
+        }
+        transferred += ret;
+    }
+    return true;
+}
+
+bool FileDeal::ChunkedCopy(int32_t srcFd, int32_t dstFd, int64_t length, int64_t &transferred)
+{
+    StreamWriter writer(dstFd);
+    if (!writer.AppendFromFd(srcFd, length - transferred) || !writer.Flush()) {
+        HILOG_ERROR("Chunked copy failed, status=%{public}d", static_cast<int32_t>(writer.GetStatus()));
+        return false;
+    }
+    transferred += writer.GetTotalSize();
+    return true;
+}
 } // namespace WallpaperMgrService
 } // namespace OHOS
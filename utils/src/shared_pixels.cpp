@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2025 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "hilog_wrapper.h"
+#include "shared_pixels.h"
+
+namespace OHOS {
+namespace WallpaperMgrService {
+namespace {
+constexpr const char *SHARED_PIXELS_NAME = "wallpaper_pixels";
+constexpr uint32_t MEMFD_FLAGS = 0x0003U;             // MFD_CLOEXEC | MFD_ALLOW_SEALING
+constexpr int32_t SEAL_SEAL = 0x0001;                 // F_SEAL_SEAL
+constexpr int32_t SEAL_SHRINK = 0x0002;               // F_SEAL_SHRINK
+constexpr int32_t SEAL_GROW = 0x0004;                 // F_SEAL_GROW
+constexpr int32_t SEAL_WRITE = 0x0008;                // F_SEAL_WRITE
+constexpr int32_t CMD_ADD_SEALS = 1024 + 9;           // F_ADD_SEALS
+constexpr int32_t CMD_GET_SEALS = 1024 + 10;          // F_GET_SEALS
+constexpr int32_t REQUIRED_SEALS = SEAL_SHRINK | SEAL_GROW | SEAL_WRITE;
+// Sealing the seals as well keeps the client from lifting them again once the fd is sent.
+constexpr int32_t CREATE_SEALS = REQUIRED_SEALS | SEAL_SEAL;
+constexpr int32_t BYTES_PER_PIXEL = 4;
+
+bool WriteAll(int32_t fd, const void *data, size_t size)
+{
+    auto *cursor = static_cast<const char *>(data);
+    while (size > 0) {
+        ssize_t ret = write(fd, cursor, size);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            HILOG_ERROR("Write shared pixels failed, errno=%{public}d", errno);
+            return false;
+        }
+        cursor += ret;
+        size -= static_cast<size_t>(ret);
+    }
+    return true;
+}
+} // namespace
+
+SharedPixels::~SharedPixels()
+{
+    if (address_ != nullptr) {
+        munmap(address_, mappedSize_);
+    }
+}
+
+int32_t SharedPixels::Create(const SharedPixelsHeader &header, const void *pixels)
+{
+#ifdef SYS_memfd_create
+    if (pixels == nullptr || !IsValidHeader(header, sizeof(SharedPixelsHeader) + header.pixelsSize)) {
+        HILOG_ERROR("Invalid shared pixels.");
+        return -1;
+    }
+    int32_t fd = static_cast<int32_t>(syscall(SYS_memfd_create, SHARED_PIXELS_NAME, MEMFD_FLAGS));
+    if (fd < 0) {
+        HILOG_ERROR("memfd_create failed, errno=%{public}d", errno);
+        return -1;
+    }
+    if (!WriteAll(fd, &header, sizeof(header)) || !WriteAll(fd, pixels, header.pixelsSize)
+        || fcntl(fd, CMD_ADD_SEALS, CREATE_SEALS) != 0) {
+        HILOG_ERROR("Fill shared pixels failed, errno=%{public}d", errno);
+        close(fd);
+        return -1;
+    }
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+bool SharedPixels::Map(int32_t fd)
+{
+    // Without these seals the client could still change the pixels while they are encoded.
+    int32_t seals = fcntl(fd, CMD_GET_SEALS);
+    if (seals < 0 || (seals & REQUIRED_SEALS) != REQUIRED_SEALS) {
+        HILOG_ERROR("Shared pixels are not sealed, seals=%{public}d", seals);
+        return false;
+    }
+    struct stat fileStat = {};
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size < static_cast<off_t>(sizeof(SharedPixelsHeader))) {
+        HILOG_ERROR("Invalid shared pixels size.");
+        return false;
+    }
+    void *address = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+        HILOG_ERROR("mmap shared pixels failed, errno=%{public}d", errno);
+        return false;
+    }
+    address_ = address;
+    mappedSize_ = static_cast<size_t>(fileStat.st_size);
+    memcpy(&header_, address_, sizeof(header_));
+    return IsValidHeader(header_, mappedSize_);
+}
+
+const SharedPixelsHeader &SharedPixels::GetHeader() const
+{
+    return header_;
+}
+
+const void *SharedPixels::GetPixels() const
+{
+    return address_ == nullptr ? nullptr : static_cast<const char *>(address_) + sizeof(SharedPixelsHeader);
+}
+
+bool SharedPixels::IsValidHeader(const SharedPixelsHeader &header, uint64_t fileSize)
+{
+    if (header.magic != MAGIC || header.width <= 0 || header.height <= 0
+        || static_cast<int64_t>(header.rowStride) < static_cast<int64_t>(header.width) * BYTES_PER_PIXEL
+        || header.rowStride % BYTES_PER_PIXEL != 0) {
+        return false;
+    }
+    uint64_t pixelsSize = static_cast<uint64_t>(header.rowStride) * static_cast<uint64_t>(header.height);
+    return header.pixelsSize == pixelsSize && pixelsSize <= MAX_PIXELS_SIZE
+        && sizeof(SharedPixelsHeader) + pixelsSize <= fileSize;
+}
+} // namespace WallpaperMgrService
+} // namespace OHOS
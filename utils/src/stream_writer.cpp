@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2025 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "content_digest.h"
+#include "hilog_wrapper.h"
+#include "stream_writer.h"
+
+namespace OHOS {
+namespace WallpaperMgrService {
+StreamWriter::StreamWriter(int32_t fd, size_t bufferSize) : fd_(fd), bufferSize_(bufferSize)
+{
+    if (bufferSize_ == 0) {
+        bufferSize_ = DEFAULT_BUFFER_SIZE;
+    }
+}
+
+void StreamWriter::SetProgressCallback(const ProgressCallback &callback)
+{
+    callback_ = callback;
+}
+
+void StreamWriter::SetMaxSize(int64_t maxSize)
+{
+    maxSize_ = maxSize;
+}
+
+void StreamWriter::SetDigest(ContentDigest *digest)
+{
+    digest_ = digest;
+}
+
+bool StreamWriter::Append(const char *data, size_t size)
+{
+    if (status_ != StreamStatus::OK || !Reserve()) {
+        return false;
+    }
+    if (static_cast<int64_t>(size) > maxSize_ - totalSize_) {
+        HILOG_ERROR("Stream exceeds max size %{public}lld", static_cast<long long>(maxSize_));
+        return Fail(StreamStatus::OVERSIZED);
+    }
+    while (size > 0) {
+        size_t step = std::min(size, bufferSize_ - used_);
+        memcpy(buffer_.get() + used_, data, step);
+        used_ += step;
+        totalSize_ += static_cast<int64_t>(step);
+        data += step;
+        size -= step;
+        if (used_ == bufferSize_ && !Drain()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool StreamWriter::AppendFromFd(int32_t srcFd, int64_t length)
+{
+    if (status_ != StreamStatus::OK || !Reserve()) {
+        return false;
+    }
+    if (length > maxSize_ - totalSize_) {
+        HILOG_ERROR("Stream exceeds max size %{public}lld", static_cast<long long>(maxSize_));
+        return Fail(StreamStatus::OVERSIZED);
+    }
+    int64_t remain = length;
+    while (remain > 0) {
+        size_t step = static_cast<size_t>(std::min(remain, static_cast<int64_t>(bufferSize_ - used_)));
+        ssize_t readSize = read(srcFd, buffer_.get() + used_, step);
+        if (readSize < 0 && errno == EINTR) {
+            continue;
+        }
+        if (readSize <= 0) {
+            HILOG_ERROR("Read source fd failed, ret=%{public}zd, errno=%{public}d", readSize, errno);
+            return Fail(StreamStatus::READ_FAILED);
+        }
+        used_ += static_cast<size_t>(readSize);
+        totalSize_ += readSize;
+        remain -= readSize;
+        if (used_ == bufferSize_ && !Drain()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool StreamWriter::Flush()
+{
+    if (status_ != StreamStatus::OK) {
+        return false;
+    }
+    return used_ == 0 || Drain();
+}
+
+int64_t StreamWriter::GetTotalSize() const
+{
+    return totalSize_;
+}
+
+StreamStatus StreamWriter::GetStatus() const
+{
+    return status_;
+}
+
+bool StreamWriter::Reserve()
+{
+    if (buffer_ != nullptr) {
+        return true;
+    }
+    buffer_.reset(new (std::nothrow) char[bufferSize_]);
+    if (buffer_ == nullptr) {
+        HILOG_ERROR("Alloc stream buffer failed, size=%{public}zu", bufferSize_);
+        return Fail(StreamStatus::NO_MEMORY);
+    }
+    return true;
+}
+
+bool StreamWriter::Drain()
+{
+    if (digest_ != nullptr) {
+        digest_->Update(buffer_.get(), used_);
+    }
+    size_t written = 0;
+    while (written < used_) {
+        ssize_t ret = write(fd_, buffer_.get() + written, used_ - written);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            HILOG_ERROR("Write stream chunk failed, errno=%{public}d", errno);
+            return Fail(StreamStatus::WRITE_FAILED);
+        }
+        written += static_cast<size_t>(ret);
+    }
+    writtenSize_ += static_cast<int64_t>(used_);
+    used_ = 0;
+    if (callback_ != nullptr && !callback_(writtenSize_)) {
+        HILOG_INFO("Stream canceled at %{public}lld", static_cast<long long>(writtenSize_));
+        return Fail(StreamStatus::CANCELED);
+    }
+    return true;
+}
+
+bool StreamWriter::Fail(StreamStatus status)
+{
+    status_ = status;
+    return false;
+}
+
+StreamWriterBuf::StreamWriterBuf(StreamWriter &writer) : writer_(writer)
+{
+}
+
+StreamWriterBuf::int_type StreamWriterBuf::overflow(int_type ch)
+{
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+        return traits_type::not_eof(ch);
+    }
+    char value = traits_type::to_char_type(ch);
+    return writer_.Append(&value, 1) ? ch : traits_type::eof();
+}
+
+std::streamsize StreamWriterBuf::xsputn(const char *data, std::streamsize count)
+{
+    if (count <= 0) {
+        return 0;
+    }
+    return writer_.Append(data, static_cast<size_t>(count)) ? count : 0;
+}
+
+int StreamWriterBuf::sync()
+{
+    return writer_.Flush() ? 0 : -1;
+}
+} // namespace WallpaperMgrService
+} // namespace OHOS